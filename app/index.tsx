@@ -2,13 +2,13 @@ import type { OverlayItem } from "@/components/OverlaySystem";
 import OverlaySystem from "@/components/OverlaySystem";
 import RecordingControls from "@/components/RecordingControls";
 import FFmpegModule from "@/specs/NativeFFmpegModule";
+import VideoProcessor from "@/utils/VideoProcessor";
 import { saveVideoToGallery } from "@/utils/videoProcessing";
 import { Asset } from "expo-asset";
 import * as FileSystem from "expo-file-system";
 import * as Haptics from "expo-haptics";
 import * as MediaLibrary from "expo-media-library";
 import { StatusBar } from "expo-status-bar";
-import * as VideoThumbnails from "expo-video-thumbnails";
 import React, { useEffect, useRef, useState } from "react";
 import {
   Alert,
@@ -28,6 +28,10 @@ import {
 
 const { width, height } = Dimensions.get("window");
 
+// Opt-in: build a low-res editing proxy in the background after each
+// recording so previews, scrubbing and thumbnails avoid full-res decodes
+const GENERATE_EDITING_PROXIES = false;
+
 export default function HomeScreen() {
   const [isCameraReady, setIsCameraReady] = useState(false);
   const [isRecording, setIsRecording] = useState(false);
@@ -42,6 +46,14 @@ export default function HomeScreen() {
 
   // const [video, setVideo] = useState<MediaLibrary.Asset | null>(null);
 
+  useEffect(() => {
+    // Thumbnails and filmstrips are cached natively, keyed by file content
+    FFmpegModule.configureMediaCache(
+      `${FileSystem.cacheDirectory}media-cache`,
+      64 * 1024 * 1024
+    );
+  }, []);
+
   useEffect(() => {
     (async () => {
       const { status } = await MediaLibrary.requestPermissionsAsync();
@@ -119,6 +131,11 @@ export default function HomeScreen() {
 
       await cameraRef.current.startRecording({
         onRecordingFinished: async (video) => {
+          if (GENERATE_EDITING_PROXIES) {
+            FFmpegModule.generateProxy(video.path, 360).catch((e) =>
+              console.log("Proxy generation failed:", e)
+            );
+          }
           try {
             // Step 1: Trim the first 3 seconds using trimVideo
             const trimmedPath = `${
@@ -174,7 +191,8 @@ export default function HomeScreen() {
               mutedPath,
               overlayedPath,
               overlaysJson,
-              workDir
+              workDir,
+              JSON.stringify({ profile: "share-fast" })
             );
             if (!burnSuccess) {
               Alert.alert(
@@ -188,10 +206,9 @@ export default function HomeScreen() {
             await saveVideoToGallery(overlayedPath);
 
             // Step 5: Generate thumbnail
-            const { uri: thumbnailUri } =
-              await VideoThumbnails.getThumbnailAsync(overlayedPath, {
-                time: 0,
-              });
+            const thumbnailUri = await VideoProcessor.generateThumbnail(
+              overlayedPath
+            );
 
             Alert.alert(
               "Success",
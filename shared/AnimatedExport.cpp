@@ -0,0 +1,481 @@
+#include "AnimatedExport.h"
+#include "FrameExtractor.h"
+#include "MediaUtils.h"
+#include "OverlayFilter.h"
+#include "SimdKernels.h"
+#include <android/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/opt.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Keyframes decoded to build a palette. Colours that only show up between
+// keyframes are still reached by dithering.
+constexpr int kPaletteSamples = 16;
+constexpr int kTransparentIndex = 255;
+constexpr int kCells = 1 << 15;
+
+// 8x8 Bayer thresholds scaled to one 5-bit step (0..7).
+constexpr uint8_t kBayer[8][8] = {
+    {0, 4, 1, 5, 0, 4, 1, 5}, {6, 2, 7, 3, 6, 2, 7, 3}, {1, 5, 0, 4, 1, 5, 0, 4}, {7, 3, 6, 2, 7, 3, 6, 2},
+    {0, 4, 1, 5, 0, 4, 1, 5}, {6, 2, 7, 3, 6, 2, 7, 3}, {1, 5, 0, 4, 1, 5, 0, 4}, {7, 3, 6, 2, 7, 3, 6, 2},
+};
+
+inline int cellOf(int r, int g, int b) { return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3); }
+inline int cellComponent(int cell, int axis) { return (cell >> (10 - 5 * axis)) & 31; }
+inline int expand5(int v) { return (v << 3) | (v >> 2); }
+inline int argbComponent(uint32_t argb, int axis) { return (argb >> (16 - 8 * axis)) & 0xff; }
+
+// Median cut over the RGB555 histogram: keep splitting the box with the most
+// pixels times extent along its longest axis, at the pixel median.
+std::shared_ptr<GifPalette> buildPalette(const std::vector<uint32_t>& hist) {
+    struct Cell {
+      uint16_t cell;
+      uint32_t count;
+    };
+    struct Box {
+      size_t begin, end;
+      uint64_t pixels;
+      int axis;
+      int span;
+    };
+    std::vector<Cell> cells;
+    for (int i = 0; i < kCells; ++i) {
+        if (hist[i]) cells.push_back({static_cast<uint16_t>(i), hist[i]});
+    }
+    if (cells.empty()) return nullptr;
+
+    auto measure = [&](Box& box) {
+        int lo[3] = {31, 31, 31};
+        int hi[3] = {0, 0, 0};
+        box.pixels = 0;
+        for (size_t i = box.begin; i < box.end; ++i) {
+            box.pixels += cells[i].count;
+            for (int axis = 0; axis < 3; ++axis) {
+                int v = cellComponent(cells[i].cell, axis);
+                lo[axis] = std::min(lo[axis], v);
+                hi[axis] = std::max(hi[axis], v);
+            }
+        }
+        box.axis = 0;
+        for (int axis = 1; axis < 3; ++axis) {
+            if (hi[axis] - lo[axis] > hi[box.axis] - lo[box.axis]) box.axis = axis;
+        }
+        box.span = hi[box.axis] - lo[box.axis];
+    };
+
+    std::vector<Box> boxes(1, Box{0, cells.size(), 0, 0, 0});
+    measure(boxes[0]);
+    while (static_cast<int>(boxes.size()) < kTransparentIndex) {
+        Box* widest = nullptr;
+        for (Box& box : boxes) {
+            if (box.span == 0) continue;
+            if (!widest || box.pixels * box.span > widest->pixels * widest->span) widest = &box;
+        }
+        if (!widest) break;
+        Box box = *widest;
+        int axis = box.axis;
+        std::sort(cells.begin() + box.begin, cells.begin() + box.end,
+                  [axis](const Cell& a, const Cell& b) { return cellComponent(a.cell, axis) < cellComponent(b.cell, axis); });
+        size_t mid = box.begin;
+        uint64_t below = 0;
+        while (mid < box.end - 1 && below + cells[mid].count <= box.pixels / 2) below += cells[mid++].count;
+        mid = std::max(mid, box.begin + 1);
+        Box upper{mid, box.end, 0, 0, 0};
+        widest->end = mid;
+        measure(*widest);
+        measure(upper);
+        boxes.push_back(upper);
+    }
+
+    auto palette = std::make_shared<GifPalette>();
+    palette->colors = static_cast<int>(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        uint64_t sum[3] = {0, 0, 0};
+        for (size_t c = boxes[i].begin; c < boxes[i].end; ++c) {
+            for (int axis = 0; axis < 3; ++axis) sum[axis] += static_cast<uint64_t>(expand5(cellComponent(cells[c].cell, axis))) * cells[c].count;
+        }
+        uint32_t argb = 0xff000000;
+        for (int axis = 0; axis < 3; ++axis) argb |= static_cast<uint32_t>(sum[axis] / boxes[i].pixels) << (16 - 8 * axis);
+        palette->argb[i] = argb;
+    }
+    for (int i = palette->colors; i < kTransparentIndex; ++i) palette->argb[i] = 0xff000000;
+    palette->argb[kTransparentIndex] = 0;
+
+    palette->lut.resize(kCells);
+    for (int cell = 0; cell < kCells; ++cell) {
+        int r = expand5(cellComponent(cell, 0));
+        int g = expand5(cellComponent(cell, 1));
+        int b = expand5(cellComponent(cell, 2));
+        int best = 0;
+        int bestDist = INT32_MAX;
+        for (int i = 0; i < palette->colors; ++i) {
+            int dr = r - argbComponent(palette->argb[i], 0);
+            int dg = g - argbComponent(palette->argb[i], 1);
+            int db = b - argbComponent(palette->argb[i], 2);
+            int dist = dr * dr + dg * dg + db * db;
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = i;
+            }
+        }
+        palette->lut[cell] = static_cast<uint8_t>(best);
+    }
+    return palette;
+}
+
+std::string paletteKey(const EditPlan& plan, const std::string& overlaysJson, int width, int height) {
+    struct stat st;
+    std::ostringstream key;
+    key << plan.inputPath;
+    if (stat(plan.inputPath.c_str(), &st) == 0) key << "|" << st.st_size << "|" << st.st_mtime;
+    key << "|" << plan.startSec << "|" << plan.durationSec << "|" << width << "x" << height << "|" << overlaysJson;
+    return key.str();
+}
+
+// First pass: composite a few keyframes (lowres-decoded, never the whole
+// clip) exactly as the export will and histogram them.
+std::shared_ptr<GifPalette> samplePalette(const EditPlan& plan, const std::string& overlayChain, int width, int height,
+                                          int quarterTurns) {
+    // Lowres works on coded frames, which are turned against the output.
+    bool turned = quarterTurns & 1;
+    auto decoder = openVideoDecoder(plan.inputPath, turned ? height : width, turned ? width : height);
+    if (!decoder) return nullptr;
+    double start = plan.startSec;
+    double end = plan.durationSec > 0 ? start + plan.durationSec : decoder->durationSec();
+    if (end <= start) end = start;
+
+    std::string chain = uprightScaleFilter(width, height, quarterTurns);
+    if (!overlayChain.empty()) chain += "," + overlayChain;
+    chain += ",format=rgba";
+
+    std::vector<uint32_t> hist(kCells, 0);
+    AVFilterGraph* graph = nullptr;
+    AVFilterContext* buffersrcCtx = nullptr;
+    AVFilterContext* buffersinkCtx = nullptr;
+    AVFrame* rgba = av_frame_alloc();
+    int64_t lastPts = AV_NOPTS_VALUE;
+    for (int i = 0; i < kPaletteSamples; ++i) {
+        AVFrame* frame = decodeKeyframeAt(*decoder, start + (end - start) * (i + 0.5) / kPaletteSamples);
+        if (!frame) continue;
+        // Short trims land on the same keyframe more than once.
+        if (frame->best_effort_timestamp == lastPts) {
+            av_frame_free(&frame);
+            continue;
+        }
+        lastPts = frame->best_effort_timestamp;
+        if (!graph) {
+            graph = createFilterGraph(chain, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                      decoder->stream()->time_base, frame->sample_aspect_ratio, &buffersrcCtx, &buffersinkCtx);
+            if (!graph) {
+                av_frame_free(&frame);
+                break;
+            }
+        }
+        frame->pts = i;
+        if (av_buffersrc_add_frame(buffersrcCtx, frame) >= 0) {
+            while (av_buffersink_get_frame(buffersinkCtx, rgba) >= 0) {
+                for (int y = 0; y < rgba->height; ++y) {
+                    const uint8_t* p = rgba->data[0] + static_cast<ptrdiff_t>(y) * rgba->linesize[0];
+                    for (int x = 0; x < rgba->width; ++x, p += 4) hist[cellOf(p[0], p[1], p[2])]++;
+                }
+                av_frame_unref(rgba);
+            }
+        }
+        av_frame_free(&frame);
+    }
+    av_frame_free(&rgba);
+    avfilter_graph_free(&graph);
+    return buildPalette(hist);
+}
+
+// Floyd-Steinberg over one row. Errors are kept in 1/16ths, one slot of
+// padding on each side; `next` must be zeroed by the caller.
+void ditherFloydRow(const uint8_t* rgba, int width, const GifPalette& palette, std::vector<int>& cur, std::vector<int>& next, uint8_t* dst) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* p = rgba + x * 4;
+        int* err = &cur[(x + 1) * 3];
+        int c[3];
+        for (int axis = 0; axis < 3; ++axis) c[axis] = std::clamp(p[axis] + err[axis] / 16, 0, 255);
+        uint8_t index = palette.lut[cellOf(c[0], c[1], c[2])];
+        dst[x] = index;
+        for (int axis = 0; axis < 3; ++axis) {
+            int e = c[axis] - argbComponent(palette.argb[index], axis);
+            cur[(x + 2) * 3 + axis] += e * 7;
+            next[x * 3 + axis] += e * 3;
+            next[(x + 1) * 3 + axis] += e * 5;
+            next[(x + 2) * 3 + axis] += e;
+        }
+    }
+}
+
+struct AnimatedEncoder {
+  AVFormatContext* outFmtCtx = nullptr;
+  AVCodecContext* encCtx = nullptr;
+  AVStream* outStream = nullptr;
+  AVPacket* pkt = av_packet_alloc();
+  AVFrame* indexed = nullptr;
+  FramePool pool;
+  std::vector<int> errCur;
+  std::vector<int> errNext;
+
+  ~AnimatedEncoder() {
+    av_frame_free(&indexed);
+    av_packet_free(&pkt);
+    if (encCtx) avcodec_free_context(&encCtx);
+    if (outFmtCtx) {
+      if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
+      avformat_free_context(outFmtCtx);
+    }
+  }
+};
+
+bool openAnimatedEncoder(AnimatedEncoder& out, const AVCodec* enc, const std::string& format, const std::string& output,
+                         int width, int height, AVRational timeBase, AVRational frameRate) {
+    avformat_alloc_output_context2(&out.outFmtCtx, nullptr, format.c_str(), output.c_str());
+    if (!out.outFmtCtx) return false;
+    out.encCtx = avcodec_alloc_context3(enc);
+    if (!out.encCtx) return false;
+    out.encCtx->width = width;
+    out.encCtx->height = height;
+    out.encCtx->pix_fmt = enc->id == AV_CODEC_ID_GIF ? AV_PIX_FMT_PAL8 : AV_PIX_FMT_YUV420P;
+    out.encCtx->time_base = timeBase;
+    out.encCtx->framerate = frameRate;
+    if (enc->id != AV_CODEC_ID_GIF) av_opt_set_double(out.encCtx->priv_data, "quality", 75, 0);
+    if (out.outFmtCtx->oformat->flags & AVFMT_GLOBALHEADER) out.encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (avcodec_open2(out.encCtx, enc, nullptr) < 0) return false;
+
+    if (enc->id == AV_CODEC_ID_GIF) out.indexed = av_frame_alloc();
+
+    out.outStream = avformat_new_stream(out.outFmtCtx, nullptr);
+    if (!out.outStream) return false;
+    if (avcodec_parameters_from_context(out.outStream->codecpar, out.encCtx) < 0) return false;
+    out.outStream->time_base = out.encCtx->time_base;
+    if (!(out.outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&out.outFmtCtx->pb, output.c_str(), AVIO_FLAG_WRITE) < 0) return false;
+    }
+    AVDictionary* muxOptions = nullptr;
+    av_dict_set(&muxOptions, "loop", "0", 0);
+    int ret = avformat_write_header(out.outFmtCtx, &muxOptions);
+    av_dict_free(&muxOptions);
+    return ret >= 0;
+}
+
+bool writeAnimatedPackets(AnimatedEncoder& out) {
+    while (avcodec_receive_packet(out.encCtx, out.pkt) == 0) {
+        out.pkt->stream_index = out.outStream->index;
+        av_packet_rescale_ts(out.pkt, out.encCtx->time_base, out.outStream->time_base);
+        if (av_interleaved_write_frame(out.outFmtCtx, out.pkt) < 0) return false;
+    }
+    return true;
+}
+
+// Dither (GIF) and encode one composited frame.
+bool encodeAnimatedFrame(AnimatedEncoder& out, AVFrame* filtered, const GifPalette* palette, bool floyd) {
+    AVFrame* input = filtered;
+    if (palette) {
+        // The GIF encoder keeps a reference to the previous frame to diff
+        // against, so each frame gets its own pooled buffer.
+        AVFrame* indexed = out.indexed;
+        av_frame_unref(indexed);
+        indexed->format = AV_PIX_FMT_PAL8;
+        indexed->width = filtered->width;
+        indexed->height = filtered->height;
+        if (out.pool.getBuffer(indexed) < 0) return false;
+        memcpy(indexed->data[1], palette->argb, sizeof(palette->argb));
+        if (floyd) {
+            out.errCur.assign((filtered->width + 2) * 3, 0);
+            out.errNext.assign(out.errCur.size(), 0);
+        }
+        for (int y = 0; y < filtered->height; ++y) {
+            const uint8_t* row = filtered->data[0] + static_cast<ptrdiff_t>(y) * filtered->linesize[0];
+            uint8_t* dst = indexed->data[0] + static_cast<ptrdiff_t>(y) * indexed->linesize[0];
+            if (floyd) {
+                ditherFloydRow(row, filtered->width, *palette, out.errCur, out.errNext, dst);
+                out.errCur.swap(out.errNext);
+                std::fill(out.errNext.begin(), out.errNext.end(), 0);
+            } else {
+                ditherOrderedRow(row, filtered->width, kBayer[y & 7], palette->lut.data(), dst);
+            }
+        }
+        indexed->pts = filtered->pts;
+        input = indexed;
+    }
+    input->pict_type = AV_PICTURE_TYPE_NONE;
+    return avcodec_send_frame(out.encCtx, input) >= 0 && writeAnimatedPackets(out);
+}
+
+} // namespace
+
+AnimatedOptions parseAnimatedOptions(const std::string& json) {
+    AnimatedOptions options;
+    std::string format = jsonField(json, "format");
+    if (format == "webp") options.format = format;
+    options.width = static_cast<int>(jsonNumber(json, "width", options.width));
+    options.fps = jsonNumber(json, "fps", options.fps);
+    if (jsonField(json, "dither") == "floyd") options.dither = "floyd";
+    return options;
+}
+
+bool animatedFormatAvailable(const std::string& format) {
+    if (format == "webp") return avcodec_find_encoder_by_name("libwebp_anim") != nullptr;
+    return avcodec_find_encoder(AV_CODEC_ID_GIF) != nullptr;
+}
+
+std::shared_ptr<const GifPalette> PaletteCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = palettes_.find(key);
+    return it == palettes_.end() ? nullptr : it->second;
+}
+
+void PaletteCache::insert(const std::string& key, std::shared_ptr<const GifPalette> palette) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (palettes_.find(key) == palettes_.end()) order_.push_back(key);
+    palettes_[key] = std::move(palette);
+    while (order_.size() > kMaxEntries) {
+        palettes_.erase(order_.front());
+        order_.pop_front();
+    }
+}
+
+bool exportAnimated(const EditPlan& plan, const std::string& overlaysJson, const std::string& outputPath,
+                    const AnimatedOptions& options, PaletteCache& palettes, AnimatedStats& stats) {
+    auto started = std::chrono::steady_clock::now();
+    stats = AnimatedStats();
+    bool gif = options.format != "webp";
+    const AVCodec* enc = gif ? avcodec_find_encoder(AV_CODEC_ID_GIF) : avcodec_find_encoder_by_name("libwebp_anim");
+    if (!enc) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No encoder for animated format: %s", options.format.c_str());
+        return false;
+    }
+    auto decoder = openVideoDecoder(plan.inputPath, 0, 0, FF_THREAD_FRAME, true);
+    if (!decoder) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Animated export: failed to open %s", plan.inputPath.c_str());
+        return false;
+    }
+    AVStream* inStream = decoder->stream();
+    AVCodecContext* decCtx = decoder->decCtx;
+
+    // Sized and turned as the clip is shown: GIF and WebP have no display
+    // matrix to carry the rotation.
+    int turns = displayQuarterTurns(inStream);
+    int shownWidth = turns & 1 ? decCtx->height : decCtx->width;
+    int shownHeight = turns & 1 ? decCtx->width : decCtx->height;
+    int width = options.width > 0 ? std::min(options.width, shownWidth) : shownWidth;
+    int height = 0;
+    fitTargetSize(shownWidth, shownHeight, width, height);
+    double sourceFps = av_q2d(av_guess_frame_rate(decoder->fmtCtx, inStream, nullptr));
+    double fps = options.fps > 0 ? options.fps : AnimatedOptions().fps;
+    if (sourceFps > 0) fps = std::min(fps, sourceFps);
+    AVRational frameRate = av_d2q(fps, 1001000);
+    stats.width = width;
+    stats.height = height;
+    stats.fps = fps;
+
+    std::string overlayChain;
+    if (!buildOverlayFilter(overlaysJson, plan.workDir, static_cast<double>(width) / shownWidth, overlayChain)) return false;
+
+    std::shared_ptr<const GifPalette> palette;
+    if (gif) {
+        std::string key = paletteKey(plan, overlaysJson, width, height);
+        palette = palettes.find(key);
+        stats.paletteCached = palette != nullptr;
+        if (!palette) {
+            auto paletteStarted = std::chrono::steady_clock::now();
+            palette = samplePalette(plan, overlayChain, width, height, turns);
+            stats.paletteSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - paletteStarted).count();
+            if (!palette) {
+                __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Animated export: no palette for %s", plan.inputPath.c_str());
+                return false;
+            }
+            palettes.insert(key, palette);
+        }
+    }
+
+    // Scale and turn first so overlays, the frame-rate cut and dithering all
+    // run on upright output-size frames.
+    std::string chain = uprightScaleFilter(width, height, turns);
+    if (!overlayChain.empty()) chain += "," + overlayChain;
+    chain += ",fps=" + std::to_string(frameRate.num) + "/" + std::to_string(frameRate.den);
+    chain += gif ? ",format=rgba" : ",format=yuv420p";
+    AVFilterContext* buffersrcCtx = nullptr;
+    AVFilterContext* buffersinkCtx = nullptr;
+    AVFilterGraph* graph = createFilterGraph(chain, decCtx->width, decCtx->height, decCtx->pix_fmt, inStream->time_base,
+                                             decCtx->sample_aspect_ratio, &buffersrcCtx, &buffersinkCtx);
+    if (!graph) return false;
+
+    std::string output = stripFileScheme(outputPath);
+    AnimatedEncoder out;
+    bool ok = openAnimatedEncoder(out, enc, gif ? "gif" : "webp", output, width, height,
+                                  av_buffersink_get_time_base(buffersinkCtx), frameRate);
+    if (!ok) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Animated export: failed to set up %s", output.c_str());
+
+    bool floyd = options.dither == "floyd";
+    AVFrame* filtered = av_frame_alloc();
+    auto drainGraph = [&]() {
+        while (ok && av_buffersink_get_frame(buffersinkCtx, filtered) >= 0) {
+            ok = encodeAnimatedFrame(out, filtered, palette.get(), floyd);
+            if (ok) stats.frames++;
+            av_frame_unref(filtered);
+        }
+    };
+
+    if (ok) {
+        double endSec = plan.durationSec > 0 ? plan.startSec + plan.durationSec : 0;
+        int64_t firstPts = AV_NOPTS_VALUE;
+        // Speed-ups squeeze the timeline as exports do; non-reference frames
+        // are skipped in the decoder and frames landing in an output frame
+        // interval already taken are dropped before the scaler.
+        if (plan.speed > 1) decCtx->skip_frame = AVDISCARD_NONREF;
+        double nextSlotSec = 0;
+        if (plan.startSec > 0) seekVideoBefore(*decoder, plan.startSec);
+        bool decoded = decodeVideoFrames(*decoder, [&](AVFrame* frame) {
+            double timeSec = frameTimeSec(*decoder, frame);
+            if (timeSec < plan.startSec) return true;
+            if (endSec > 0 && timeSec >= endSec) return false;
+            if (firstPts == AV_NOPTS_VALUE) firstPts = frame->best_effort_timestamp;
+            frame->pts = frame->best_effort_timestamp - firstPts;
+            if (plan.speed > 1) {
+                frame->pts = std::llround(frame->pts / plan.speed);
+                double outSec = frame->pts * av_q2d(inStream->time_base);
+                if (outSec + 1e-6 < nextSlotSec) return true;
+                nextSlotSec = (std::floor(outSec * fps + 1e-6) + 1) / fps;
+            }
+            if (av_buffersrc_add_frame(buffersrcCtx, frame) < 0) ok = false;
+            drainGraph();
+            return ok;
+        });
+        ok = ok && decoded;
+    }
+    if (ok) {
+        // The fps filter holds its last frame until it sees the end.
+        av_buffersrc_add_frame(buffersrcCtx, nullptr);
+        drainGraph();
+    }
+    if (ok) {
+        avcodec_send_frame(out.encCtx, nullptr);
+        ok = writeAnimatedPackets(out) && av_write_trailer(out.outFmtCtx) >= 0;
+    }
+    av_frame_free(&filtered);
+    avfilter_graph_free(&graph);
+
+    stats.elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    struct stat st;
+    if (ok && stat(output.c_str(), &st) == 0) stats.outputBytes = st.st_size;
+    if (!ok) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Animated export failed for %s", plan.inputPath.c_str());
+    return ok;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "EditPlan.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace facebook::react {
+
+// Sent from JS as a flat JSON object:
+// {"format":"gif","width":480,"fps":12,"dither":"bayer"}.
+struct AnimatedOptions {
+  std::string format = "gif"; // "gif" or "webp" (see animatedFormatAvailable)
+  int width = 480;            // never upscaled; height follows the aspect ratio
+  double fps = 12;            // capped at the source frame rate
+  std::string dither = "bayer"; // GIF only: "bayer" (ordered) or "floyd"
+};
+
+AnimatedOptions parseAnimatedOptions(const std::string& json);
+
+// Whether this build can encode `format`. WebP needs libwebp_anim, which the
+// bundled FFmpeg is built without, so only GIF is available there.
+bool animatedFormatAvailable(const std::string& format);
+
+// GIF palette: up to 255 colours plus a fully transparent entry at index 255,
+// which lets the GIF encoder leave pixels that did not change between frames
+// transparent. `lut` maps an RGB555 cell (r << 10 | g << 5 | b) to the
+// nearest colour.
+struct GifPalette {
+  uint32_t argb[256] = {};
+  int colors = 0;
+  std::vector<uint8_t> lut;
+};
+
+// Palettes keyed by edit plan, so exporting the same plan again (another
+// frame rate or dither mode) skips the sampling pass.
+class PaletteCache {
+public:
+  std::shared_ptr<const GifPalette> find(const std::string& key);
+  void insert(const std::string& key, std::shared_ptr<const GifPalette> palette);
+
+private:
+  static constexpr size_t kMaxEntries = 8;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const GifPalette>> palettes_;
+  std::deque<std::string> order_;
+};
+
+struct AnimatedStats {
+  int width = 0;
+  int height = 0;
+  double fps = 0;
+  int64_t frames = 0;
+  bool paletteCached = false;
+  double paletteSec = 0;
+  double elapsedSec = 0;
+  int64_t outputBytes = 0;
+};
+
+// Export the plan's trimmed video, with overlays and at the plan's speed, as
+// an animated GIF or WebP. For GIF a palette is built from a handful of
+// keyframes spread over the trim (keyframe-only decoding, no full pass) or
+// taken from `palettes`, and every frame is dithered to it. Blocking.
+bool exportAnimated(const EditPlan& plan, const std::string& overlaysJson, const std::string& outputPath,
+                    const AnimatedOptions& options, PaletteCache& palettes, AnimatedStats& stats);
+
+} // namespace facebook::react
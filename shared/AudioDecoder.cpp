@@ -0,0 +1,233 @@
+#include "AudioDecoder.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Convert (or with in == nullptr, flush the resampler) onto the end of
+// decoder.pending. Returns the number of frames appended.
+size_t appendConverted(AudioDecoder& decoder, const uint8_t** in, int inSamples) {
+    int maxOut = swr_get_out_samples(decoder.swr, inSamples);
+    if (maxOut <= 0) return 0;
+    size_t old = decoder.pending.size();
+    decoder.pending.resize(old + static_cast<size_t>(maxOut) * decoder.channels);
+    uint8_t* out = reinterpret_cast<uint8_t*>(decoder.pending.data() + old);
+    int got = std::max(0, swr_convert(decoder.swr, &out, maxOut, in, inSamples));
+    decoder.pending.resize(old + static_cast<size_t>(got) * decoder.channels);
+    return static_cast<size_t>(got);
+}
+
+// Line the first converted frame up with a pending seek target: drop what
+// lies before it, or pad silence when decoding resumed past it.
+void alignToSeekTarget(AudioDecoder& decoder, const AVFrame* frame, size_t appended) {
+    AVStream* st = decoder.stream();
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) {
+        decoder.seekTargetSec = -1;
+        return;
+    }
+    if (st->start_time != AV_NOPTS_VALUE) pts -= st->start_time;
+    double lead = decoder.seekTargetSec - pts * av_q2d(st->time_base);
+    size_t ch = decoder.channels;
+    auto first = decoder.pending.end() - static_cast<ptrdiff_t>(appended * ch);
+    if (lead > 0) {
+        size_t drop = std::min(appended, static_cast<size_t>(std::lround(lead * decoder.sampleRate)));
+        decoder.pending.erase(first, first + static_cast<ptrdiff_t>(drop * ch));
+        if (drop == appended) return;
+    } else {
+        size_t pad = static_cast<size_t>(std::lround(-lead * decoder.sampleRate));
+        decoder.pending.insert(first, pad * ch, 0.0f);
+    }
+    decoder.seekTargetSec = -1;
+}
+
+// Decode until at least one more chunk lands in decoder.pending. Returns
+// false at the end of the stream (after flushing the resampler).
+bool refillPending(AudioDecoder& decoder, AVPacket* pkt, AVFrame* frame) {
+    for (;;) {
+        int ret = avcodec_receive_frame(decoder.decCtx, frame);
+        if (ret == 0) {
+            size_t appended = appendConverted(decoder, const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples);
+            if (decoder.seekTargetSec >= 0 && appended > 0) alignToSeekTarget(decoder, frame, appended);
+            av_frame_unref(frame);
+            if (decoder.pending.size() > decoder.pendingOffset) return true;
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            appendConverted(decoder, nullptr, 0);
+            return false;
+        }
+        if (av_read_frame(decoder.fmtCtx, pkt) < 0) {
+            avcodec_send_packet(decoder.decCtx, nullptr);
+            continue;
+        }
+        if (pkt->stream_index == decoder.streamIndex) avcodec_send_packet(decoder.decCtx, pkt);
+        av_packet_unref(pkt);
+    }
+}
+
+} // namespace
+
+AudioDecoder::~AudioDecoder() {
+    swr_free(&swr);
+    if (decCtx) avcodec_free_context(&decCtx);
+    if (fmtCtx) avformat_close_input(&fmtCtx);
+}
+
+double AudioDecoder::durationSec() const {
+    AVStream* st = stream();
+    if (st->duration != AV_NOPTS_VALUE && st->duration > 0) {
+        return st->duration * av_q2d(st->time_base);
+    }
+    if (fmtCtx->duration != AV_NOPTS_VALUE && fmtCtx->duration > 0) {
+        return static_cast<double>(fmtCtx->duration) / AV_TIME_BASE;
+    }
+    return 0;
+}
+
+std::unique_ptr<AudioDecoder> openAudioDecoder(const std::string& rawPath, int outRate, int outChannels) {
+    std::string path = stripFileScheme(rawPath);
+    auto decoder = std::make_unique<AudioDecoder>();
+    if (avformat_open_input(&decoder->fmtCtx, path.c_str(), nullptr, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open input: %s", path.c_str());
+        return nullptr;
+    }
+    if (avformat_find_stream_info(decoder->fmtCtx, nullptr) < 0) return nullptr;
+    const AVCodec* dec = nullptr;
+    decoder->streamIndex = av_find_best_stream(decoder->fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &dec, 0);
+    if (decoder->streamIndex < 0 || !dec) return nullptr;
+    for (unsigned int i = 0; i < decoder->fmtCtx->nb_streams; i++) {
+        if (static_cast<int>(i) != decoder->streamIndex) decoder->fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    decoder->decCtx = avcodec_alloc_context3(dec);
+    if (!decoder->decCtx) return nullptr;
+    if (avcodec_parameters_to_context(decoder->decCtx, decoder->stream()->codecpar) < 0) return nullptr;
+    if (avcodec_open2(decoder->decCtx, dec, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open audio decoder");
+        return nullptr;
+    }
+
+    AVChannelLayout outLayout;
+    if (outChannels > 0) {
+        av_channel_layout_default(&outLayout, outChannels);
+    } else {
+        av_channel_layout_copy(&outLayout, &decoder->decCtx->ch_layout);
+    }
+    decoder->sampleRate = outRate > 0 ? outRate : decoder->decCtx->sample_rate;
+    decoder->channels = outLayout.nb_channels;
+    int ret = swr_alloc_set_opts2(&decoder->swr, &outLayout, AV_SAMPLE_FMT_FLT, decoder->sampleRate,
+                                  &decoder->decCtx->ch_layout, decoder->decCtx->sample_fmt, decoder->decCtx->sample_rate,
+                                  0, nullptr);
+    av_channel_layout_uninit(&outLayout);
+    if (ret < 0 || swr_init(decoder->swr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to set up audio resampler");
+        return nullptr;
+    }
+    return decoder;
+}
+
+bool decodeAudio(AudioDecoder& decoder, const std::function<bool(const float*, size_t)>& onSamples) {
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    std::vector<float> converted;
+    bool ok = true;
+    bool draining = false;
+    bool stop = false;
+
+    auto convert = [&](const uint8_t** in, int inSamples) {
+        int maxOut = swr_get_out_samples(decoder.swr, inSamples);
+        if (maxOut <= 0) return;
+        converted.resize(static_cast<size_t>(maxOut) * decoder.channels);
+        uint8_t* out = reinterpret_cast<uint8_t*>(converted.data());
+        int got = swr_convert(decoder.swr, &out, maxOut, in, inSamples);
+        if (got > 0 && !onSamples(converted.data(), static_cast<size_t>(got))) stop = true;
+    };
+
+    while (!stop) {
+        if (!draining) {
+            if (av_read_frame(decoder.fmtCtx, pkt) < 0) {
+                draining = true;
+                avcodec_send_packet(decoder.decCtx, nullptr);
+            } else {
+                bool isAudio = pkt->stream_index == decoder.streamIndex;
+                if (isAudio && avcodec_send_packet(decoder.decCtx, pkt) < 0) {
+                    __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Skipping undecodable audio packet");
+                }
+                av_packet_unref(pkt);
+                if (!isAudio) continue;
+            }
+        }
+        int ret = 0;
+        while (!stop && (ret = avcodec_receive_frame(decoder.decCtx, frame)) == 0) {
+            convert(const_cast<const uint8_t**>(frame->extended_data), frame->nb_samples);
+            av_frame_unref(frame);
+        }
+        if (draining && ret == AVERROR_EOF) break;
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            ok = false;
+            break;
+        }
+    }
+    // Flush whatever the resampler is still holding.
+    if (ok && !stop) convert(nullptr, 0);
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return ok;
+}
+
+size_t readAudio(AudioDecoder& decoder, float* dst, size_t frames) {
+    size_t ch = decoder.channels;
+    size_t written = 0;
+    AVPacket* pkt = nullptr;
+    AVFrame* frame = nullptr;
+    while (written < frames) {
+        size_t available = (decoder.pending.size() - decoder.pendingOffset) / ch;
+        if (available > 0) {
+            size_t take = std::min(available, frames - written);
+            memcpy(dst + written * ch, decoder.pending.data() + decoder.pendingOffset, take * ch * sizeof(float));
+            decoder.pendingOffset += take * ch;
+            written += take;
+            continue;
+        }
+        if (decoder.finished) break;
+        decoder.pending.clear();
+        decoder.pendingOffset = 0;
+        if (!pkt) {
+            pkt = av_packet_alloc();
+            frame = av_frame_alloc();
+        }
+        if (!refillPending(decoder, pkt, frame)) decoder.finished = true;
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return written;
+}
+
+void seekAudio(AudioDecoder& decoder, double timeSec) {
+    AVStream* st = decoder.stream();
+    int64_t target = av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE) target += st->start_time;
+    av_seek_frame(decoder.fmtCtx, decoder.streamIndex, target, AVSEEK_FLAG_BACKWARD);
+    avcodec_flush_buffers(decoder.decCtx);
+    // Drop what the resampler still holds from before the seek.
+    swr_init(decoder.swr);
+    decoder.pending.clear();
+    decoder.pendingOffset = 0;
+    decoder.finished = false;
+    decoder.seekTargetSec = std::max(0.0, timeSec);
+}
+
+} // namespace facebook::react
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+}
+
+namespace facebook::react {
+
+// Demuxer + audio decoder + resampler for one clip, producing interleaved
+// float samples. Owns all contexts.
+struct AudioDecoder {
+  AVFormatContext* fmtCtx = nullptr;
+  AVCodecContext* decCtx = nullptr;
+  SwrContext* swr = nullptr;
+  int streamIndex = -1;
+  int sampleRate = 0;
+  int channels = 0;
+
+  // readAudio state: converted samples not handed out yet, and the position
+  // a seekAudio asked for (negative once reached).
+  std::vector<float> pending;
+  size_t pendingOffset = 0;
+  double seekTargetSec = -1;
+  bool finished = false;
+
+  AudioDecoder() = default;
+  AudioDecoder(const AudioDecoder&) = delete;
+  AudioDecoder& operator=(const AudioDecoder&) = delete;
+  ~AudioDecoder();
+
+  AVStream* stream() const { return fmtCtx->streams[streamIndex]; }
+  double durationSec() const;
+};
+
+// Open the best audio stream of `path`, converting to interleaved float at
+// outRate (0 keeps the source rate) with outChannels (1 downmixes to mono,
+// 0 keeps the source layout). Other streams are discarded at the demuxer.
+// Returns nullptr if there is no decodable audio.
+std::unique_ptr<AudioDecoder> openAudioDecoder(const std::string& path, int outRate = 0, int outChannels = 0);
+
+// Decode the whole stream, handing each converted chunk to onSamples as
+// (interleaved samples, frames per channel). Returning false from onSamples
+// stops early. Returns false on a decode error.
+bool decodeAudio(AudioDecoder& decoder, const std::function<bool(const float*, size_t)>& onSamples);
+
+// Pull-style alternative to decodeAudio: copy the next `frames` frames of
+// converted audio into dst. Returns how many were written, fewer only at the
+// end of the stream.
+size_t readAudio(AudioDecoder& decoder, float* dst, size_t frames);
+
+// Position readAudio at timeSec (stream time, start offset removed). The
+// first frames read start exactly there, with silence filling any gap before
+// the first decoded sample.
+void seekAudio(AudioDecoder& decoder, double timeSec);
+
+} // namespace facebook::react
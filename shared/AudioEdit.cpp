@@ -0,0 +1,623 @@
+#include "AudioEdit.h"
+#include "AudioDecoder.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+struct AudioFormat {
+  const char* name;
+  const char* muxer;
+  // Codecs the container takes as they are.
+  std::vector<AVCodecID> copyable;
+  // Tried in order when the track has to be re-encoded.
+  std::vector<const char*> encoders;
+  int64_t bitRate;
+};
+
+const std::vector<AudioFormat>& audioFormats() {
+    // Voice memos: 128 kbps AAC is transparent for speech and music from a
+    // phone mic; Opus gets there at half the rate.
+    static const std::vector<AudioFormat> formats = {
+        {"m4a", "ipod", {AV_CODEC_ID_AAC}, {"aac"}, 128000},
+        {"aac", "adts", {AV_CODEC_ID_AAC}, {"aac"}, 128000},
+        {"opus", "opus", {AV_CODEC_ID_OPUS}, {"libopus", "opus"}, 64000},
+        {"wav", "wav", {AV_CODEC_ID_PCM_S16LE}, {"pcm_s16le"}, 0},
+    };
+    return formats;
+}
+
+const AudioFormat* findAudioFormat(std::string name, const std::string& outputPath) {
+    if (name.empty()) {
+        size_t dot = outputPath.rfind('.');
+        if (dot != std::string::npos) name = outputPath.substr(dot + 1);
+    }
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const AudioFormat& format : audioFormats()) {
+        if (name == format.name) return &format;
+    }
+    return nullptr;
+}
+
+// An output file with a single audio stream. Closed and freed on
+// destruction, whether or not it was finished.
+struct AudioOutput {
+  AVFormatContext* fmtCtx = nullptr;
+  AVStream* stream = nullptr;
+
+  ~AudioOutput() {
+    if (fmtCtx) {
+      if (!(fmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&fmtCtx->pb);
+      avformat_free_context(fmtCtx);
+    }
+  }
+};
+
+// Create `path` with one stream described by `par` and write the header.
+bool openAudioOutput(AudioOutput& out, const AudioFormat& format, const std::string& path, const AVCodecParameters* par,
+                     AVRational timeBase) {
+    avformat_alloc_output_context2(&out.fmtCtx, nullptr, format.muxer, path.c_str());
+    if (!out.fmtCtx) return false;
+    out.stream = avformat_new_stream(out.fmtCtx, nullptr);
+    if (!out.stream) return false;
+    if (avcodec_parameters_copy(out.stream->codecpar, par) < 0) return false;
+    out.stream->codecpar->codec_tag = 0;
+    out.stream->time_base = timeBase;
+    if (!(out.fmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&out.fmtCtx->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) return false;
+    }
+    return avformat_write_header(out.fmtCtx, nullptr) >= 0;
+}
+
+// Same loop as muteVideo, keeping the one audio stream instead of the video
+// and starting its timestamps at 0.
+bool copyAudioPackets(AVFormatContext* inFmtCtx, int streamIndex, AudioOutput& out) {
+    AVStream* inStream = inFmtCtx->streams[streamIndex];
+    int64_t offset = inStream->start_time != AV_NOPTS_VALUE ? inStream->start_time : 0;
+    AVPacket* pkt = av_packet_alloc();
+    bool ok = true;
+    while (ok && av_read_frame(inFmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == streamIndex) {
+            if (pkt->pts != AV_NOPTS_VALUE) pkt->pts -= offset;
+            if (pkt->dts != AV_NOPTS_VALUE) pkt->dts -= offset;
+            pkt->stream_index = 0;
+            pkt->pos = -1;
+            av_packet_rescale_ts(pkt, inStream->time_base, out.stream->time_base);
+            ok = av_interleaved_write_frame(out.fmtCtx, pkt) >= 0;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    return ok && av_write_trailer(out.fmtCtx) >= 0;
+}
+
+// First of the sample formats we can fill that the encoder takes.
+AVSampleFormat pickSampleFormat(const AVCodec* enc) {
+    static const AVSampleFormat preferred[] = {AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P};
+    const void* configs = nullptr;
+    int count = 0;
+    if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_SAMPLE_FORMAT, 0, &configs, &count) < 0 || !configs) {
+        return AV_SAMPLE_FMT_FLTP;
+    }
+    const AVSampleFormat* formats = static_cast<const AVSampleFormat*>(configs);
+    for (AVSampleFormat fmt : preferred) {
+        if (std::find(formats, formats + count, fmt) != formats + count) return fmt;
+    }
+    return AV_SAMPLE_FMT_NONE;
+}
+
+// The source rate when the encoder takes it, otherwise its nearest
+// supported rate (Opus only runs at a few fixed rates).
+int pickSampleRate(const AVCodec* enc, int sourceRate) {
+    const void* configs = nullptr;
+    int count = 0;
+    if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_SAMPLE_RATE, 0, &configs, &count) < 0 || !configs || count == 0) {
+        return sourceRate;
+    }
+    const int* rates = static_cast<const int*>(configs);
+    int best = rates[0];
+    for (int i = 0; i < count; ++i) {
+        if (std::abs(rates[i] - sourceRate) < std::abs(best - sourceRate)) best = rates[i];
+    }
+    return best;
+}
+
+// Interleaved float from the decoder into the encoder's sample layout.
+void fillEncoderFrame(AVFrame* frame, const float* src, int frames, int channels) {
+    switch (frame->format) {
+    case AV_SAMPLE_FMT_FLT:
+        memcpy(frame->data[0], src, static_cast<size_t>(frames) * channels * sizeof(float));
+        break;
+    case AV_SAMPLE_FMT_FLTP:
+        for (int c = 0; c < channels; ++c) {
+            float* plane = reinterpret_cast<float*>(frame->extended_data[c]);
+            for (int i = 0; i < frames; ++i) plane[i] = src[i * channels + c];
+        }
+        break;
+    case AV_SAMPLE_FMT_S16: {
+        int16_t* dst = reinterpret_cast<int16_t*>(frame->data[0]);
+        for (int i = 0; i < frames * channels; ++i) dst[i] = static_cast<int16_t>(std::lrint(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f));
+        break;
+    }
+    case AV_SAMPLE_FMT_S16P:
+        for (int c = 0; c < channels; ++c) {
+            int16_t* plane = reinterpret_cast<int16_t*>(frame->extended_data[c]);
+            for (int i = 0; i < frames; ++i) plane[i] = static_cast<int16_t>(std::lrint(std::clamp(src[i * channels + c], -1.0f, 1.0f) * 32767.0f));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool drainAudioEncoder(AVCodecContext* encCtx, AudioOutput& out, AVPacket* pkt) {
+    while (avcodec_receive_packet(encCtx, pkt) == 0) {
+        pkt->stream_index = 0;
+        av_packet_rescale_ts(pkt, encCtx->time_base, out.stream->time_base);
+        if (av_interleaved_write_frame(out.fmtCtx, pkt) < 0) return false;
+    }
+    return true;
+}
+
+// Decode the audio of inputPath and encode it into a new `format` file.
+bool reencodeAudio(const std::string& inputPath, const AVCodecParameters* source, const AudioFormat& format,
+                   const std::string& outputPath, AudioExtractStats& stats) {
+    const AVCodec* enc = nullptr;
+    for (const char* name : format.encoders) {
+        if ((enc = avcodec_find_encoder_by_name(name))) break;
+    }
+    if (!enc) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No %s encoder in this build", format.name);
+        return false;
+    }
+    AVSampleFormat sampleFmt = pickSampleFormat(enc);
+    if (sampleFmt == AV_SAMPLE_FMT_NONE) return false;
+    int rate = pickSampleRate(enc, source->sample_rate);
+    int channels = std::clamp(source->ch_layout.nb_channels, 1, 2);
+    auto decoder = openAudioDecoder(inputPath, rate, channels);
+    if (!decoder) return false;
+
+    AVCodecContext* encCtx = avcodec_alloc_context3(enc);
+    encCtx->sample_fmt = sampleFmt;
+    encCtx->sample_rate = rate;
+    av_channel_layout_default(&encCtx->ch_layout, channels);
+    encCtx->bit_rate = format.bitRate;
+    encCtx->time_base = AVRational{1, rate};
+    // FFmpeg's own Opus encoder is still flagged experimental.
+    encCtx->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+    const AVOutputFormat* ofmt = av_guess_format(format.muxer, nullptr, nullptr);
+    if (ofmt && (ofmt->flags & AVFMT_GLOBALHEADER)) encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    AudioOutput out;
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    bool ok = avcodec_open2(encCtx, enc, nullptr) >= 0 && avcodec_parameters_from_context(par, encCtx) >= 0 &&
+              openAudioOutput(out, format, outputPath, par, encCtx->time_base);
+    avcodec_parameters_free(&par);
+    stats.codec = enc->name;
+
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    // PCM takes any frame size; the rest want exactly frame_size, with only
+    // the last frame allowed to be short where the codec says so.
+    int frameSize = encCtx->frame_size > 0 ? encCtx->frame_size : 1024;
+    bool padLast = encCtx->frame_size > 0 && !(enc->capabilities & (AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_VARIABLE_FRAME_SIZE));
+    std::vector<float> samples(static_cast<size_t>(frameSize) * channels);
+    int64_t produced = 0;
+    while (ok) {
+        size_t got = readAudio(*decoder, samples.data(), frameSize);
+        if (got == 0) break;
+        int frames = static_cast<int>(got);
+        if (padLast && frames < frameSize) {
+            std::fill(samples.begin() + got * channels, samples.end(), 0.0f);
+            frames = frameSize;
+        }
+        frame->format = sampleFmt;
+        frame->sample_rate = rate;
+        frame->nb_samples = frames;
+        av_channel_layout_copy(&frame->ch_layout, &encCtx->ch_layout);
+        if (av_frame_get_buffer(frame, 0) < 0) {
+            ok = false;
+            break;
+        }
+        fillEncoderFrame(frame, samples.data(), frames, channels);
+        frame->pts = produced;
+        produced += static_cast<int64_t>(got);
+        ok = avcodec_send_frame(encCtx, frame) >= 0 && drainAudioEncoder(encCtx, out, pkt);
+        av_frame_unref(frame);
+    }
+    if (ok) {
+        avcodec_send_frame(encCtx, nullptr);
+        ok = drainAudioEncoder(encCtx, out, pkt) && av_write_trailer(out.fmtCtx) >= 0;
+    }
+    stats.durationSec = static_cast<double>(produced) / rate;
+
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&encCtx);
+    return ok;
+}
+
+// Muting. Re-encoded stretches reach this far past each range, so their
+// seams with the copied packets fall in unmuted audio where a codec-frame
+// splice is inaudible; the fades keep the mute itself from clicking.
+constexpr double kSpliceMarginSec = 0.1;
+constexpr double kMuteFadeSec = 0.01;
+// Copied packets decoded and encoded ahead of a stretch, so the decoder has
+// settled and the encoder's first kept frame has real audio to overlap with.
+constexpr size_t kPrerollPackets = 2;
+constexpr int64_t kFallbackAudioBitRate = 128000;
+
+double muteGainAt(const std::vector<MuteRange>& ranges, double timeSec) {
+    double gain = 1.0;
+    for (const MuteRange& range : ranges) {
+        if (timeSec >= range.startSec && timeSec < range.endSec) return 0.0;
+        double distance = timeSec < range.startSec ? range.startSec - timeSec : timeSec - range.endSec;
+        gain = std::min(gain, distance / kMuteFadeSec);
+    }
+    return gain;
+}
+
+// Scale the decoded float samples of `frame` by muteGainAt.
+void applyMuteGain(AVFrame* frame, const AVStream* st, const std::vector<MuteRange>& ranges) {
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) return;
+    if (st->start_time != AV_NOPTS_VALUE) pts -= st->start_time;
+    double startSec = pts * av_q2d(st->time_base);
+    double endSec = startSec + static_cast<double>(frame->nb_samples) / frame->sample_rate;
+    bool touched = false;
+    for (const MuteRange& range : ranges) {
+        touched = touched || (range.startSec - kMuteFadeSec < endSec && range.endSec + kMuteFadeSec > startSec);
+    }
+    if (!touched) return;
+    int channels = frame->ch_layout.nb_channels;
+    bool planar = av_sample_fmt_is_planar(static_cast<AVSampleFormat>(frame->format));
+    for (int i = 0; i < frame->nb_samples; ++i) {
+        float gain = static_cast<float>(muteGainAt(ranges, startSec + static_cast<double>(i) / frame->sample_rate));
+        if (gain >= 1.0f) continue;
+        for (int c = 0; c < channels; ++c) {
+            float* sample = planar ? reinterpret_cast<float*>(frame->extended_data[c]) + i
+                                   : reinterpret_cast<float*>(frame->data[0]) + i * channels + c;
+            *sample *= gain;
+        }
+    }
+}
+
+// An encoder for the source's codec that takes the decoder's frames as they
+// are. Always with out-of-band headers, which the track keeps from the
+// source when the packets are spliced.
+AVCodecContext* openSpliceEncoder(const AVCodecContext* decCtx, const AVCodecParameters* par) {
+    const AVCodec* enc = avcodec_find_encoder(par->codec_id);
+    if (!enc) return nullptr;
+    AVCodecContext* encCtx = avcodec_alloc_context3(enc);
+    encCtx->sample_fmt = decCtx->sample_fmt;
+    encCtx->sample_rate = decCtx->sample_rate;
+    av_channel_layout_copy(&encCtx->ch_layout, &decCtx->ch_layout);
+    encCtx->bit_rate = par->bit_rate > 0 ? par->bit_rate : kFallbackAudioBitRate;
+    encCtx->time_base = AVRational{1, decCtx->sample_rate};
+    encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (avcodec_open2(encCtx, enc, nullptr) < 0) avcodec_free_context(&encCtx);
+    return encCtx;
+}
+
+// One muteRanges run. Released on destruction.
+struct MuteSession {
+  const std::vector<MuteRange>* ranges = nullptr;
+  MuteStats* stats = nullptr;
+  AVFormatContext* inFmtCtx = nullptr;
+  AVFormatContext* outFmtCtx = nullptr;
+  // Output stream per input stream, -1 for dropped streams.
+  std::vector<int> streamMap;
+  AVStream* inAudio = nullptr;
+  AVStream* outAudio = nullptr;
+  AVCodecContext* decCtx = nullptr;
+  // Open only inside a re-encoded stretch.
+  AVCodecContext* encCtx = nullptr;
+  // First encoder pts that belongs to the current stretch; what comes out
+  // before it is pre-roll.
+  int64_t stretchStart = 0;
+  std::deque<AVPacket*> recent;
+  AVFrame* frame = nullptr;
+  AVPacket* encPkt = nullptr;
+
+  ~MuteSession() {
+    for (AVPacket*& pkt : recent) av_packet_free(&pkt);
+    av_packet_free(&encPkt);
+    av_frame_free(&frame);
+    if (encCtx) avcodec_free_context(&encCtx);
+    if (decCtx) avcodec_free_context(&decCtx);
+    if (inFmtCtx) avformat_close_input(&inFmtCtx);
+    if (outFmtCtx) {
+      if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
+      avformat_free_context(outFmtCtx);
+    }
+  }
+};
+
+// Write the encoder's packets in [stretchStart, until) to the audio track.
+bool writeStretchPackets(MuteSession& s, int64_t until) {
+    while (avcodec_receive_packet(s.encCtx, s.encPkt) == 0) {
+        if (s.encPkt->pts < s.stretchStart || s.encPkt->pts >= until) {
+            av_packet_unref(s.encPkt);
+            continue;
+        }
+        s.encPkt->stream_index = s.outAudio->index;
+        av_packet_rescale_ts(s.encPkt, s.encCtx->time_base, s.outAudio->time_base);
+        if (av_interleaved_write_frame(s.outFmtCtx, s.encPkt) < 0) return false;
+        s.stats->reencodedPackets++;
+    }
+    return true;
+}
+
+// Decode `pkt`, mute its samples and feed them to the encoder.
+bool reencodePacket(MuteSession& s, const AVPacket* pkt, int64_t until) {
+    if (avcodec_send_packet(s.decCtx, pkt) < 0) {
+        __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Skipping undecodable audio packet");
+        return true;
+    }
+    while (avcodec_receive_frame(s.decCtx, s.frame) == 0) {
+        bool ok = av_frame_make_writable(s.frame) >= 0;
+        if (ok) {
+            applyMuteGain(s.frame, s.inAudio, *s.ranges);
+            s.frame->pts = av_rescale_q(s.frame->best_effort_timestamp, s.inAudio->time_base, s.encCtx->time_base);
+            ok = avcodec_send_frame(s.encCtx, s.frame) >= 0 && writeStretchPackets(s, until);
+        }
+        av_frame_unref(s.frame);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Start re-encoding at the packet with pts startPts (stream time base),
+// priming decoder and encoder with the packets just before it.
+bool beginStretch(MuteSession& s, int64_t startPts) {
+    s.encCtx = openSpliceEncoder(s.decCtx, s.inAudio->codecpar);
+    if (!s.encCtx) return false;
+    avcodec_flush_buffers(s.decCtx);
+    s.stretchStart = s.stats->spliced ? av_rescale_q(startPts, s.inAudio->time_base, s.encCtx->time_base) : INT64_MIN;
+    for (const AVPacket* prev : s.recent) {
+        if (!reencodePacket(s, prev, INT64_MAX)) return false;
+    }
+    return true;
+}
+
+// Finish the stretch before `next`, the first copied packet after it
+// (nullptr at the end of the file). `next` is decoded and encoded as well so
+// the last kept frame overlaps into the real audio that follows.
+bool endStretch(MuteSession& s, const AVPacket* next) {
+    int64_t until = INT64_MAX;
+    bool ok = true;
+    if (next) {
+        until = av_rescale_q(next->pts, s.inAudio->time_base, s.encCtx->time_base);
+        ok = reencodePacket(s, next, until);
+    }
+    if (ok) {
+        avcodec_send_frame(s.encCtx, nullptr);
+        ok = writeStretchPackets(s, until);
+    }
+    avcodec_free_context(&s.encCtx);
+    return ok;
+}
+
+// Packet spans (stream time base) to re-encode: each range plus the splice
+// margin, overlapping ones merged.
+std::vector<std::pair<int64_t, int64_t>> spliceWindows(const std::vector<MuteRange>& ranges, const AVStream* st) {
+    int64_t offset = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    double tb = av_q2d(st->time_base);
+    std::vector<std::pair<int64_t, int64_t>> windows;
+    for (const MuteRange& range : ranges) {
+        int64_t start = offset + static_cast<int64_t>(std::floor((range.startSec - kSpliceMarginSec) / tb));
+        int64_t end = offset + static_cast<int64_t>(std::ceil((range.endSec + kSpliceMarginSec) / tb));
+        if (!windows.empty() && start <= windows.back().second) {
+            windows.back().second = std::max(windows.back().second, end);
+        } else {
+            windows.emplace_back(start, end);
+        }
+    }
+    return windows;
+}
+
+} // namespace
+
+bool extractAudio(const std::string& rawInput, const std::string& rawOutput, const std::string& formatName, AudioExtractStats& stats) {
+    std::string inputPath = stripFileScheme(rawInput);
+    std::string outputPath = stripFileScheme(rawOutput);
+    const AudioFormat* format = findAudioFormat(formatName, outputPath);
+    if (!format) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Unknown audio format '%s'", formatName.c_str());
+        return false;
+    }
+    stats.format = format->name;
+
+    AVFormatContext* inFmtCtx = nullptr;
+    if (avformat_open_input(&inFmtCtx, inputPath.c_str(), nullptr, nullptr) < 0) return false;
+    int streamIndex = -1;
+    if (avformat_find_stream_info(inFmtCtx, nullptr) >= 0) {
+        streamIndex = av_find_best_stream(inFmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    }
+    if (streamIndex < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No audio track in %s", inputPath.c_str());
+        avformat_close_input(&inFmtCtx);
+        return false;
+    }
+    AVStream* inStream = inFmtCtx->streams[streamIndex];
+    for (unsigned int i = 0; i < inFmtCtx->nb_streams; i++) {
+        if (static_cast<int>(i) != streamIndex) inFmtCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    bool ok;
+    const std::vector<AVCodecID>& copyable = format->copyable;
+    if (std::find(copyable.begin(), copyable.end(), inStream->codecpar->codec_id) != copyable.end()) {
+        stats.streamCopied = true;
+        stats.codec = avcodec_get_name(inStream->codecpar->codec_id);
+        if (inStream->duration != AV_NOPTS_VALUE) stats.durationSec = inStream->duration * av_q2d(inStream->time_base);
+        AudioOutput out;
+        ok = openAudioOutput(out, *format, outputPath, inStream->codecpar, inStream->time_base) &&
+             copyAudioPackets(inFmtCtx, streamIndex, out);
+    } else {
+        AVCodecParameters* source = avcodec_parameters_alloc();
+        avcodec_parameters_copy(source, inStream->codecpar);
+        // The decoder opens the file itself; no need to keep two demuxers.
+        avformat_close_input(&inFmtCtx);
+        ok = reencodeAudio(inputPath, source, *format, outputPath, stats);
+        avcodec_parameters_free(&source);
+    }
+    if (inFmtCtx) avformat_close_input(&inFmtCtx);
+
+    struct stat st;
+    if (ok && stat(outputPath.c_str(), &st) == 0) stats.outputBytes = st.st_size;
+    if (!ok) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Audio extraction to %s failed", outputPath.c_str());
+    return ok;
+}
+
+std::vector<MuteRange> parseMuteRanges(const std::string& json) {
+    std::vector<MuteRange> ranges;
+    for (const std::string& obj : splitJsonObjects(json)) {
+        MuteRange range;
+        range.startSec = std::max(0.0, jsonNumber(obj, "startSec", 0));
+        range.endSec = jsonNumber(obj, "endSec", 0);
+        if (range.endSec > range.startSec) ranges.push_back(range);
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const MuteRange& a, const MuteRange& b) { return a.startSec < b.startSec; });
+    return ranges;
+}
+
+bool muteRanges(const std::string& rawInput, const std::string& rawOutput, const std::vector<MuteRange>& ranges, MuteStats& stats) {
+    std::string inputPath = stripFileScheme(rawInput);
+    std::string outputPath = stripFileScheme(rawOutput);
+    MuteSession s;
+    s.ranges = &ranges;
+    s.stats = &stats;
+    if (avformat_open_input(&s.inFmtCtx, inputPath.c_str(), nullptr, nullptr) < 0) return false;
+    if (avformat_find_stream_info(s.inFmtCtx, nullptr) < 0) return false;
+    avformat_alloc_output_context2(&s.outFmtCtx, nullptr, nullptr, outputPath.c_str());
+    if (!s.outFmtCtx) return false;
+
+    const AVCodec* dec = nullptr;
+    int audioIndex = av_find_best_stream(s.inFmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &dec, 0);
+    AVCodecParameters* audioPar = nullptr;
+    if (audioIndex >= 0 && dec) {
+        s.inAudio = s.inFmtCtx->streams[audioIndex];
+        s.decCtx = avcodec_alloc_context3(dec);
+        if (avcodec_parameters_to_context(s.decCtx, s.inAudio->codecpar) < 0) return false;
+        s.decCtx->pkt_timebase = s.inAudio->time_base;
+        if (avcodec_open2(s.decCtx, dec, nullptr) < 0) return false;
+        AVSampleFormat fmt = av_get_packed_sample_fmt(s.decCtx->sample_fmt);
+        AVCodecContext* probe = fmt == AV_SAMPLE_FMT_FLT ? openSpliceEncoder(s.decCtx, s.inAudio->codecpar) : nullptr;
+        if (!probe) {
+            __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "muteRanges: cannot re-encode %s audio",
+                                avcodec_get_name(s.inAudio->codecpar->codec_id));
+            return false;
+        }
+        // Re-encoded packets can only stand in for the originals when they
+        // decode the same way under the source's header. The headers
+        // themselves differ byte for byte even then (FFmpeg's AAC encoder
+        // appends an SBR-absent extension MediaCodec doesn't write), so
+        // compare what they describe; in-band headers, as in ADTS, would
+        // have to be rebuilt per packet.
+        const AVCodecParameters* src = s.inAudio->codecpar;
+        int srcProfile = s.decCtx->profile != AV_PROFILE_UNKNOWN ? s.decCtx->profile : src->profile;
+        int encProfile = probe->profile;
+        if (encProfile == AV_PROFILE_UNKNOWN && probe->codec_id == AV_CODEC_ID_AAC) encProfile = AV_PROFILE_AAC_LOW;
+        int srcFrameSize = src->frame_size > 0 ? src->frame_size : s.decCtx->frame_size;
+        bool sameShape = src->extradata_size > 0 && src->codec_id == probe->codec_id && srcProfile == encProfile &&
+                         src->sample_rate == probe->sample_rate && src->ch_layout.nb_channels == probe->ch_layout.nb_channels &&
+                         (srcFrameSize <= 0 || srcFrameSize == probe->frame_size);
+        stats.spliced = ranges.empty() || sameShape;
+        audioPar = avcodec_parameters_alloc();
+        if (stats.spliced) {
+            avcodec_parameters_copy(audioPar, src);
+        } else {
+            avcodec_parameters_from_context(audioPar, probe);
+        }
+        avcodec_free_context(&probe);
+    }
+
+    // Every video stream plus the main audio track, as muteVideo does for
+    // video alone.
+    s.streamMap.assign(s.inFmtCtx->nb_streams, -1);
+    bool ok = true;
+    for (unsigned int i = 0; i < s.inFmtCtx->nb_streams && ok; i++) {
+        AVStream* inStream = s.inFmtCtx->streams[i];
+        bool audio = static_cast<int>(i) == audioIndex && s.decCtx;
+        if (inStream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO && !audio) {
+            inStream->discard = AVDISCARD_ALL;
+            continue;
+        }
+        AVStream* outStream = avformat_new_stream(s.outFmtCtx, nullptr);
+        ok = outStream && avcodec_parameters_copy(outStream->codecpar, audio ? audioPar : inStream->codecpar) >= 0;
+        if (!ok) break;
+        outStream->codecpar->codec_tag = 0;
+        outStream->time_base = inStream->time_base;
+        s.streamMap[i] = outStream->index;
+        if (audio) s.outAudio = outStream;
+    }
+    avcodec_parameters_free(&audioPar);
+    if (!ok) return false;
+    if (!(s.outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&s.outFmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) return false;
+    }
+    if (avformat_write_header(s.outFmtCtx, nullptr) < 0) return false;
+
+    std::vector<std::pair<int64_t, int64_t>> windows = s.inAudio ? spliceWindows(ranges, s.inAudio) : std::vector<std::pair<int64_t, int64_t>>();
+    size_t window = 0;
+    s.frame = av_frame_alloc();
+    s.encPkt = av_packet_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    while (ok && av_read_frame(s.inFmtCtx, pkt) >= 0) {
+        int outIndex = s.streamMap[pkt->stream_index];
+        if (outIndex < 0) {
+            av_packet_unref(pkt);
+            continue;
+        }
+        AVStream* inStream = s.inFmtCtx->streams[pkt->stream_index];
+        bool copy = true;
+        if (inStream == s.inAudio) {
+            if (pkt->pts == AV_NOPTS_VALUE) pkt->pts = pkt->dts;
+            while (window < windows.size() && windows[window].second <= pkt->pts) window++;
+            bool inside = !stats.spliced ||
+                          (window < windows.size() && pkt->pts + pkt->duration > windows[window].first && pkt->pts < windows[window].second);
+            if (inside && !s.encCtx) ok = beginStretch(s, pkt->pts);
+            if (ok && inside) ok = reencodePacket(s, pkt, INT64_MAX);
+            if (ok && !inside && s.encCtx) ok = endStretch(s, pkt);
+            copy = !inside;
+            if (stats.spliced) {
+                s.recent.push_back(av_packet_clone(pkt));
+                if (s.recent.size() > kPrerollPackets) {
+                    av_packet_free(&s.recent.front());
+                    s.recent.pop_front();
+                }
+            }
+        }
+        if (ok && copy) {
+            pkt->stream_index = outIndex;
+            pkt->pos = -1;
+            av_packet_rescale_ts(pkt, inStream->time_base, s.outFmtCtx->streams[outIndex]->time_base);
+            ok = av_interleaved_write_frame(s.outFmtCtx, pkt) >= 0;
+            if (inStream == s.inAudio) stats.copiedPackets++;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    if (ok && s.encCtx) ok = endStretch(s, nullptr);
+    return ok && av_write_trailer(s.outFmtCtx) >= 0;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+struct AudioExtractStats {
+  std::string format;
+  std::string codec;
+  // True when the packets were copied, false when the track was re-encoded.
+  bool streamCopied = false;
+  double durationSec = 0;
+  int64_t outputBytes = 0;
+};
+
+// Save the best audio track of inputPath to outputPath as "m4a" (AAC in
+// MP4), "aac" (ADTS), "opus" (Ogg Opus) or "wav" (16-bit PCM); an empty
+// format follows the output's extension. The track's packets are copied when
+// its codec is what the container holds, and decoded and re-encoded only
+// otherwise (at most stereo, at the source rate where the encoder allows).
+// Blocking.
+bool extractAudio(const std::string& inputPath, const std::string& outputPath, const std::string& format, AudioExtractStats& stats);
+
+// A stretch of the clip's timeline (seconds from the start) to silence.
+struct MuteRange {
+  double startSec = 0;
+  double endSec = 0;
+};
+
+// Ranges as a JSON array of flat objects: [{"startSec":3.2,"endSec":3.9}].
+// Empty or inverted ranges are dropped.
+std::vector<MuteRange> parseMuteRanges(const std::string& json);
+
+struct MuteStats {
+  int64_t copiedPackets = 0;
+  int64_t reencodedPackets = 0;
+  // False when the encoder's stream setup differs from the source's (e.g.
+  // HE-AAC) and the whole audio track had to be re-encoded.
+  bool spliced = true;
+};
+
+// Copy every video stream of inputPath to outputPath and silence `ranges` in
+// its main audio track (other audio tracks are dropped). Only the audio
+// packets around each range are decoded, muted with short fades and
+// re-encoded with the source codec; they replace the originals packet for
+// packet, and everything else is copied. Blocking.
+bool muteRanges(const std::string& inputPath, const std::string& outputPath, const std::vector<MuteRange>& ranges, MuteStats& stats);
+
+} // namespace facebook::react
@@ -0,0 +1,286 @@
+#include "AudioMixer.h"
+#include "MediaAnalysis.h"
+#include "SimdKernels.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/channel_layout.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+constexpr int kDefaultRate = 48000;
+constexpr int kDefaultChannels = 2;
+constexpr int64_t kDefaultBitRate = 128000;
+
+// Clip audio above this RMS (about -34 dBFS) counts as speech.
+constexpr double kSpeechRms = 0.02;
+// Duck quickly, recover slowly, and hold through the gaps between words so
+// the music doesn't pump.
+constexpr double kDuckAttackSec = 0.08;
+constexpr double kDuckReleaseSec = 0.6;
+constexpr double kDuckHoldSec = 0.35;
+
+// Normalization never pushes the true peak above -1 dBTP (R128's limit for
+// distribution) nor lifts near-silent audio by more than this.
+constexpr double kTruePeakCeilingDbtp = -1.0;
+constexpr double kMaxNormalizeGainDb = 20.0;
+
+// Clip audio goes through atempo in chunks of this many frames.
+constexpr size_t kTempoChunkFrames = 1024;
+
+// abuffer -> atempo -> abuffersink over interleaved float, for playing the
+// clip audio `tempo` times faster at the same pitch.
+AVFilterGraph* openTempoGraph(int rate, int channels, double tempo, AVFilterContext** src, AVFilterContext** sink) {
+    AVFilterGraph* graph = avfilter_graph_alloc();
+    if (!graph) return nullptr;
+    AVChannelLayout layout;
+    av_channel_layout_default(&layout, channels);
+    char layoutName[64];
+    av_channel_layout_describe(&layout, layoutName, sizeof(layoutName));
+    char args[256];
+    snprintf(args, sizeof(args), "sample_rate=%d:sample_fmt=flt:channel_layout=%s:time_base=1/%d", rate, layoutName, rate);
+    char chain[128];
+    snprintf(chain, sizeof(chain), "atempo=%.6f,aformat=sample_fmts=flt", tempo);
+    AVFilterInOut* outputs = avfilter_inout_alloc();
+    AVFilterInOut* inputs = avfilter_inout_alloc();
+    int ret = avfilter_graph_create_filter(src, avfilter_get_by_name("abuffer"), "in", args, nullptr, graph);
+    if (ret >= 0) ret = avfilter_graph_create_filter(sink, avfilter_get_by_name("abuffersink"), "out", nullptr, nullptr, graph);
+    if (ret >= 0) {
+        outputs->name = av_strdup("in");
+        outputs->filter_ctx = *src;
+        inputs->name = av_strdup("out");
+        inputs->filter_ctx = *sink;
+        ret = avfilter_graph_parse_ptr(graph, chain, &inputs, &outputs, nullptr);
+    }
+    if (ret >= 0) ret = avfilter_graph_config(graph, nullptr);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to set up %s", chain);
+        avfilter_graph_free(&graph);
+    }
+    return graph;
+}
+
+} // namespace
+
+std::unique_ptr<AudioMixer> AudioMixer::open(const EditPlan& plan, double durationSec, const AVCodecParameters* like) {
+    std::unique_ptr<AudioMixer> mixer(new AudioMixer());
+    mixer->bed_ = plan.music;
+    int rate = like && like->sample_rate > 0 ? like->sample_rate : kDefaultRate;
+    int channels = like && like->ch_layout.nb_channels > 0 ? like->ch_layout.nb_channels : kDefaultChannels;
+    mixer->sampleRate_ = rate;
+    mixer->channels_ = channels;
+    mixer->totalFrames_ = static_cast<int64_t>(std::llround(std::max(0.0, durationSec) * rate));
+
+    // Past kMaxAudioStretchSpeed the clip audio is dropped, leaving the
+    // music (if any) on its own.
+    if (plan.speed <= kMaxAudioStretchSpeed) mixer->clip_ = openAudioDecoder(plan.inputPath, rate, channels);
+    if (mixer->clip_ && plan.startSec > 0) seekAudio(*mixer->clip_, plan.startSec);
+    if (mixer->clip_ && plan.speed > 1) {
+        mixer->tempoGraph_ = openTempoGraph(rate, channels, plan.speed, &mixer->tempoSrc_, &mixer->tempoSink_);
+        if (!mixer->tempoGraph_) return nullptr;
+        mixer->tempoFrame_ = av_frame_alloc();
+    }
+    if (mixer->clip_ && plan.normalizeLufs < 0) {
+        LoudnessStats loudness;
+        loudness.integratedLufs = plan.loudnessLufs;
+        loudness.truePeakDbtp = plan.loudnessTruePeakDbtp;
+        if (plan.loudnessLufs >= 0) {
+            // Costs an audio-only pass; callers that ran analyzeLoudness
+            // pass the result in the plan instead.
+            __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Measuring loudness of %s before export", plan.inputPath.c_str());
+            if (!measureLoudness(plan.inputPath, loudness)) loudness.integratedLufs = plan.normalizeLufs;
+        }
+        double gainDb = std::min(plan.normalizeLufs - loudness.integratedLufs, kTruePeakCeilingDbtp - loudness.truePeakDbtp);
+        mixer->clipGainDb_ = std::min(gainDb, kMaxNormalizeGainDb);
+        mixer->clipGain_ = static_cast<float>(std::pow(10.0, mixer->clipGainDb_ / 20.0));
+    }
+    if (!plan.music.path.empty()) {
+        mixer->music_ = openAudioDecoder(plan.music.path, rate, channels);
+        if (!mixer->music_) {
+            __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open music %s", plan.music.path.c_str());
+            return nullptr;
+        }
+        if (plan.music.offsetSec > 0) seekAudio(*mixer->music_, plan.music.offsetSec);
+    }
+
+    const AVCodec* enc = avcodec_find_encoder(like ? like->codec_id : AV_CODEC_ID_AAC);
+    if (!enc) return nullptr;
+    mixer->encCtx_ = avcodec_alloc_context3(enc);
+    AVCodecContext* encCtx = mixer->encCtx_;
+    encCtx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    encCtx->sample_rate = rate;
+    av_channel_layout_default(&encCtx->ch_layout, channels);
+    encCtx->bit_rate = like && like->bit_rate > 0 ? like->bit_rate : kDefaultBitRate;
+    encCtx->time_base = AVRational{1, rate};
+    // Every output is MP4, which wants the AudioSpecificConfig up front.
+    encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    if (avcodec_open2(encCtx, enc, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open %s encoder", enc->name);
+        return nullptr;
+    }
+    mixer->encFrame_ = av_frame_alloc();
+    mixer->pkt_ = av_packet_alloc();
+    return mixer;
+}
+
+AudioMixer::~AudioMixer() {
+    av_frame_free(&tempoFrame_);
+    avfilter_graph_free(&tempoGraph_);
+    av_packet_free(&pkt_);
+    av_frame_free(&encFrame_);
+    if (encCtx_) avcodec_free_context(&encCtx_);
+}
+
+double AudioMixer::fadeGainAt(double timeSec) const {
+    double gain = 1.0;
+    if (bed_.fadeInSec > 0) gain = std::min(gain, timeSec / bed_.fadeInSec);
+    double remaining = static_cast<double>(totalFrames_) / sampleRate_ - timeSec;
+    if (bed_.fadeOutSec > 0) gain = std::min(gain, remaining / bed_.fadeOutSec);
+    return std::max(0.0, gain);
+}
+
+bool AudioMixer::drainEncoder(const PacketSink& onPacket) {
+    while (avcodec_receive_packet(encCtx_, pkt_) == 0) {
+        bool ok = onPacket(pkt_);
+        av_packet_unref(pkt_);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+size_t AudioMixer::readClip(float* dst, size_t frames) {
+    if (!tempoGraph_) return readAudio(*clip_, dst, frames);
+    size_t written = 0;
+    while (written < frames) {
+        size_t available = (tempoPending_.size() - tempoOffset_) / channels_;
+        if (available > 0) {
+            size_t n = std::min(available, frames - written);
+            std::copy_n(tempoPending_.data() + tempoOffset_, n * channels_, dst + written * channels_);
+            tempoOffset_ += n * channels_;
+            written += n;
+            continue;
+        }
+        tempoPending_.clear();
+        tempoOffset_ = 0;
+        int ret = av_buffersink_get_frame(tempoSink_, tempoFrame_);
+        if (ret >= 0) {
+            const float* samples = reinterpret_cast<const float*>(tempoFrame_->data[0]);
+            tempoPending_.assign(samples, samples + static_cast<size_t>(tempoFrame_->nb_samples) * channels_);
+            av_frame_unref(tempoFrame_);
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN) || tempoFlushed_) break;
+
+        // atempo wants more input: feed it the next chunk of the clip.
+        AVFrame* input = av_frame_alloc();
+        input->format = AV_SAMPLE_FMT_FLT;
+        input->sample_rate = sampleRate_;
+        input->nb_samples = static_cast<int>(kTempoChunkFrames);
+        av_channel_layout_default(&input->ch_layout, channels_);
+        if (av_frame_get_buffer(input, 0) < 0) {
+            av_frame_free(&input);
+            break;
+        }
+        size_t got = readAudio(*clip_, reinterpret_cast<float*>(input->data[0]), kTempoChunkFrames);
+        input->nb_samples = static_cast<int>(got);
+        input->pts = tempoInputFrames_;
+        tempoInputFrames_ += static_cast<int64_t>(got);
+        if (got == 0) {
+            tempoFlushed_ = true;
+            ret = av_buffersrc_add_frame(tempoSrc_, nullptr);
+        } else {
+            ret = av_buffersrc_add_frame(tempoSrc_, input);
+        }
+        av_frame_free(&input);
+        if (ret < 0) break;
+    }
+    return written;
+}
+
+bool AudioMixer::mixChunk(size_t frames, const PacketSink& onPacket) {
+    size_t samples = frames * channels_;
+    mix_.assign(samples, 0.0f);
+    if (clip_ && clipGain_ == 1.0f) {
+        readClip(mix_.data(), frames);
+    } else if (clip_) {
+        clipChunk_.assign(samples, 0.0f);
+        readClip(clipChunk_.data(), frames);
+        mixWithGainRamp(mix_.data(), clipChunk_.data(), samples, clipGain_, clipGain_);
+    }
+
+    double chunkSec = static_cast<double>(frames) / sampleRate_;
+    double startSec = static_cast<double>(producedFrames_) / sampleRate_;
+    if (music_) {
+        // Duck towards duckGain while the clip is loud, linearly over the
+        // attack/release time.
+        float lo = 0;
+        float hi = 0;
+        double sumSq = 0;
+        reducePeaks(mix_.data(), samples, lo, hi, sumSq);
+        bool loud = std::sqrt(sumSq / samples) > kSpeechRms;
+        holdSec_ = loud ? kDuckHoldSec : std::max(0.0, holdSec_ - chunkSec);
+        double target = bed_.ducking && holdSec_ > 0 ? bed_.duckGain : 1.0;
+        double range = 1.0 - bed_.duckGain;
+        double duckEnd = duck_;
+        if (target < duck_) duckEnd = std::max(target, duck_ - range * chunkSec / kDuckAttackSec);
+        if (target > duck_) duckEnd = std::min(target, duck_ + range * chunkSec / kDuckReleaseSec);
+        if (duckEnd < 1.0) duckedSec_ += chunkSec;
+
+        musicChunk_.assign(samples, 0.0f);
+        readAudio(*music_, musicChunk_.data(), frames);
+        float gainStart = static_cast<float>(bed_.volume * fadeGainAt(startSec) * duck_);
+        float gainEnd = static_cast<float>(bed_.volume * fadeGainAt(startSec + chunkSec) * duckEnd);
+        mixWithGainRamp(mix_.data(), musicChunk_.data(), samples, gainStart, gainEnd);
+        duck_ = duckEnd;
+    }
+
+    if (encFrame_->nb_samples != static_cast<int>(frames) || !encFrame_->buf[0]) {
+        av_frame_unref(encFrame_);
+        encFrame_->format = encCtx_->sample_fmt;
+        encFrame_->sample_rate = sampleRate_;
+        encFrame_->nb_samples = static_cast<int>(frames);
+        av_channel_layout_copy(&encFrame_->ch_layout, &encCtx_->ch_layout);
+        if (av_frame_get_buffer(encFrame_, 0) < 0) return false;
+    } else if (av_frame_make_writable(encFrame_) < 0) {
+        return false;
+    }
+    for (int c = 0; c < channels_; ++c) {
+        float* plane = reinterpret_cast<float*>(encFrame_->extended_data[c]);
+        for (size_t i = 0; i < frames; ++i) plane[i] = mix_[i * channels_ + c];
+    }
+    encFrame_->pts = producedFrames_;
+    producedFrames_ += static_cast<int64_t>(frames);
+    if (avcodec_send_frame(encCtx_, encFrame_) < 0) return false;
+    return drainEncoder(onPacket);
+}
+
+bool AudioMixer::advanceTo(double timeSec, const PacketSink& onPacket) {
+    int64_t limit = std::min(totalFrames_, static_cast<int64_t>(timeSec * sampleRate_));
+    size_t frameSize = static_cast<size_t>(encCtx_->frame_size);
+    while (producedFrames_ + static_cast<int64_t>(frameSize) <= limit) {
+        if (!mixChunk(frameSize, onPacket)) return false;
+    }
+    return true;
+}
+
+bool AudioMixer::finish(const PacketSink& onPacket) {
+    size_t frameSize = static_cast<size_t>(encCtx_->frame_size);
+    while (producedFrames_ < totalFrames_) {
+        size_t frames = static_cast<size_t>(std::min<int64_t>(frameSize, totalFrames_ - producedFrames_));
+        if (!mixChunk(frames, onPacket)) return false;
+    }
+    avcodec_send_frame(encCtx_, nullptr);
+    return drainEncoder(onPacket);
+}
+
+} // namespace facebook::react
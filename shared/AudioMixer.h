@@ -0,0 +1,86 @@
+#pragma once
+
+#include "AudioDecoder.h"
+#include "EditPlan.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+}
+
+namespace facebook::react {
+
+// Produces an export's one AAC track: the clip's own audio over the plan's
+// trim, with the music bed (volume, fades) mixed under it and ducked while
+// the clip audio is loud. The clip audio can be normalized to a target
+// loudness on the way through, and time-stretched (pitch kept) when the plan
+// speeds the clip up. The export's decode loop advances it
+// alongside the video, so audio is made in the same pass and encoded once
+// however many outputs receive it.
+class AudioMixer {
+public:
+  // Gets each encoded packet (time base: encoder()->time_base).
+  using PacketSink = std::function<bool(AVPacket*)>;
+
+  // durationSec is the output length. The track is 48 kHz stereo AAC unless
+  // `like` asks for another codec, rate and channel count (to match an
+  // existing stream). Returns nullptr if the encoder or the music cannot be
+  // opened; a clip without audio contributes silence.
+  static std::unique_ptr<AudioMixer> open(const EditPlan& plan, double durationSec, const AVCodecParameters* like = nullptr);
+  ~AudioMixer();
+
+  const AVCodecContext* encoder() const { return encCtx_; }
+  double duckedSec() const { return duckedSec_; }
+  // Gain applied to the clip audio for loudness normalization.
+  double clipGainDb() const { return clipGainDb_; }
+
+  // Mix and encode everything up to timeSec of the output timeline.
+  bool advanceTo(double timeSec, const PacketSink& onPacket);
+  // Mix the rest up to the duration and drain the encoder.
+  bool finish(const PacketSink& onPacket);
+
+private:
+  AudioMixer() = default;
+  bool mixChunk(size_t frames, const PacketSink& onPacket);
+  size_t readClip(float* dst, size_t frames);
+  bool drainEncoder(const PacketSink& onPacket);
+  double fadeGainAt(double timeSec) const;
+
+  MusicBed bed_;
+  std::unique_ptr<AudioDecoder> clip_;
+  std::unique_ptr<AudioDecoder> music_;
+  AVCodecContext* encCtx_ = nullptr;
+  AVFrame* encFrame_ = nullptr;
+  AVPacket* pkt_ = nullptr;
+  // atempo graph between clip_ and the mix when the plan has a speed-up,
+  // with its output not handed out yet.
+  AVFilterGraph* tempoGraph_ = nullptr;
+  AVFilterContext* tempoSrc_ = nullptr;
+  AVFilterContext* tempoSink_ = nullptr;
+  AVFrame* tempoFrame_ = nullptr;
+  std::vector<float> tempoPending_;
+  size_t tempoOffset_ = 0;
+  int64_t tempoInputFrames_ = 0;
+  bool tempoFlushed_ = false;
+
+  int sampleRate_ = 0;
+  int channels_ = 0;
+  int64_t producedFrames_ = 0;
+  int64_t totalFrames_ = 0;
+  float clipGain_ = 1.0f;
+  double clipGainDb_ = 0;
+  std::vector<float> mix_;
+  std::vector<float> clipChunk_;
+  std::vector<float> musicChunk_;
+  // Ducking envelope: current gain (1 = not ducked) and how long to keep
+  // it down after the clip audio last went loud.
+  double duck_ = 1.0;
+  double holdSec_ = 0;
+  double duckedSec_ = 0;
+};
+
+} // namespace facebook::react
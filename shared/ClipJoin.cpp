@@ -0,0 +1,725 @@
+#include "ClipJoin.h"
+#include "AudioMixer.h"
+#include "ExportProfile.h"
+#include "MediaUtils.h"
+#include "SimdKernels.h"
+#include <android/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sys/stat.h>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Re-encoded audio is mixed this far ahead of the video it goes with, as in
+// exports, so the muxer interleaves without buffering much.
+constexpr double kAudioLeadSec = 0.5;
+// The outgoing clip's transition frames are held decoded until the incoming
+// clip's arrive; transitions are shortened to keep them under this. That is
+// about a second of 1080p30, but only a quarter of one at 4K.
+constexpr int64_t kMaxHeldBytes = 96 << 20;
+
+bool sameExtradata(const AVCodecParameters* a, const AVCodecParameters* b) {
+    return a->extradata_size == b->extradata_size && (a->extradata_size == 0 || memcmp(a->extradata, b->extradata, a->extradata_size) == 0);
+}
+
+// Whether a clip's packets can go into a track described by `ref` as they
+// are. Equal extradata means equal SPS/PPS (video) or AudioSpecificConfig
+// (audio), which covers profile, level and the like.
+bool streamsMatch(const AVCodecParameters* ref, const AVCodecParameters* clip) {
+    if (ref->codec_id != clip->codec_id || !sameExtradata(ref, clip)) return false;
+    if (ref->codec_type == AVMEDIA_TYPE_VIDEO) {
+        return ref->width == clip->width && ref->height == clip->height && ref->format == clip->format;
+    }
+    return ref->sample_rate == clip->sample_rate && ref->ch_layout.nb_channels == clip->ch_layout.nb_channels;
+}
+
+void appendNal(const uint8_t* nal, size_t size, int lengthSize, std::vector<uint8_t>& out) {
+    for (int b = lengthSize - 1; b >= 0; --b) out.push_back(static_cast<uint8_t>(size >> (8 * b)));
+    out.insert(out.end(), nal, nal + size);
+}
+
+// Annex B (start codes, as the encoder emits without a global header) to
+// the length-prefixed NAL units of an avcC track.
+void annexBToLengthPrefixed(const uint8_t* data, int size, int lengthSize, std::vector<uint8_t>& out) {
+    auto startCodeAt = [&](int from) {
+        for (int i = from; i + 3 <= size; ++i) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) return i;
+        }
+        return size;
+    };
+    out.clear();
+    int start = startCodeAt(0);
+    while (start < size) {
+        int nal = start + 3;
+        int next = startCodeAt(nal);
+        // The zero byte of a 4-byte start code belongs to the next one.
+        int nalEnd = next;
+        while (nalEnd > nal && data[nalEnd - 1] == 0) nalEnd--;
+        appendNal(data + nal, nalEnd - nal, lengthSize, out);
+        start = next;
+    }
+}
+
+// The SPS and PPS of an avcC record as length-prefixed NAL units.
+std::vector<uint8_t> avccParameterSets(const AVCodecParameters* par, int lengthSize) {
+    std::vector<uint8_t> out;
+    if (par->extradata_size < 7) return out;
+    const uint8_t* p = par->extradata + 5;
+    const uint8_t* end = par->extradata + par->extradata_size;
+    for (int kind = 0; kind < 2 && p < end; ++kind) {
+        int count = kind == 0 ? (*p++ & 0x1f) : *p++;
+        for (int i = 0; i < count && p + 2 <= end; ++i) {
+            size_t size = (static_cast<size_t>(p[0]) << 8) | p[1];
+            p += 2;
+            if (p + size > end) return {};
+            appendNal(p, size, lengthSize, out);
+            p += size;
+        }
+    }
+    return out;
+}
+
+bool setPacketPayload(AVPacket* pkt, const std::vector<uint8_t>& data) {
+    AVBufferRef* buf = av_buffer_alloc(data.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!buf) return false;
+    memcpy(buf->data, data.data(), data.size());
+    memset(buf->data + data.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    av_buffer_unref(&pkt->buf);
+    pkt->buf = buf;
+    pkt->data = buf->data;
+    pkt->size = static_cast<int>(data.size());
+    return true;
+}
+
+// The joined file and where on its timeline the current clip goes.
+struct ConcatOutput {
+  AVFormatContext* fmtCtx = nullptr;
+  AVStream* video = nullptr;
+  AVStream* audio = nullptr;
+  // Start of the current clip, and the furthest any track has reached
+  // (AV_TIME_BASE).
+  int64_t clipOffset = 0;
+  int64_t end = 0;
+  // Per track (video, audio): the last dts written, and how far the current
+  // run of packets is pushed back to keep dts increasing (a clip with
+  // B-frames starts with a dts before its first pts).
+  int64_t lastDts[2] = {AV_NOPTS_VALUE, AV_NOPTS_VALUE};
+  int64_t shift[2] = {};
+
+  ~ConcatOutput() {
+    if (fmtCtx) {
+      if (!(fmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&fmtCtx->pb);
+      avformat_free_context(fmtCtx);
+    }
+  }
+};
+
+// Write a packet timed in srcTb onto the joined timeline at `offset`
+// (AV_TIME_BASE).
+bool writeJoined(ConcatOutput& out, AVPacket* pkt, AVRational srcTb, AVStream* st, int64_t offset) {
+    int track = st == out.video ? 0 : 1;
+    av_packet_rescale_ts(pkt, srcTb, st->time_base);
+    int64_t shift = av_rescale_q(offset, AV_TIME_BASE_Q, st->time_base) + out.shift[track];
+    if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += shift;
+    pkt->dts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts + shift : pkt->pts;
+    if (out.lastDts[track] != AV_NOPTS_VALUE && pkt->dts <= out.lastDts[track]) {
+        int64_t bump = out.lastDts[track] + 1 - pkt->dts;
+        out.shift[track] += bump;
+        pkt->dts += bump;
+        if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += bump;
+    }
+    out.lastDts[track] = pkt->dts;
+    int64_t endTs = (pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts) + pkt->duration;
+    out.end = std::max(out.end, av_rescale_q(endTs, st->time_base, AV_TIME_BASE_Q));
+    pkt->stream_index = st->index;
+    pkt->pos = -1;
+    return av_interleaved_write_frame(out.fmtCtx, pkt) >= 0;
+}
+
+// Bytes per row and rows of each plane of an 8-bit format.
+struct PlaneLayout {
+  int planes = 0;
+  int rowBytes[4] = {};
+  int rows[4] = {};
+};
+
+// False for formats the byte-wise blend can't handle (deeper than 8 bits,
+// palettes, bitstreams).
+bool planeLayoutFor(AVPixelFormat pixFmt, int width, int height, PlaneLayout& layout) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pixFmt);
+    if (!desc || desc->comp[0].depth != 8 || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))) return false;
+    if (av_image_fill_linesizes(layout.rowBytes, pixFmt, width) < 0) return false;
+    layout.planes = av_pix_fmt_count_planes(pixFmt);
+    for (int p = 0; p < layout.planes; ++p) {
+        layout.rows[p] = p == 1 || p == 2 ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+    }
+    return true;
+}
+
+// A frame of the outgoing clip inside a transition window, timed from the
+// start of the window.
+struct HeldFrame {
+  double timeSec = 0;
+  AVFrame* frame = nullptr;
+};
+
+void releaseHeld(std::vector<HeldFrame>& frames) {
+    for (HeldFrame& held : frames) av_frame_free(&held.frame);
+    frames.clear();
+}
+
+// Re-encodes the stretches of the joined video that aren't copied. Frames
+// arrive in the reference size and encoder format with timeline pts (the
+// output stream's time base); each stretch gets its own encoder so it
+// starts on an IDR with its parameter sets in band. The encoder keeps to the
+// reference's profile and level, and to no B-frames if it has none, so
+// players that sized themselves from the track's avcC cope with it.
+struct VideoSplicer {
+  const AVCodecParameters* ref = nullptr;
+  const ExportProfile* profile = nullptr;
+  AVPixelFormat pixFmt = AV_PIX_FMT_YUV420P;
+  AVRational frameRate{30, 1};
+  // NAL length size of the track's avcC (0 keeps Annex B) and its SPS/PPS,
+  // resent on the first copied keyframe after a re-encoded stretch so the
+  // decoder drops the encoder's parameter sets again.
+  int lengthSize = 0;
+  std::vector<uint8_t> paramSets;
+  bool paramsReplaced = false;
+  // False when no encoder here produces the reference codec: clips must
+  // then match and transitions become cuts.
+  bool canEncode = false;
+  bool canBlend = false;
+  // Longest transition whose held frames fit in kMaxHeldBytes.
+  double maxTransitionSec = 0;
+  PlaneLayout layout;
+  AVFrame* black = nullptr;
+  AVCodecContext* encCtx = nullptr;
+  AVPacket* pkt = nullptr;
+  std::vector<uint8_t> nals;
+  // The previous clip's frames for the transition into the current clip,
+  // and the current clip's for the one out of it.
+  std::vector<HeldFrame> incoming;
+  std::vector<HeldFrame> outgoing;
+
+  ~VideoSplicer() {
+    releaseHeld(incoming);
+    releaseHeld(outgoing);
+    av_frame_free(&black);
+    av_packet_free(&pkt);
+    if (encCtx) avcodec_free_context(&encCtx);
+  }
+};
+
+AVCodecContext* openSpliceEncoder(const VideoSplicer& s, AVRational timeBase) {
+    return openProfileEncoder(*s.profile, s.ref->width, s.ref->height, s.ref->sample_aspect_ratio, s.pixFmt, timeBase, s.frameRate,
+                              false, nullptr, s.ref);
+}
+
+bool setupSplicer(VideoSplicer& s, const AVCodecParameters* ref, AVRational frameRate) {
+    s.ref = ref;
+    s.profile = findExportProfile("high-quality");
+    if (!s.profile) s.profile = &exportProfiles().front();
+    AVPixelFormat refFormat = static_cast<AVPixelFormat>(ref->format);
+    s.pixFmt = profileAcceptsPixelFormat(*s.profile, refFormat) ? refFormat : AV_PIX_FMT_YUV420P;
+    if (frameRate.num > 0 && frameRate.den > 0) s.frameRate = frameRate;
+    if (ref->codec_id == AV_CODEC_ID_H264 && ref->extradata_size > 4 && ref->extradata[0] == 1) {
+        s.lengthSize = (ref->extradata[4] & 3) + 1;
+        s.paramSets = avccParameterSets(ref, s.lengthSize);
+    }
+    s.pkt = av_packet_alloc();
+
+    AVCodecContext* probe = openSpliceEncoder(s, AVRational{1, 90000});
+    s.canEncode = probe && probe->codec_id == ref->codec_id;
+    if (probe) avcodec_free_context(&probe);
+    if (!s.canEncode) {
+        __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "concat: cannot encode %s, clips can only be copied", avcodec_get_name(ref->codec_id));
+        return true;
+    }
+    s.canBlend = planeLayoutFor(s.pixFmt, ref->width, ref->height, s.layout);
+    if (s.canBlend) {
+        int frameBytes = av_image_get_buffer_size(s.pixFmt, ref->width, ref->height, 1);
+        if (frameBytes > 0) s.maxTransitionSec = static_cast<double>(kMaxHeldBytes) / frameBytes / av_q2d(s.frameRate);
+        s.black = av_frame_alloc();
+        s.black->format = s.pixFmt;
+        s.black->width = ref->width;
+        s.black->height = ref->height;
+        if (av_frame_get_buffer(s.black, 0) < 0) return false;
+        ptrdiff_t linesizes[4];
+        for (int p = 0; p < 4; ++p) linesizes[p] = s.black->linesize[p];
+        AVColorRange range = ref->color_range == AVCOL_RANGE_JPEG ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        av_image_fill_black(s.black->data, linesizes, s.pixFmt, range, ref->width, ref->height);
+    }
+    return true;
+}
+
+AVFrame* allocSpliceFrame(const VideoSplicer& s) {
+    AVFrame* frame = av_frame_alloc();
+    frame->format = s.pixFmt;
+    frame->width = s.ref->width;
+    frame->height = s.ref->height;
+    if (av_frame_get_buffer(frame, 0) < 0) av_frame_free(&frame);
+    return frame;
+}
+
+bool drainSplicer(VideoSplicer& s, ConcatOutput& out) {
+    while (avcodec_receive_packet(s.encCtx, s.pkt) == 0) {
+        bool ok = true;
+        if (s.lengthSize > 0) {
+            annexBToLengthPrefixed(s.pkt->data, s.pkt->size, s.lengthSize, s.nals);
+            ok = setPacketPayload(s.pkt, s.nals);
+        }
+        ok = ok && writeJoined(out, s.pkt, s.encCtx->time_base, out.video, 0);
+        av_packet_unref(s.pkt);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool encodeSpliced(VideoSplicer& s, ConcatOutput& out, AVFrame* frame, ConcatStats& stats) {
+    if (!s.encCtx) {
+        s.encCtx = openSpliceEncoder(s, out.video->time_base);
+        if (!s.encCtx) return false;
+        out.shift[0] = 0;
+        s.paramsReplaced = true;
+    }
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+    frame->pts = av_rescale_q(frame->pts, out.video->time_base, s.encCtx->time_base);
+    if (avcodec_send_frame(s.encCtx, frame) < 0) return false;
+    stats.reencodedVideoFrames++;
+    return drainSplicer(s, out);
+}
+
+// End the current re-encoded stretch, if any.
+bool closeSplicer(VideoSplicer& s, ConcatOutput& out) {
+    if (!s.encCtx) return true;
+    avcodec_send_frame(s.encCtx, nullptr);
+    bool ok = drainSplicer(s, out);
+    avcodec_free_context(&s.encCtx);
+    return ok;
+}
+
+// Write frame `progress` (0..1) of a transition from `from` to `to` into
+// dst; all three are in the splicer's size and format.
+void renderTransition(const VideoSplicer& s, const std::string& type, double progress, const AVFrame* from, const AVFrame* to, AVFrame* dst) {
+    auto weight = [](double p) { return static_cast<uint32_t>(std::lround(std::min(1.0, std::max(0.0, p)) * 256)); };
+    int width = s.ref->width;
+    // Slide edge in luma pixels, even so chroma stays on whole samples.
+    int edge = static_cast<int>(width * (1.0 - progress)) & ~1;
+    for (int p = 0; p < s.layout.planes; ++p) {
+        int bytes = s.layout.rowBytes[p];
+        int split = static_cast<int>(static_cast<int64_t>(bytes) * edge / width);
+        for (int y = 0; y < s.layout.rows[p]; ++y) {
+            const uint8_t* a = from->data[p] + static_cast<ptrdiff_t>(y) * from->linesize[p];
+            const uint8_t* b = to->data[p] + static_cast<ptrdiff_t>(y) * to->linesize[p];
+            const uint8_t* k = s.black->data[p] + static_cast<ptrdiff_t>(y) * s.black->linesize[p];
+            uint8_t* d = dst->data[p] + static_cast<ptrdiff_t>(y) * dst->linesize[p];
+            if (type == "slide") {
+                // The incoming clip pushes the outgoing one off to the left.
+                memcpy(d, a + bytes - split, split);
+                memcpy(d + split, b, bytes - split);
+            } else if (type == "dipToBlack") {
+                if (progress < 0.5) {
+                    blendBytes(a, k, d, bytes, weight(progress * 2));
+                } else {
+                    blendBytes(k, b, d, bytes, weight(progress * 2 - 1));
+                }
+            } else {
+                blendBytes(a, b, d, bytes, weight(progress));
+            }
+        }
+    }
+}
+
+// The outgoing frame to blend with an incoming one `timeSec` into the window.
+const AVFrame* heldFrameAt(const std::vector<HeldFrame>& frames, double timeSec) {
+    const HeldFrame* best = &frames.front();
+    for (const HeldFrame& held : frames) {
+        if (held.timeSec > timeSec + 1e-3) break;
+        best = &held;
+    }
+    return best->frame;
+}
+
+struct ClipDecoder {
+  AVCodecContext* decCtx = nullptr;
+  SwsContext* sws = nullptr;
+  AVFrame* frame = nullptr;
+
+  ~ClipDecoder() {
+    sws_freeContext(sws);
+    av_frame_free(&frame);
+    if (decCtx) avcodec_free_context(&decCtx);
+  }
+};
+
+bool openClipDecoder(ClipDecoder& dec, const AVStream* stream) {
+    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) return false;
+    dec.decCtx = avcodec_alloc_context3(codec);
+    if (avcodec_parameters_to_context(dec.decCtx, stream->codecpar) < 0) return false;
+    dec.decCtx->pkt_timebase = stream->time_base;
+    dec.decCtx->thread_type = FF_THREAD_FRAME;
+    dec.frame = av_frame_alloc();
+    return avcodec_open2(dec.decCtx, codec, nullptr) >= 0;
+}
+
+// The decoded frame in the splicer's size and format, as a new frame.
+AVFrame* toSpliceFormat(ClipDecoder& dec, const VideoSplicer& s, const AVFrame* frame) {
+    if (frame->width == s.ref->width && frame->height == s.ref->height && frame->format == s.pixFmt) return av_frame_clone(frame);
+    dec.sws = sws_getCachedContext(dec.sws, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                   s.ref->width, s.ref->height, s.pixFmt, SWS_BICUBIC, nullptr, nullptr, nullptr);
+    AVFrame* scaled = dec.sws ? allocSpliceFrame(s) : nullptr;
+    if (!scaled) return nullptr;
+    sws_scale(dec.sws, frame->data, frame->linesize, 0, frame->height, scaled->data, scaled->linesize);
+    av_frame_copy_props(scaled, frame);
+    return scaled;
+}
+
+// Send `pkt` (nullptr flushes) and hand every decoded frame to onFrame.
+bool decodeClip(ClipDecoder& dec, const AVPacket* pkt, const std::function<bool(AVFrame*)>& onFrame) {
+    if (avcodec_send_packet(dec.decCtx, pkt) < 0 && pkt) return true;
+    while (avcodec_receive_frame(dec.decCtx, dec.frame) == 0) {
+        bool ok = onFrame(dec.frame);
+        av_frame_unref(dec.frame);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+struct InputFile {
+  AVFormatContext* fmtCtx = nullptr;
+
+  ~InputFile() {
+    if (fmtCtx) avformat_close_input(&fmtCtx);
+  }
+};
+
+bool openInput(InputFile& in, const std::string& path) {
+    if (avformat_open_input(&in.fmtCtx, path.c_str(), nullptr, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open input: %s", path.c_str());
+        return false;
+    }
+    return avformat_find_stream_info(in.fmtCtx, nullptr) >= 0;
+}
+
+// Append one clip. `into` is the transition from the previous clip (its
+// duration already settled); `next` is the one out of this clip, shortened
+// here to what the clip can give.
+bool appendClip(ConcatOutput& out, VideoSplicer& splicer, const std::string& path, const ClipTransition& into, ClipTransition& next,
+                const AVCodecParameters* refAudio, KeyframeIndexStore& keyframeIndexes, ConcatStats& stats) {
+    InputFile in;
+    if (!openInput(in, path)) return false;
+    int videoIndex = av_find_best_stream(in.fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    int audioIndex = refAudio ? av_find_best_stream(in.fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0) : -1;
+    if (videoIndex < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "concat: no video in %s", path.c_str());
+        return false;
+    }
+    for (unsigned int i = 0; i < in.fmtCtx->nb_streams; i++) {
+        if (static_cast<int>(i) != videoIndex && static_cast<int>(i) != audioIndex) in.fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+    AVStream* videoIn = in.fmtCtx->streams[videoIndex];
+    AVStream* audioIn = audioIndex >= 0 ? in.fmtCtx->streams[audioIndex] : nullptr;
+    int64_t start = in.fmtCtx->start_time != AV_NOPTS_VALUE ? in.fmtCtx->start_time : 0;
+    int64_t videoStart = av_rescale_q(start, AV_TIME_BASE_Q, videoIn->time_base);
+    int64_t audioStart = audioIn ? av_rescale_q(start, AV_TIME_BASE_Q, audioIn->time_base) : 0;
+    double durationSec = videoIn->duration != AV_NOPTS_VALUE ? videoIn->duration * av_q2d(videoIn->time_base)
+                                                              : static_cast<double>(std::max<int64_t>(0, in.fmtCtx->duration)) / AV_TIME_BASE;
+
+    // The window into this clip is [0, inSec); the one out of it starts at
+    // cutSec, where the next clip takes over the timeline.
+    double inSec = into.durationSec;
+    if (next.type == "cut" || !splicer.canBlend) next = ClipTransition();
+    next.durationSec = std::min({next.durationSec, splicer.maxTransitionSec, std::max(0.0, durationSec - inSec) / 2});
+    if (next.durationSec <= 0) next = ClipTransition();
+    double cutSec = durationSec - next.durationSec;
+
+    // Copy from the first keyframe after the window in up to the last one
+    // before the window out; only the frames around them are decoded. The
+    // copied stretch ends on that last keyframe (and any open-GOP pictures
+    // that lead into it), so the re-encoded tail starts with a clean IDR.
+    bool matches = streamsMatch(splicer.ref, videoIn->codecpar);
+    int64_t copyFrom = AV_NOPTS_VALUE;
+    int64_t copyUntil = INT64_MAX;
+    if (matches) {
+        std::shared_ptr<const KeyframeIndex> keyframes = keyframeIndexes.find(path);
+        if (!keyframes) keyframes = keyframeIndexes.build(path);
+        if (keyframes && keyframes->streamIndex == videoIndex && !keyframes->entries.empty()) {
+            int64_t inPts = keyframes->ptsForTime(inSec);
+            for (const KeyframeEntry& entry : keyframes->entries) {
+                if (entry.pts >= inPts) {
+                    copyFrom = entry.pts;
+                    break;
+                }
+            }
+            if (next.durationSec > 0) copyUntil = keyframes->atOrBefore(keyframes->ptsForTime(cutSec) - 1)->pts;
+            if (copyUntil <= copyFrom) copyFrom = AV_NOPTS_VALUE;
+        }
+    }
+    if (!matches) stats.reencodedVideoClips++;
+    if (copyFrom == AV_NOPTS_VALUE && !splicer.canEncode) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "concat: %s would need re-encoding", path.c_str());
+        return false;
+    }
+    if (inSec > 0) stats.transitions++;
+
+    ClipDecoder dec;
+    if (!openClipDecoder(dec, videoIn)) return false;
+    std::swap(splicer.incoming, splicer.outgoing);
+    releaseHeld(splicer.outgoing);
+
+    // Before copyFrom, between the two keyframes, and from copyUntil on.
+    enum { kLead, kCopy, kTail } phase = kLead;
+    int64_t timelineStart = av_rescale_q(out.clipOffset, AV_TIME_BASE_Q, out.video->time_base);
+    auto onFrame = [&](AVFrame* frame) {
+        int64_t pts = frame->best_effort_timestamp;
+        // Copied, not re-encoded.
+        if (phase == kCopy && pts >= copyFrom) return true;
+        if (phase == kTail && pts <= copyUntil) return true;
+        double timeSec = (pts - videoStart) * av_q2d(videoIn->time_base);
+        AVFrame* image = toSpliceFormat(dec, splicer, frame);
+        if (!image) return false;
+        if (next.durationSec > 0 && timeSec >= cutSec) {
+            splicer.outgoing.push_back({timeSec - cutSec, image});
+            return true;
+        }
+        if (timeSec < inSec && !splicer.incoming.empty()) {
+            AVFrame* mixed = allocSpliceFrame(splicer);
+            if (!mixed) {
+                av_frame_free(&image);
+                return false;
+            }
+            renderTransition(splicer, into.type, timeSec / inSec, heldFrameAt(splicer.incoming, timeSec), image, mixed);
+            av_frame_copy_props(mixed, image);
+            av_frame_free(&image);
+            image = mixed;
+        } else if (!splicer.incoming.empty()) {
+            releaseHeld(splicer.incoming);
+        }
+        image->pts = timelineStart + av_rescale_q(pts - videoStart, videoIn->time_base, out.video->time_base);
+        bool ok = encodeSpliced(splicer, out, image, stats);
+        av_frame_free(&image);
+        return ok;
+    };
+
+    // Audio cuts over in the middle of each window: this clip's runs from
+    // inSec / 2 to cutSec + next.durationSec / 2 of its own time.
+    double audioFromSec = inSec / 2;
+    double audioUntilSec = next.durationSec > 0 ? cutSec + next.durationSec / 2 : INFINITY;
+    bool copyAudio = audioIn && streamsMatch(refAudio, audioIn->codecpar);
+    std::unique_ptr<AudioMixer> mixer;
+    if (refAudio && !copyAudio) {
+        // Also covers clips without audio: the mixer fills them with silence.
+        EditPlan plan;
+        plan.inputPath = path;
+        plan.keepAudio = true;
+        plan.startSec = audioFromSec;
+        double audioEndSec = std::isfinite(audioUntilSec) ? audioUntilSec : durationSec;
+        mixer = AudioMixer::open(plan, audioEndSec - audioFromSec, refAudio);
+        if (!mixer) return false;
+        stats.reencodedAudioClips++;
+    }
+    int64_t mixerOffset = out.clipOffset + static_cast<int64_t>(audioFromSec * AV_TIME_BASE);
+    AudioMixer::PacketSink writeAudio = [&out, &mixer, mixerOffset](AVPacket* pkt) {
+        return writeJoined(out, pkt, mixer->encoder()->time_base, out.audio, mixerOffset);
+    };
+
+    auto copyPacket = [&](AVPacket* p) {
+        bool ok = true;
+        if (splicer.paramsReplaced && (p->flags & AV_PKT_FLAG_KEY) && !splicer.paramSets.empty()) {
+            std::vector<uint8_t> payload = splicer.paramSets;
+            payload.insert(payload.end(), p->data, p->data + p->size);
+            ok = setPacketPayload(p, payload);
+            splicer.paramsReplaced = false;
+        }
+        if (p->pts != AV_NOPTS_VALUE) p->pts -= videoStart;
+        if (p->dts != AV_NOPTS_VALUE) p->dts -= videoStart;
+        ok = ok && writeJoined(out, p, videoIn->time_base, out.video, out.clipOffset);
+        stats.copiedVideoPackets++;
+        return ok;
+    };
+
+    // Pictures that follow the copyFrom keyframe in decode order but come
+    // before it (open GOP) reference the GOP before, so they are decoded with
+    // the lead-in; the keyframe is held until the first one after it, then
+    // the re-encoded stretch is closed and copying starts.
+    AVPacket* heldKeyframe = nullptr;
+    bool keyframeDecoded = false;
+    auto startCopy = [&]() {
+        bool ok = decodeClip(dec, nullptr, onFrame) && closeSplicer(splicer, out);
+        avcodec_flush_buffers(dec.decCtx);
+        out.shift[0] = 0;
+        ok = ok && copyPacket(heldKeyframe);
+        av_packet_free(&heldKeyframe);
+        return ok;
+    };
+
+    out.shift[0] = out.shift[1] = 0;
+    AVPacket* pkt = av_packet_alloc();
+    bool ok = true;
+    while (ok && av_read_frame(in.fmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == videoIndex) {
+            double timeSec = pkt->pts != AV_NOPTS_VALUE ? (pkt->pts - videoStart) * av_q2d(videoIn->time_base) : 0;
+            bool keyframe = pkt->flags & AV_PKT_FLAG_KEY;
+            bool hasPts = pkt->pts != AV_NOPTS_VALUE;
+            if (phase == kLead && keyframe && copyFrom != AV_NOPTS_VALUE && pkt->pts == copyFrom) {
+                phase = kCopy;
+                heldKeyframe = av_packet_clone(pkt);
+                ok = heldKeyframe != nullptr;
+            } else if (phase == kLead) {
+                ok = decodeClip(dec, pkt, onFrame);
+            } else if (phase == kCopy && hasPts && pkt->pts < copyFrom) {
+                // Leads into copyFrom; dropped if it only shows up once
+                // copying has started.
+                if (heldKeyframe) {
+                    if (!keyframeDecoded) ok = decodeClip(dec, heldKeyframe, onFrame);
+                    keyframeDecoded = true;
+                    ok = ok && decodeClip(dec, pkt, onFrame);
+                }
+            } else if (phase == kCopy) {
+                if (heldKeyframe) ok = startCopy();
+                if (keyframe && pkt->pts == copyUntil) {
+                    // Copied, and decoded as the reference for what follows.
+                    phase = kTail;
+                    ok = ok && decodeClip(dec, pkt, onFrame);
+                }
+                ok = ok && copyPacket(pkt);
+            } else if (hasPts && pkt->pts < copyUntil) {
+                // Leads into the copyUntil keyframe, which was copied.
+                ok = copyPacket(pkt);
+            } else {
+                ok = decodeClip(dec, pkt, onFrame);
+            }
+            if (ok && mixer) ok = mixer->advanceTo(timeSec - audioFromSec + kAudioLeadSec, writeAudio);
+        } else if (pkt->stream_index == audioIndex && copyAudio) {
+            double timeSec = pkt->pts != AV_NOPTS_VALUE ? (pkt->pts - audioStart) * av_q2d(audioIn->time_base) : 0;
+            if (timeSec >= audioFromSec && timeSec < audioUntilSec) {
+                if (pkt->pts != AV_NOPTS_VALUE) pkt->pts -= audioStart;
+                if (pkt->dts != AV_NOPTS_VALUE) pkt->dts -= audioStart;
+                ok = writeJoined(out, pkt, audioIn->time_base, out.audio, out.clipOffset);
+            }
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    if (ok && heldKeyframe) ok = startCopy();
+    av_packet_free(&heldKeyframe);
+    if (ok && phase != kCopy) ok = decodeClip(dec, nullptr, onFrame);
+    if (ok && mixer) ok = mixer->finish(writeAudio);
+    releaseHeld(splicer.incoming);
+    out.clipOffset = next.durationSec > 0 ? out.clipOffset + static_cast<int64_t>(cutSec * AV_TIME_BASE) : out.end;
+    return ok;
+}
+
+} // namespace
+
+std::vector<ClipTransition> parseTransitions(const std::string& json) {
+    std::vector<ClipTransition> transitions;
+    for (const std::string& obj : splitJsonObjects(json)) {
+        ClipTransition transition;
+        std::string type = jsonField(obj, "type");
+        double durationSec = jsonNumber(obj, "durationSec", 0);
+        if ((type == "crossfade" || type == "dipToBlack" || type == "slide") && durationSec > 0) {
+            transition.type = type;
+            transition.durationSec = durationSec;
+        }
+        transitions.push_back(transition);
+    }
+    return transitions;
+}
+
+bool concatClips(const std::vector<std::string>& rawInputs, const std::vector<ClipTransition>& transitions, const std::string& rawOutput,
+                 KeyframeIndexStore& keyframeIndexes, ConcatStats& stats) {
+    auto started = std::chrono::steady_clock::now();
+    stats = ConcatStats();
+    stats.clips = static_cast<int>(rawInputs.size());
+    if (rawInputs.empty()) return false;
+    std::vector<std::string> inputs;
+    for (const std::string& path : rawInputs) inputs.push_back(stripFileScheme(path));
+    std::string outputPath = stripFileScheme(rawOutput);
+
+    // The first clip decides what the joined tracks look like.
+    AVCodecParameters* refVideo = avcodec_parameters_alloc();
+    AVCodecParameters* refAudio = nullptr;
+    AVRational videoTimeBase{1, 90000};
+    AVRational frameRate{0, 1};
+    {
+        InputFile first;
+        if (!openInput(first, inputs.front())) {
+            avcodec_parameters_free(&refVideo);
+            return false;
+        }
+        int videoIndex = av_find_best_stream(first.fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        int audioIndex = av_find_best_stream(first.fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        if (videoIndex < 0) {
+            avcodec_parameters_free(&refVideo);
+            return false;
+        }
+        AVStream* videoStream = first.fmtCtx->streams[videoIndex];
+        avcodec_parameters_copy(refVideo, videoStream->codecpar);
+        videoTimeBase = videoStream->time_base;
+        frameRate = av_guess_frame_rate(first.fmtCtx, videoStream, nullptr);
+        if (audioIndex >= 0) {
+            refAudio = avcodec_parameters_alloc();
+            avcodec_parameters_copy(refAudio, first.fmtCtx->streams[audioIndex]->codecpar);
+        }
+    }
+
+    bool ok = false;
+    {
+        ConcatOutput out;
+        VideoSplicer splicer;
+        ok = setupSplicer(splicer, refVideo, frameRate);
+        if (ok) avformat_alloc_output_context2(&out.fmtCtx, nullptr, nullptr, outputPath.c_str());
+        if (out.fmtCtx) {
+            out.video = avformat_new_stream(out.fmtCtx, nullptr);
+            out.audio = refAudio ? avformat_new_stream(out.fmtCtx, nullptr) : nullptr;
+            ok = out.video && (!refAudio || out.audio) && avcodec_parameters_copy(out.video->codecpar, refVideo) >= 0 &&
+                 (!refAudio || avcodec_parameters_copy(out.audio->codecpar, refAudio) >= 0);
+        } else {
+            ok = false;
+        }
+        if (ok) {
+            out.video->codecpar->codec_tag = 0;
+            out.video->time_base = videoTimeBase;
+            if (out.audio) {
+                out.audio->codecpar->codec_tag = 0;
+                out.audio->time_base = AVRational{1, refAudio->sample_rate};
+            }
+            if (!(out.fmtCtx->oformat->flags & AVFMT_NOFILE)) ok = avio_open(&out.fmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) >= 0;
+        }
+        ok = ok && avformat_write_header(out.fmtCtx, nullptr) >= 0;
+        ClipTransition into;
+        for (size_t i = 0; ok && i < inputs.size(); ++i) {
+            ClipTransition next = i + 1 < inputs.size() && i < transitions.size() ? transitions[i] : ClipTransition();
+            ok = appendClip(out, splicer, inputs[i], into, next, refAudio, keyframeIndexes, stats);
+            if (!ok) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "concat: failed on clip %zu (%s)", i, inputs[i].c_str());
+            into = next;
+        }
+        ok = ok && closeSplicer(splicer, out);
+        ok = ok && av_write_trailer(out.fmtCtx) >= 0;
+        stats.durationSec = static_cast<double>(out.end) / AV_TIME_BASE;
+    }
+    avcodec_parameters_free(&refVideo);
+    avcodec_parameters_free(&refAudio);
+
+    stats.elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    struct stat st;
+    if (ok && stat(outputPath.c_str(), &st) == 0) stats.outputBytes = st.st_size;
+    return ok;
+}
+
+} // namespace facebook::react
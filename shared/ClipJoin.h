@@ -0,0 +1,57 @@
+#pragma once
+
+#include "KeyframeIndex.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+// What happens between one clip and the next: "cut", "crossfade",
+// "dipToBlack" (through black) or "slide" (the next clip pushes in from the
+// right). The last durationSec of the outgoing clip plays over the first
+// durationSec of the incoming one, so the joined file gets that much shorter.
+struct ClipTransition {
+  std::string type = "cut";
+  double durationSec = 0;
+};
+
+// Transitions as a JSON array of flat objects, one per gap between clips in
+// order: [{"type":"crossfade","durationSec":0.5},{"type":"cut"}]. Missing
+// entries, unknown types and zero durations are cuts.
+std::vector<ClipTransition> parseTransitions(const std::string& json);
+
+struct ConcatStats {
+  int clips = 0;
+  // Clips whose video or audio did not match the first clip's and was
+  // re-encoded to it; the rest were copied.
+  int reencodedVideoClips = 0;
+  int reencodedAudioClips = 0;
+  // Transitions rendered (cuts don't count).
+  int transitions = 0;
+  int64_t copiedVideoPackets = 0;
+  int64_t reencodedVideoFrames = 0;
+  double durationSec = 0;
+  double elapsedSec = 0;
+  int64_t outputBytes = 0;
+};
+
+// Join inputPaths end to end into outputPath, in one video and (if the first
+// clip has one) one audio track shaped like the first clip's. Packets of
+// streams whose codec parameters match the first clip's are copied with
+// their timestamps rebased onto one continuous timeline; a mismatched stream
+// is decoded and re-encoded to the first clip's parameters (H.264 video goes
+// through the high-quality export profile with in-band parameter sets).
+// Clips without audio get silence.
+//
+// transitions[i] joins clip i to clip i + 1. Only the video around each one
+// is decoded: from the outgoing clip's last keyframe before the window to
+// the incoming clip's first keyframe after it. Those frames are blended and
+// re-encoded and everything between is copied whole GOPs at a time. A
+// transition is shortened so the frames held for it stay under about 96 MB
+// (a quarter of a second at 4K). Audio cuts over in the middle of the
+// window. Blocking.
+bool concatClips(const std::vector<std::string>& inputPaths, const std::vector<ClipTransition>& transitions,
+                 const std::string& outputPath, KeyframeIndexStore& keyframeIndexes, ConcatStats& stats);
+
+} // namespace facebook::react
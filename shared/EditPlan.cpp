@@ -0,0 +1,30 @@
+#include "EditPlan.h"
+#include "MediaUtils.h"
+#include <algorithm>
+
+namespace facebook::react {
+
+EditPlan parseEditPlan(const std::string& json) {
+    EditPlan plan;
+    plan.inputPath = stripFileScheme(jsonField(json, "input"));
+    plan.workDir = stripFileScheme(jsonField(json, "workDir"));
+    plan.startSec = std::max(0.0, jsonNumber(json, "startSec", 0));
+    plan.durationSec = std::max(0.0, jsonNumber(json, "durationSec", 0));
+    plan.keepAudio = jsonBool(json, "keepAudio", false);
+    plan.normalizeLufs = std::min(0.0, jsonNumber(json, "normalizeLufs", 0));
+    plan.loudnessLufs = std::min(0.0, jsonNumber(json, "loudnessLufs", 0));
+    plan.loudnessTruePeakDbtp = jsonNumber(json, "loudnessTruePeakDbtp", 0);
+    plan.speed = std::clamp(jsonNumber(json, "speed", 1), 1.0, 16.0);
+
+    MusicBed& music = plan.music;
+    music.path = stripFileScheme(jsonField(json, "music"));
+    music.volume = std::max(0.0, jsonNumber(json, "musicVolume", music.volume));
+    music.fadeInSec = std::max(0.0, jsonNumber(json, "musicFadeInSec", 0));
+    music.fadeOutSec = std::max(0.0, jsonNumber(json, "musicFadeOutSec", 0));
+    music.offsetSec = std::max(0.0, jsonNumber(json, "musicOffsetSec", 0));
+    music.ducking = jsonBool(json, "musicDucking", music.ducking);
+    music.duckGain = std::clamp(jsonNumber(json, "musicDuckGain", music.duckGain), 0.0, 1.0);
+    return plan;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+
+namespace facebook::react {
+
+// Music under the clip's own audio. `volume` is a linear gain; while the
+// clip's audio is loud (speech) the music is lowered to volume * duckGain.
+struct MusicBed {
+  std::string path;
+  double volume = 1.0;
+  double fadeInSec = 0;
+  double fadeOutSec = 0;
+  // Where in the music file to start.
+  double offsetSec = 0;
+  bool ducking = true;
+  double duckGain = 0.25;
+};
+
+// Above this speed-up the clip audio is dropped rather than time-stretched.
+constexpr double kMaxAudioStretchSpeed = 4.0;
+
+// What to export, sent from JS as a flat JSON object:
+// {"input":"file:///...","workDir":"/data/.../cache/","startSec":1.5,
+// "durationSec":4,"keepAudio":true,"music":"file:///...","musicVolume":0.8,
+// "musicFadeInSec":1,"musicFadeOutSec":2,"musicOffsetSec":0,
+// "musicDucking":true,"musicDuckGain":0.25,"normalizeLufs":-14,
+// "loudnessLufs":-21.3,"loudnessTruePeakDbtp":-4.2,"speed":4}. Overlays
+// travel separately as their own JSON array.
+struct EditPlan {
+  std::string inputPath;
+  std::string workDir;
+  // Trim. A durationSec of 0 runs to the end of the clip.
+  double startSec = 0;
+  double durationSec = 0;
+  // Carry the clip's own audio. Always mixed in when there is music.
+  bool keepAudio = false;
+  MusicBed music;
+  // Bring the clip audio to normalizeLufs integrated loudness (0 = off).
+  // loudnessLufs/loudnessTruePeakDbtp are the clip's measureLoudness result;
+  // when they are missing (0) the export measures the audio first.
+  double normalizeLufs = 0;
+  double loudnessLufs = 0;
+  double loudnessTruePeakDbtp = 0;
+  // Speed-up of the trimmed clip (1 = as recorded, up to 16). Overlay and
+  // music timings are on the sped-up timeline; the music plays at its own
+  // speed.
+  double speed = 1;
+
+  bool keepsClipAudio() const { return (keepAudio || normalizeLufs < 0) && speed <= kMaxAudioStretchSpeed; }
+  bool hasAudio() const { return keepsClipAudio() || !music.path.empty(); }
+};
+
+EditPlan parseEditPlan(const std::string& json);
+
+} // namespace facebook::react
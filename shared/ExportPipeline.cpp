@@ -0,0 +1,472 @@
+#include "ExportPipeline.h"
+#include "AudioMixer.h"
+#include "FrameExtractor.h"
+#include "MediaUtils.h"
+#include "OverlayFilter.h"
+#include <android/log.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Composited frames waiting for one rendition's encoder. Kept short: the
+// encoders are the slow stage, so a longer queue only costs memory (about
+// 3 MB per queued 1080p frame).
+constexpr size_t kBranchQueueFrames = 4;
+
+// From this speed-up on only keyframes are decoded: the output gets one
+// frame per GOP at most, but nothing between keyframes is ever decoded.
+// Below it, non-reference frames are skipped in the decoder.
+constexpr double kKeyframeOnlySpeed = 8.0;
+
+bool writeEncodedPackets(AVCodecContext* encCtx, AVFormatContext* outFmtCtx, AVStream* outStream, AVPacket* pkt) {
+    while (avcodec_receive_packet(encCtx, pkt) == 0) {
+        pkt->stream_index = outStream->index;
+        av_packet_rescale_ts(pkt, encCtx->time_base, outStream->time_base);
+        if (av_interleaved_write_frame(outFmtCtx, pkt) < 0) return false;
+    }
+    return true;
+}
+
+// Size of a rendition: `resolution` is the shorter side, never upscaled.
+void outputSizeFor(int srcWidth, int srcHeight, int resolution, int& width, int& height) {
+    width = srcWidth;
+    height = srcHeight;
+    if (resolution > 0 && std::min(srcWidth, srcHeight) > resolution) {
+        width = srcWidth <= srcHeight ? resolution : 0;
+        height = width == 0 ? resolution : 0;
+        fitTargetSize(srcWidth, srcHeight, width, height);
+    }
+}
+
+// Bounded single-producer/single-consumer queue of frame references. A null
+// frame marks the end of the stream.
+class FrameQueue {
+public:
+  void push(AVFrame* frame) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [this] { return frames_.size() < kBranchQueueFrames; });
+    frames_.push_back(frame);
+    notEmpty_.notify_one();
+  }
+
+  AVFrame* pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [this] { return !frames_.empty(); });
+    AVFrame* frame = frames_.front();
+    frames_.pop_front();
+    notFull_.notify_one();
+    return frame;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+  std::deque<AVFrame*> frames_;
+};
+
+// Scaler + encoder + muxer for one rendition, fed from its own queue.
+struct Branch {
+  const Rendition* rendition = nullptr;
+  ExportStats* stats = nullptr;
+  int width = 0;
+  int height = 0;
+  AVFormatContext* outFmtCtx = nullptr;
+  AVCodecContext* encCtx = nullptr;
+  AVStream* outStream = nullptr;
+  // Time base of the frames in the queue (the input stream's).
+  AVRational frameTimeBase{1, 1};
+  // The shared AAC track, muxed from the decoder thread; muxMutex guards
+  // outFmtCtx between it and the branch thread.
+  AVStream* audioStream = nullptr;
+  std::mutex muxMutex;
+  FrameQueue queue;
+  // Encoder input when this rendition needs its own scale.
+  FramePool pool;
+  std::thread thread;
+  bool ok = false;
+
+  ~Branch() {
+    if (encCtx) avcodec_free_context(&encCtx);
+    if (outFmtCtx) {
+      if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
+      avformat_free_context(outFmtCtx);
+    }
+  }
+};
+
+bool openBranch(Branch& branch, const VideoDecoder& decoder, AVPixelFormat pixFmt, const AVCodecContext* audioEnc) {
+    const ExportProfile* profile = findExportProfile(branch.rendition->options.profile);
+    if (!profile) profile = &exportProfiles().front();
+    branch.stats->profile = profile->name;
+
+    std::string output = stripFileScheme(branch.rendition->outputPath);
+    AVStream* inStream = decoder.stream();
+    avformat_alloc_output_context2(&branch.outFmtCtx, nullptr, nullptr, output.c_str());
+    if (!branch.outFmtCtx) return false;
+    AVRational frameRate = av_guess_frame_rate(decoder.fmtCtx, inStream, nullptr);
+    BitratePlan bitrate;
+    int64_t targetBytes = branch.rendition->options.targetBytes;
+    if (targetBytes > 0) {
+        int64_t audioBitRate = audioEnc ? audioEnc->bit_rate : 0;
+        if (!planTargetBitrate(targetBytes, branch.stats->mediaDurationSec, av_q2d(frameRate), audioBitRate, bitrate)) return false;
+        branch.stats->targetBytes = targetBytes;
+        branch.stats->videoBitRate = bitrate.videoBitRate;
+    }
+    branch.encCtx = openProfileEncoder(*profile, branch.width, branch.height, decoder.decCtx->sample_aspect_ratio, pixFmt,
+                                       inStream->time_base, frameRate, branch.outFmtCtx->oformat->flags & AVFMT_GLOBALHEADER,
+                                       targetBytes > 0 ? &bitrate : nullptr);
+    if (!branch.encCtx) return false;
+    branch.frameTimeBase = inStream->time_base;
+    branch.stats->encoder = branch.encCtx->codec->name;
+
+    branch.outStream = avformat_new_stream(branch.outFmtCtx, nullptr);
+    if (!branch.outStream) return false;
+    if (avcodec_parameters_from_context(branch.outStream->codecpar, branch.encCtx) < 0) return false;
+    branch.outStream->time_base = branch.encCtx->time_base;
+    if (audioEnc) {
+        branch.audioStream = avformat_new_stream(branch.outFmtCtx, nullptr);
+        if (!branch.audioStream) return false;
+        if (avcodec_parameters_from_context(branch.audioStream->codecpar, audioEnc) < 0) return false;
+        branch.audioStream->time_base = audioEnc->time_base;
+    }
+    if (!(branch.outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&branch.outFmtCtx->pb, output.c_str(), AVIO_FLAG_WRITE) < 0) return false;
+    }
+    return avformat_write_header(branch.outFmtCtx, nullptr) >= 0;
+}
+
+// Branch thread: scale (only if this rendition is smaller than the composite)
+// and encode until the end marker. Keeps draining after a failure so the
+// decoder thread never blocks on a dead branch.
+void runBranch(Branch& branch) {
+    AVCodecContext* encCtx = branch.encCtx;
+    SwsContext* sws = nullptr;
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* scaled = av_frame_alloc();
+    bool ok = true;
+
+    while (AVFrame* frame = branch.queue.pop()) {
+        if (ok) {
+            AVFrame* input = frame;
+            if (frame->width != branch.width || frame->height != branch.height || frame->format != encCtx->pix_fmt) {
+                sws = sws_getCachedContext(sws, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                           branch.width, branch.height, encCtx->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+                // The encoder may still hold the previous scaled frame; take
+                // a fresh buffer from the pool rather than copying on write.
+                av_frame_unref(scaled);
+                scaled->format = encCtx->pix_fmt;
+                scaled->width = branch.width;
+                scaled->height = branch.height;
+                ok = sws && branch.pool.getBuffer(scaled) >= 0;
+                if (ok) {
+                    sws_scale(sws, frame->data, frame->linesize, 0, frame->height, scaled->data, scaled->linesize);
+                    av_frame_copy_props(scaled, frame);
+                    input = scaled;
+                }
+            }
+            if (ok) {
+                input->pict_type = AV_PICTURE_TYPE_NONE;
+                input->pts = av_rescale_q(input->pts, branch.frameTimeBase, encCtx->time_base);
+                std::lock_guard<std::mutex> lock(branch.muxMutex);
+                ok = avcodec_send_frame(encCtx, input) >= 0 && writeEncodedPackets(encCtx, branch.outFmtCtx, branch.outStream, pkt);
+                if (ok) branch.stats->frames++;
+            }
+        }
+        av_frame_free(&frame);
+    }
+    if (ok) {
+        std::lock_guard<std::mutex> lock(branch.muxMutex);
+        avcodec_send_frame(encCtx, nullptr);
+        ok = writeEncodedPackets(encCtx, branch.outFmtCtx, branch.outStream, pkt) && av_write_trailer(branch.outFmtCtx) >= 0;
+    }
+
+    sws_freeContext(sws);
+    av_frame_free(&scaled);
+    av_packet_free(&pkt);
+    branch.ok = ok;
+}
+
+} // namespace
+
+std::vector<Rendition> parseRenditions(const std::string& json) {
+    std::vector<Rendition> renditions;
+    for (const std::string& obj : splitJsonObjects(json)) {
+        Rendition rendition;
+        rendition.outputPath = stripFileScheme(jsonField(obj, "output"));
+        if (rendition.outputPath.empty()) continue;
+        rendition.options = parseExportOptions(obj);
+        renditions.push_back(rendition);
+    }
+    return renditions;
+}
+
+bool exportRenditions(const EditPlan& plan, const std::string& overlaysJson, const std::vector<Rendition>& renditions,
+                      std::vector<ExportStats>& stats) {
+    auto started = std::chrono::steady_clock::now();
+    stats.assign(renditions.size(), ExportStats());
+    if (renditions.empty()) return false;
+    // Decoded pictures come from a pool; the filter graph recycles its own
+    // output frames, and branches pool what they scale, so a running export
+    // reuses buffers instead of allocating one per frame.
+    auto decoder = openVideoDecoder(plan.inputPath, 0, 0, FF_THREAD_FRAME, true);
+    if (!decoder) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Export: failed to open %s", plan.inputPath.c_str());
+        return false;
+    }
+    AVStream* inStream = decoder->stream();
+    AVCodecContext* decCtx = decoder->decCtx;
+    double endSec = plan.durationSec > 0 ? plan.startSec + plan.durationSec : 0;
+    double duration = decoder->durationSec();
+    if (endSec > 0 && (duration <= 0 || endSec < duration)) duration = endSec;
+    duration = std::max(0.0, duration - plan.startSec) / plan.speed;
+
+    // Composite once, at the size of the largest rendition.
+    std::vector<std::unique_ptr<Branch>> branches;
+    int compositeWidth = 0;
+    int compositeHeight = 0;
+    for (size_t i = 0; i < renditions.size(); ++i) {
+        auto branch = std::make_unique<Branch>();
+        branch->rendition = &renditions[i];
+        branch->stats = &stats[i];
+        outputSizeFor(decCtx->width, decCtx->height, renditions[i].options.resolution, branch->width, branch->height);
+        stats[i].outputPath = renditions[i].outputPath;
+        stats[i].width = branch->width;
+        stats[i].height = branch->height;
+        stats[i].mediaDurationSec = duration;
+        if (branch->width * branch->height > compositeWidth * compositeHeight) {
+            compositeWidth = branch->width;
+            compositeHeight = branch->height;
+        }
+        branches.push_back(std::move(branch));
+    }
+
+    std::string overlayChain;
+    if (!buildOverlayFilter(overlaysJson, plan.workDir, static_cast<double>(compositeWidth) / decCtx->width, overlayChain)) return false;
+    // Keep the decoder's pixel format all the way to the encoders when they
+    // all take it, so frames are never converted; otherwise convert once
+    // here.
+    AVPixelFormat pixFmt = decCtx->pix_fmt;
+    for (const Rendition& rendition : renditions) {
+        const ExportProfile* profile = findExportProfile(rendition.options.profile);
+        if (!profileAcceptsPixelFormat(profile ? *profile : exportProfiles().front(), pixFmt)) {
+            pixFmt = AV_PIX_FMT_YUV420P;
+            break;
+        }
+    }
+    const char* compositeFormat = av_get_pix_fmt_name(pixFmt);
+    // At source size, frames that need no conversion and have no overlay on
+    // screen skip the filter graph and go to the encoders as they are.
+    bool bypassable = compositeWidth == decCtx->width && compositeHeight == decCtx->height;
+    std::vector<OverlayWindow> windows = overlayWindows(overlaysJson);
+    int64_t bypassed = 0;
+    std::string chain;
+    if (compositeWidth != decCtx->width || compositeHeight != decCtx->height) {
+        // Resize and convert in one swscale pass straight after decode, so
+        // drawtext and the encoders only ever touch output-size frames.
+        chain = "scale=" + std::to_string(compositeWidth) + ":" + std::to_string(compositeHeight) + ":flags=bilinear,format=" +
+                compositeFormat;
+        if (!overlayChain.empty()) chain += "," + overlayChain;
+    } else {
+        // Overlays first, then convert to what the encoders take.
+        chain = overlayChain;
+        if (!chain.empty()) chain += ",";
+        chain += std::string("format=") + compositeFormat;
+    }
+    AVFilterContext* buffersrcCtx = nullptr;
+    AVFilterContext* buffersinkCtx = nullptr;
+    AVFilterGraph* graph = createFilterGraph(chain, decCtx->width, decCtx->height, decCtx->pix_fmt, inStream->time_base,
+                                             decCtx->sample_aspect_ratio, &buffersrcCtx, &buffersinkCtx);
+    if (!graph) return false;
+
+    // Audio (clip and/or music bed) is mixed and encoded once here and
+    // muxed into every rendition.
+    std::unique_ptr<AudioMixer> mixer;
+    if (plan.hasAudio()) {
+        mixer = AudioMixer::open(plan, duration);
+        if (!mixer) {
+            avfilter_graph_free(&graph);
+            return false;
+        }
+    }
+    AVPacket* audioPkt = av_packet_alloc();
+    AudioMixer::PacketSink muxAudio = [&branches, &mixer, audioPkt](AVPacket* encoded) {
+        for (auto& branch : branches) {
+            if (av_packet_ref(audioPkt, encoded) < 0) return false;
+            audioPkt->stream_index = branch->audioStream->index;
+            av_packet_rescale_ts(audioPkt, mixer->encoder()->time_base, branch->audioStream->time_base);
+            std::lock_guard<std::mutex> lock(branch->muxMutex);
+            if (av_interleaved_write_frame(branch->outFmtCtx, audioPkt) < 0) return false;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    for (auto& branch : branches) {
+        if (!openBranch(*branch, *decoder, pixFmt, mixer ? mixer->encoder() : nullptr)) {
+            __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Export: failed to set up %s", branch->rendition->outputPath.c_str());
+            ok = false;
+            break;
+        }
+    }
+    if (ok) {
+        for (auto& branch : branches) {
+            Branch* b = branch.get();
+            branch->thread = std::thread([b] { runBranch(*b); });
+        }
+    }
+
+    // Speed-ups keep at most one frame per output frame interval; the rest
+    // are skipped as early as the decoder allows.
+    bool keyframesOnly = plan.speed >= kKeyframeOnlySpeed;
+    if (plan.speed > 1) decCtx->skip_frame = keyframesOnly ? AVDISCARD_NONKEY : AVDISCARD_NONREF;
+    AVRational frameRate = av_guess_frame_rate(decoder->fmtCtx, inStream, nullptr);
+    double frameInterval = frameRate.num > 0 && frameRate.den > 0 ? av_q2d(av_inv_q(frameRate)) : 1.0 / 30;
+    double nextSlotSec = 0;
+    int64_t decodedFrames = 0;
+
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    AVFrame* filtered = av_frame_alloc();
+    bool flushing = false;
+    bool pastEnd = false;
+    int64_t firstPts = AV_NOPTS_VALUE;
+    if (plan.startSec > 0) seekVideoBefore(*decoder, plan.startSec);
+    while (ok && !pastEnd) {
+        if (!flushing) {
+            if (av_read_frame(decoder->fmtCtx, pkt) < 0) {
+                flushing = true;
+                avcodec_send_packet(decCtx, nullptr);
+            } else {
+                bool isVideo = pkt->stream_index == decoder->streamIndex;
+                if (isVideo && (!keyframesOnly || (pkt->flags & AV_PKT_FLAG_KEY))) avcodec_send_packet(decCtx, pkt);
+                av_packet_unref(pkt);
+                if (!isVideo) continue;
+            }
+        }
+        int ret;
+        while (ok && (ret = avcodec_receive_frame(decCtx, frame)) == 0) {
+            // Trim: drop frames before the start (decoding resumed at the
+            // keyframe before it) and stop at the end; output starts at 0.
+            double timeSec = frameTimeSec(*decoder, frame);
+            if (timeSec < plan.startSec) {
+                av_frame_unref(frame);
+                continue;
+            }
+            if (endSec > 0 && timeSec >= endSec) {
+                av_frame_unref(frame);
+                pastEnd = true;
+                break;
+            }
+            decodedFrames++;
+            if (firstPts == AV_NOPTS_VALUE) firstPts = frame->best_effort_timestamp;
+            frame->pts = frame->best_effort_timestamp - firstPts;
+            if (plan.speed > 1) {
+                // Squeeze the timeline, and drop frames that would land in
+                // an output frame interval already shown.
+                frame->pts = std::llround(frame->pts / plan.speed);
+                double outSec = frame->pts * av_q2d(inStream->time_base);
+                if (outSec + 1e-6 < nextSlotSec) {
+                    av_frame_unref(frame);
+                    continue;
+                }
+                nextSlotSec = (std::floor(outSec / frameInterval + 1e-6) + 1) * frameInterval;
+            }
+            // Keep the audio a little ahead of the video so the muxers can
+            // interleave without buffering much.
+            if (mixer && !mixer->advanceTo(frame->pts * av_q2d(inStream->time_base) + 0.5, muxAudio)) {
+                ok = false;
+                break;
+            }
+            if (bypassable && frame->format == pixFmt && !overlayVisibleAt(windows, frame->pts * av_q2d(inStream->time_base))) {
+                for (auto& branch : branches) branch->queue.push(av_frame_clone(frame));
+                av_frame_unref(frame);
+                bypassed++;
+                continue;
+            }
+            if (av_buffersrc_add_frame(buffersrcCtx, frame) < 0) {
+                ok = false;
+                break;
+            }
+            while (av_buffersink_get_frame(buffersinkCtx, filtered) >= 0) {
+                // Every branch gets a reference to the same pixels.
+                for (auto& branch : branches) branch->queue.push(av_frame_clone(filtered));
+                av_frame_unref(filtered);
+            }
+        }
+        if (flushing && ret == AVERROR_EOF) break;
+    }
+    if (ok && mixer && !mixer->finish(muxAudio)) ok = false;
+    av_frame_free(&filtered);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    av_packet_free(&audioPkt);
+    avfilter_graph_free(&graph);
+
+    for (auto& branch : branches) {
+        if (!branch->thread.joinable()) continue;
+        branch->queue.push(nullptr);
+        branch->thread.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    FramePoolStats decoded = decoder->framePool->stats();
+    for (auto& branch : branches) {
+        ExportStats& s = *branch->stats;
+        s.ok = ok && branch->ok;
+        s.elapsedSec = elapsed;
+        s.bypassedFrames = bypassed;
+        s.decodedFrames = decodedFrames;
+        s.hasAudio = mixer != nullptr;
+        s.musicDuckedSec = mixer ? mixer->duckedSec() : 0;
+        s.audioGainDb = mixer ? mixer->clipGainDb() : 0;
+        FramePoolStats scaled = branch->pool.stats();
+        s.poolRequests = decoded.requests + scaled.requests;
+        s.poolHits = decoded.hits + scaled.hits;
+        s.peakResidentFrames = decoded.peakResidentFrames + scaled.peakResidentFrames;
+        struct stat st;
+        if (s.ok && stat(stripFileScheme(s.outputPath).c_str(), &st) == 0) s.outputBytes = st.st_size;
+        if (!s.ok) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Export failed for %s", s.outputPath.c_str());
+        if (s.ok && s.targetBytes > 0) {
+            __android_log_print(s.outputBytes > s.targetBytes ? ANDROID_LOG_WARN : ANDROID_LOG_INFO, "FFmpegModule",
+                                "%s: %lld of %lld target bytes (%.1f%%) at %lld bps", s.outputPath.c_str(),
+                                static_cast<long long>(s.outputBytes), static_cast<long long>(s.targetBytes),
+                                100.0 * s.outputBytes / s.targetBytes, static_cast<long long>(s.videoBitRate));
+        }
+        ok = ok && s.ok;
+    }
+    return ok;
+}
+
+bool exportVideo(const std::string& inputPath, const std::string& outputPath, const std::string& overlaysJson,
+                 const std::string& workDir, const ExportOptions& options, ExportStats& stats) {
+    EditPlan plan;
+    plan.inputPath = stripFileScheme(inputPath);
+    plan.workDir = workDir;
+    Rendition rendition;
+    rendition.outputPath = outputPath;
+    rendition.options = options;
+    std::vector<ExportStats> results;
+    bool ok = exportRenditions(plan, overlaysJson, {rendition}, results);
+    if (!results.empty()) stats = results.front();
+    return ok;
+}
+
+} // namespace facebook::react
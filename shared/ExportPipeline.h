@@ -0,0 +1,71 @@
+#pragma once
+
+#include "EditPlan.h"
+#include "ExportProfile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+struct ExportStats {
+  std::string outputPath;
+  std::string profile;
+  std::string encoder;
+  int width = 0;
+  int height = 0;
+  int64_t frames = 0;
+  // Frames passed from the decoder straight to the encoders, skipping the
+  // filter graph (no overlay on screen, nothing to convert).
+  int64_t bypassedFrames = 0;
+  // Frames the decoder produced within the trim. With a speed-up the
+  // decoder skips most others, so this stays well below the clip's count.
+  int64_t decodedFrames = 0;
+  double mediaDurationSec = 0;
+  double elapsedSec = 0;
+  int64_t outputBytes = 0;
+  // Set when the rendition had a targetBytes budget.
+  int64_t targetBytes = 0;
+  int64_t videoBitRate = 0;
+  // Pooled picture buffers: the shared decoder's plus this rendition's
+  // scaler output.
+  uint64_t poolRequests = 0;
+  uint64_t poolHits = 0;
+  uint64_t peakResidentFrames = 0;
+  // Whether an AAC track was written, and how long the music bed spent
+  // ducked under the clip audio.
+  bool hasAudio = false;
+  double musicDuckedSec = 0;
+  // Loudness normalization applied to the clip audio.
+  double audioGainDb = 0;
+  bool ok = false;
+};
+
+// One output of an export: where it goes and how it is encoded.
+struct Rendition {
+  std::string outputPath;
+  ExportOptions options;
+};
+
+// Renditions as a JSON array of flat objects:
+// [{"output":"...","profile":"share-fast","resolution":720,"targetBytes":0}, ...].
+std::vector<Rendition> parseRenditions(const std::string& json);
+
+// Decode the plan's trimmed video once, draw overlaysJson at the size of the
+// largest rendition (scaling right after decode when that is below the
+// source), then hand every composited frame by reference to one scaler +
+// encoder + muxer thread per rendition. When the plan keeps the clip audio or
+// has a music bed, one AAC track is mixed and encoded alongside the video in
+// the same loop and muxed into every rendition. A speed-up drops frames
+// before they are composited and has the decoder skip non-reference frames
+// (or everything but keyframes from 8x). Blocking. `stats` gets one entry per
+// rendition; returns true if all of them succeeded.
+bool exportRenditions(const EditPlan& plan, const std::string& overlaysJson, const std::vector<Rendition>& renditions,
+                      std::vector<ExportStats>& stats);
+
+// Single-output convenience wrapper around exportRenditions.
+bool exportVideo(const std::string& inputPath, const std::string& outputPath, const std::string& overlaysJson,
+                 const std::string& workDir, const ExportOptions& options, ExportStats& stats);
+
+} // namespace facebook::react
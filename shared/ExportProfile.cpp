@@ -0,0 +1,204 @@
+#include "ExportProfile.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// MP4 cost beyond the coded frames: moov/mdat headers, plus sample size,
+// chunk offset and timing entries for every frame.
+constexpr int64_t kContainerFixedBytes = 4096;
+constexpr int64_t kContainerBytesPerFrame = 16;
+// Rate control lands within a few percent of its average; aim under.
+constexpr double kTargetMargin = 0.96;
+constexpr int64_t kMinVideoBitRate = 100000;
+// Largest time base denominator MPEG-4 Part 2 can code, and the clock used
+// instead: a whole number of ticks per frame at 24, 25, 30, 60 and the NTSC
+// rates.
+constexpr int kMaxEncoderTimeBaseDen = 65535;
+constexpr AVRational kEncoderClock{1, 60000};
+
+bool encoderAccepts(const AVCodec* enc, AVPixelFormat pixFmt) {
+    const void* configs = nullptr;
+    int count = 0;
+    if (avcodec_get_supported_config(nullptr, enc, AV_CODEC_CONFIG_PIX_FORMAT, 0, &configs, &count) < 0) return false;
+    // No list means no restriction.
+    if (!configs) return true;
+    const AVPixelFormat* formats = static_cast<const AVPixelFormat*>(configs);
+    return std::find(formats, formats + count, pixFmt) != formats + count;
+}
+
+// x264's "profile" option for an H.264 profile_idc; nullptr leaves it to x264.
+const char* x264ProfileName(int profile) {
+    switch (profile & ~(AV_PROFILE_H264_CONSTRAINED | AV_PROFILE_H264_INTRA)) {
+    case AV_PROFILE_H264_BASELINE: return "baseline";
+    case AV_PROFILE_H264_MAIN: return "main";
+    case AV_PROFILE_H264_HIGH: return "high";
+    case AV_PROFILE_H264_HIGH_10: return "high10";
+    case AV_PROFILE_H264_HIGH_422: return "high422";
+    case AV_PROFILE_H264_HIGH_444_PREDICTIVE: return "high444";
+    default: return nullptr;
+    }
+}
+
+} // namespace
+
+const std::vector<ExportProfile>& exportProfiles() {
+    static const std::vector<ExportProfile> profiles = [] {
+        std::vector<ExportProfile> list(3);
+
+        // Default: quick to encode, good enough for messaging apps.
+        ExportProfile& fast = list[0];
+        fast.name = "share-fast";
+        fast.encoders = {"libx264", "mpeg4"};
+        fast.preset = "veryfast";
+        fast.crf = 23;
+        fast.fallbackBitRate = 6000000;
+        fast.maxGop = 60;
+        fast.bFrames = 2;
+
+        // Archival / re-edit quality; several times slower than share-fast.
+        ExportProfile& quality = list[1];
+        quality.name = "high-quality";
+        quality.encoders = {"libx264", "mpeg4"};
+        quality.preset = "medium";
+        quality.crf = 18;
+        quality.fallbackBitRate = 12000000;
+        quality.maxGop = 120;
+        quality.bFrames = 3;
+
+        // Capped bitrate for uploads over cellular. Two threads so the export
+        // can run in the background while the user keeps editing.
+        ExportProfile& small = list[2];
+        small.name = "small-upload";
+        small.encoders = {"libx264", "mpeg4"};
+        small.preset = "faster";
+        small.crf = 27;
+        small.maxRate = 2500000;
+        small.bufferSize = 5000000;
+        small.fallbackBitRate = 2000000;
+        small.maxGop = 240;
+        small.bFrames = 3;
+        small.threads = 2;
+        return list;
+    }();
+    return profiles;
+}
+
+const ExportProfile* findExportProfile(const std::string& name) {
+    for (const ExportProfile& profile : exportProfiles()) {
+        if (profile.name == name) return &profile;
+    }
+    return nullptr;
+}
+
+ExportOptions parseExportOptions(const std::string& json) {
+    ExportOptions options;
+    std::string profile = jsonField(json, "profile");
+    if (!profile.empty()) {
+        if (findExportProfile(profile)) {
+            options.profile = profile;
+        } else {
+            __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Unknown export profile '%s', using %s", profile.c_str(),
+                                options.profile.c_str());
+        }
+    }
+    options.resolution = std::max(0, static_cast<int>(jsonNumber(json, "resolution", 0)));
+    options.targetBytes = std::max<int64_t>(0, static_cast<int64_t>(jsonNumber(json, "targetBytes", 0)));
+    return options;
+}
+
+bool planTargetBitrate(int64_t targetBytes, double durationSec, double frameRate, int64_t audioBitRate, BitratePlan& plan) {
+    plan = BitratePlan();
+    if (targetBytes <= 0 || durationSec <= 0) return false;
+    double frames = durationSec * (frameRate > 0 ? frameRate : 30);
+    // AAC frames are 1024 samples; at 44.1/48 kHz that's ~45 a second.
+    double audioFrames = audioBitRate > 0 ? durationSec * 47 : 0;
+    plan.overheadBytes = kContainerFixedBytes + static_cast<int64_t>((frames + audioFrames) * kContainerBytesPerFrame);
+    double mediaBits = (targetBytes - plan.overheadBytes) * 8.0 * kTargetMargin;
+    plan.videoBitRate = static_cast<int64_t>(mediaBits / durationSec) - audioBitRate;
+    if (plan.videoBitRate < kMinVideoBitRate) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Target of %lld bytes leaves %lld bps for %.1fs of video",
+                            static_cast<long long>(targetBytes), static_cast<long long>(plan.videoBitRate), durationSec);
+        return false;
+    }
+    // Peaks may run a quarter over the average, and the 2 s buffer bounds
+    // how long they can last before the encoder has to pay them back.
+    plan.maxRate = plan.videoBitRate * 5 / 4;
+    plan.bufferSize = plan.videoBitRate * 2;
+    return true;
+}
+
+bool profileAcceptsPixelFormat(const ExportProfile& profile, AVPixelFormat pixFmt) {
+    for (const std::string& name : profile.encoders) {
+        const AVCodec* enc = avcodec_find_encoder_by_name(name.c_str());
+        if (enc) return encoderAccepts(enc, pixFmt);
+    }
+    return false;
+}
+
+AVRational encoderTimeBase(AVRational timeBase) {
+    return timeBase.num > 0 && timeBase.den > 0 && timeBase.den <= kMaxEncoderTimeBaseDen ? timeBase : kEncoderClock;
+}
+
+AVCodecContext* openProfileEncoder(const ExportProfile& profile, int width, int height, AVRational sampleAspectRatio,
+                                   AVPixelFormat pixFmt, AVRational timeBase, AVRational frameRate, bool globalHeader,
+                                   const BitratePlan* bitrate, const AVCodecParameters* match) {
+    for (const std::string& name : profile.encoders) {
+        const AVCodec* enc = avcodec_find_encoder_by_name(name.c_str());
+        if (!enc) {
+            __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Encoder %s is not in this build", name.c_str());
+            continue;
+        }
+        AVCodecContext* encCtx = avcodec_alloc_context3(enc);
+        encCtx->width = width;
+        encCtx->height = height;
+        encCtx->sample_aspect_ratio = sampleAspectRatio;
+        encCtx->pix_fmt = encoderAccepts(enc, pixFmt) ? pixFmt : AV_PIX_FMT_YUV420P;
+        encCtx->time_base = encoderTimeBase(timeBase);
+        encCtx->framerate = frameRate;
+        encCtx->gop_size = profile.maxGop;
+        encCtx->max_b_frames = profile.bFrames;
+        encCtx->thread_count = profile.threads;
+        if (globalHeader) encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (enc->id == AV_CODEC_ID_H264) av_opt_set(encCtx->priv_data, "preset", profile.preset.c_str(), 0);
+        if (match) {
+            if (match->video_delay == 0) encCtx->max_b_frames = 0;
+            if (match->level > 0) encCtx->level = match->level;
+            const char* profileName = enc->id == AV_CODEC_ID_H264 ? x264ProfileName(match->profile) : nullptr;
+            if (profileName) av_opt_set(encCtx->priv_data, "profile", profileName, 0);
+        }
+        if (bitrate) {
+            encCtx->bit_rate = bitrate->videoBitRate;
+            encCtx->rc_max_rate = bitrate->maxRate;
+            encCtx->rc_buffer_size = static_cast<int>(bitrate->bufferSize);
+        } else {
+            if (enc->id == AV_CODEC_ID_H264) {
+                av_opt_set_int(encCtx->priv_data, "crf", profile.crf, 0);
+            } else {
+                encCtx->bit_rate = profile.fallbackBitRate;
+            }
+            if (profile.maxRate > 0) {
+                encCtx->rc_max_rate = profile.maxRate;
+                encCtx->rc_buffer_size = static_cast<int>(profile.bufferSize > 0 ? profile.bufferSize : profile.maxRate * 2);
+            }
+        }
+        int ret = avcodec_open2(encCtx, enc, nullptr);
+        if (ret >= 0) return encCtx;
+        char errbuf[256];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Encoder %s (profile %s, %dx%d) failed to open: %s", name.c_str(),
+                            profile.name.c_str(), width, height, errbuf);
+        avcodec_free_context(&encCtx);
+    }
+    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No encoder available for profile %s", profile.name.c_str());
+    return nullptr;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace facebook::react {
+
+// Encoder settings for one named export target. Encoders are tried in order;
+// x264 uses preset/crf (capped by maxRate when set), the built-in fallback
+// encoders use fallbackBitRate.
+struct ExportProfile {
+  std::string name;
+  std::vector<std::string> encoders;
+  std::string preset;
+  int crf = 23;
+  int64_t maxRate = 0;
+  int64_t bufferSize = 0;
+  int64_t fallbackBitRate = 0;
+  int maxGop = 60;
+  int bFrames = 0;
+  // 0 lets the encoder use every core.
+  int threads = 0;
+};
+
+// "share-fast", "high-quality" or "small-upload"; nullptr for other names.
+const ExportProfile* findExportProfile(const std::string& name);
+const std::vector<ExportProfile>& exportProfiles();
+
+// Options passed from JS as a flat JSON object, e.g.
+// {"profile":"small-upload","resolution":720,"targetBytes":8000000}.
+struct ExportOptions {
+  std::string profile = "share-fast";
+  // Target size of the shorter side ("720" for 720p); 0 keeps the source
+  // resolution. Never upscales.
+  int resolution = 0;
+  // File size budget; 0 lets the profile's quality settings decide.
+  int64_t targetBytes = 0;
+};
+
+ExportOptions parseExportOptions(const std::string& json);
+
+// Single-pass rate control that lands an export near a file size budget:
+// average bitrate plus VBV limits so no stretch of the clip can overspend.
+struct BitratePlan {
+  int64_t videoBitRate = 0;
+  int64_t maxRate = 0;
+  int64_t bufferSize = 0;
+  int64_t overheadBytes = 0;
+};
+
+// Split targetBytes over durationSec after the audio track and the
+// container's own bytes (mostly per-sample index entries). Returns false if
+// the budget leaves too little for video.
+bool planTargetBitrate(int64_t targetBytes, double durationSec, double frameRate, int64_t audioBitRate, BitratePlan& plan);
+
+// Time base for an encoder fed frames in `timeBase`: as is when every
+// encoder here takes it, otherwise a clock fine enough for any common frame
+// rate. MPEG-4 Part 2 (the only encoder in builds without x264) codes time
+// in 16 bits and rejects the 1/90000 of most phone recordings.
+AVRational encoderTimeBase(AVRational timeBase);
+
+// Whether the first encoder of `profile` this build has takes pixFmt
+// frames as they are.
+bool profileAcceptsPixelFormat(const ExportProfile& profile, AVPixelFormat pixFmt);
+
+// Open the first available encoder of `profile` for frames of the given size
+// and sample aspect ratio, in pixFmt when the encoder takes it and yuv420p
+// otherwise. With a bitrate
+// plan the encoder runs in average-bitrate mode under its VBV limits instead
+// of the profile's CRF. With `match`, the stream keeps to its profile and
+// level and only uses B-frames if it has them, so the packets can share a
+// track with its own. The encoder runs in encoderTimeBase(timeBase), so
+// frame pts must be rescaled into its time_base. Returns nullptr if none of
+// them opens.
+AVCodecContext* openProfileEncoder(const ExportProfile& profile, int width, int height, AVRational sampleAspectRatio,
+                                   AVPixelFormat pixFmt, AVRational timeBase, AVRational frameRate, bool globalHeader,
+                                   const BitratePlan* bitrate = nullptr, const AVCodecParameters* match = nullptr);
+
+} // namespace facebook::react
@@ -0,0 +1,121 @@
+#include "Filmstrip.h"
+#include "FrameExtractor.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstring>
+#include <future>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Wide enough for a scrubber row, short enough to stay under the texture
+// limits of older GPUs once the sheet is shown as an image.
+constexpr int kMaxColumns = 10;
+
+} // namespace
+
+std::unique_ptr<Filmstrip> buildFilmstrip(const std::string& path, int count, int tileWidth, ThreadPool& pool,
+                                          const KeyframeIndex* index) {
+    if (count <= 0 || tileWidth <= 0) return nullptr;
+    auto decoder = openVideoDecoder(path);
+    if (!decoder) return nullptr;
+
+    auto strip = std::make_unique<Filmstrip>();
+    strip->tileWidth = tileWidth;
+    strip->tileHeight = 0;
+    // Tiles show the clip upright.
+    int turns = displayQuarterTurns(decoder->stream());
+    bool turned = turns & 1;
+    fitTargetSize(turned ? decoder->decCtx->height : decoder->decCtx->width, turned ? decoder->decCtx->width : decoder->decCtx->height,
+                  strip->tileWidth, strip->tileHeight);
+    strip->columns = std::min(count, kMaxColumns);
+    strip->rows = (count + strip->columns - 1) / strip->columns;
+
+    // Pass 1 (serial, demux only): one keyframe packet per tile. Targets are
+    // visited in increasing order so every seek moves forward through the
+    // file, and neighbouring tiles that land on the same GOP share a packet.
+    double duration = decoder->durationSec();
+    std::vector<AVPacket*> keyframes;
+    std::vector<int> tileToKeyframe(count, -1);
+    for (int i = 0; i < count; ++i) {
+        double target = duration > 0 ? (i + 0.5) * duration / count : 0;
+        AVPacket* pkt = readKeyframePacketAt(*decoder, target, index);
+        if (!pkt) continue;
+        if (!keyframes.empty() && keyframes.back()->pts == pkt->pts) {
+            av_packet_free(&pkt);
+        } else {
+            keyframes.push_back(pkt);
+        }
+        tileToKeyframe[i] = static_cast<int>(keyframes.size()) - 1;
+        strip->tiles.push_back({i, packetTimeSec(*decoder, keyframes.back())});
+    }
+    if (keyframes.empty()) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Filmstrip: no keyframes found");
+        return nullptr;
+    }
+
+    strip->sheet = av_frame_alloc();
+    strip->sheet->format = AV_PIX_FMT_RGBA;
+    strip->sheet->width = strip->columns * strip->tileWidth;
+    strip->sheet->height = strip->rows * strip->tileHeight;
+    if (av_frame_get_buffer(strip->sheet, 0) < 0) {
+        for (AVPacket*& pkt : keyframes) av_packet_free(&pkt);
+        return nullptr;
+    }
+    // Tiles that found no keyframe stay black.
+    for (int y = 0; y < strip->sheet->height; ++y) {
+        memset(strip->sheet->data[0] + y * strip->sheet->linesize[0], 0, strip->sheet->width * 4);
+    }
+
+    // Pass 2 (parallel): each keyframe is intra-coded, so it decodes on its
+    // own private decoder. Every task scales into its own tiles only.
+    const AVCodecParameters* par = decoder->stream()->codecpar;
+    Filmstrip* sheetOwner = strip.get();
+    std::vector<std::future<void>> jobs;
+    jobs.reserve(keyframes.size());
+    for (size_t k = 0; k < keyframes.size(); ++k) {
+        jobs.push_back(pool.submit([=, &tileToKeyframe] {
+            int codedWidth = turned ? sheetOwner->tileHeight : sheetOwner->tileWidth;
+            int codedHeight = turned ? sheetOwner->tileWidth : sheetOwner->tileHeight;
+            AVFrame* frame = decodeStandaloneKeyframe(par, keyframes[k], codedWidth, codedHeight);
+            if (!frame) return;
+            SwsContext* sws = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                             codedWidth, codedHeight, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            // Turned tiles are scaled once, then turned into each of their
+            // places in the sheet.
+            std::vector<uint8_t> scaled(turns ? static_cast<size_t>(codedWidth) * codedHeight * 4 : 0);
+            uint8_t* scaledData[4] = {scaled.data(), nullptr, nullptr, nullptr};
+            int scaledLinesize[4] = {codedWidth * 4, 0, 0, 0};
+            if (sws && turns) sws_scale(sws, frame->data, frame->linesize, 0, frame->height, scaledData, scaledLinesize);
+            if (sws) {
+                for (int tile = 0; tile < count; ++tile) {
+                    if (tileToKeyframe[tile] != static_cast<int>(k)) continue;
+                    int col = tile % sheetOwner->columns;
+                    int row = tile / sheetOwner->columns;
+                    uint8_t* dst[4] = {sheetOwner->sheet->data[0] + row * sheetOwner->tileHeight * sheetOwner->sheet->linesize[0] + col * sheetOwner->tileWidth * 4,
+                                       nullptr, nullptr, nullptr};
+                    int dstLinesize[4] = {sheetOwner->sheet->linesize[0], 0, 0, 0};
+                    if (turns) {
+                        rotateImage(scaled.data(), scaledLinesize[0], codedWidth, codedHeight, 4, turns, dst[0], dstLinesize[0]);
+                    } else {
+                        sws_scale(sws, frame->data, frame->linesize, 0, frame->height, dst, dstLinesize);
+                    }
+                }
+                sws_freeContext(sws);
+            }
+            av_frame_free(&frame);
+        }));
+    }
+    for (auto& job : jobs) job.wait();
+
+    for (AVPacket*& pkt : keyframes) av_packet_free(&pkt);
+    return strip;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace facebook::react {
+
+class KeyframeIndex;
+
+struct FilmstripTile {
+  int index = 0;
+  double timeSec = 0;
+};
+
+// Evenly spaced keyframes packed row-major into one RGBA sprite sheet.
+struct Filmstrip {
+  AVFrame* sheet = nullptr;
+  int columns = 0;
+  int rows = 0;
+  int tileWidth = 0;
+  int tileHeight = 0;
+  std::vector<FilmstripTile> tiles;
+
+  Filmstrip() = default;
+  Filmstrip(const Filmstrip&) = delete;
+  Filmstrip& operator=(const Filmstrip&) = delete;
+  ~Filmstrip() { av_frame_free(&sheet); }
+};
+
+// Opens `path` once, walks forward collecting the keyframe nearest each of
+// `count` evenly spaced timestamps, then decodes and scales those keyframes
+// in parallel on `pool` straight into their tile of the sheet. Tiles are
+// turned upright by the video's display matrix. tileWidth is the width of one
+// tile; the height follows the aspect ratio as shown. An optional keyframe
+// index for `path` makes each keyframe lookup exact.
+// Waits on its tasks, so it must not run on a thread of `pool` itself.
+std::unique_ptr<Filmstrip> buildFilmstrip(const std::string& path, int count, int tileWidth, ThreadPool& pool,
+                                          const KeyframeIndex* index = nullptr);
+
+} // namespace facebook::react
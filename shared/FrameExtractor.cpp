@@ -0,0 +1,452 @@
+#include "FrameExtractor.h"
+#include "KeyframeIndex.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/display.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// lowres halves the decoded size per step; only a few codecs (MJPEG,
+// some MPEG-4 profiles) support it, H.264/HEVC report max_lowres == 0.
+void applyLowres(AVCodecContext* decCtx, const AVCodec* dec, int targetWidth, int targetHeight) {
+    if (targetWidth <= 0 && targetHeight <= 0) return;
+    int lowres = 0;
+    int w = decCtx->width;
+    int h = decCtx->height;
+    fitTargetSize(w, h, targetWidth, targetHeight);
+    while (lowres < dec->max_lowres && (w >> (lowres + 1)) >= targetWidth && (h >> (lowres + 1)) >= targetHeight) {
+        lowres++;
+    }
+    decCtx->lowres = lowres;
+}
+
+// Send one packet and pull one frame, draining the decoder if it holds the
+// frame back for reordering.
+bool decodeSinglePacket(AVCodecContext* decCtx, const AVPacket* pkt, AVFrame* frame) {
+    if (avcodec_send_packet(decCtx, pkt) < 0) return false;
+    int ret = avcodec_receive_frame(decCtx, frame);
+    if (ret == AVERROR(EAGAIN)) {
+        avcodec_send_packet(decCtx, nullptr);
+        ret = avcodec_receive_frame(decCtx, frame);
+    }
+    return ret == 0;
+}
+
+template <int Bytes>
+void rotatePixels(const uint8_t* src, int srcStride, int width, int height, int quarterTurns, uint8_t* dst, int dstStride) {
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = src + static_cast<ptrdiff_t>(y) * srcStride;
+        for (int x = 0; x < width; ++x) {
+            int dx = x;
+            int dy = y;
+            if (quarterTurns == 1) {
+                dx = height - 1 - y;
+                dy = x;
+            } else if (quarterTurns == 2) {
+                dx = width - 1 - x;
+                dy = height - 1 - y;
+            } else if (quarterTurns == 3) {
+                dx = y;
+                dy = width - 1 - x;
+            }
+            memcpy(dst + static_cast<ptrdiff_t>(dy) * dstStride + static_cast<ptrdiff_t>(dx) * Bytes, row + x * Bytes, Bytes);
+        }
+    }
+}
+
+} // namespace
+
+VideoDecoder::~VideoDecoder() {
+    if (decCtx) avcodec_free_context(&decCtx);
+    if (fmtCtx) avformat_close_input(&fmtCtx);
+}
+
+double VideoDecoder::durationSec() const {
+    AVStream* st = stream();
+    if (st->duration != AV_NOPTS_VALUE && st->duration > 0) {
+        return st->duration * av_q2d(st->time_base);
+    }
+    if (fmtCtx->duration != AV_NOPTS_VALUE && fmtCtx->duration > 0) {
+        return static_cast<double>(fmtCtx->duration) / AV_TIME_BASE;
+    }
+    return 0;
+}
+
+std::unique_ptr<VideoDecoder> openVideoDecoder(const std::string& rawPath, int targetWidth, int targetHeight, int threadType,
+                                               bool pooledFrames) {
+    std::string path = stripFileScheme(rawPath);
+    auto decoder = std::make_unique<VideoDecoder>();
+    if (avformat_open_input(&decoder->fmtCtx, path.c_str(), nullptr, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open input: %s", path.c_str());
+        return nullptr;
+    }
+    if (avformat_find_stream_info(decoder->fmtCtx, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to find stream info");
+        return nullptr;
+    }
+    const AVCodec* dec = nullptr;
+    decoder->streamIndex = av_find_best_stream(decoder->fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &dec, 0);
+    if (decoder->streamIndex < 0 || !dec) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No decodable video stream found");
+        return nullptr;
+    }
+    decoder->decCtx = avcodec_alloc_context3(dec);
+    if (!decoder->decCtx) return nullptr;
+    if (avcodec_parameters_to_context(decoder->decCtx, decoder->stream()->codecpar) < 0) return nullptr;
+
+    applyLowres(decoder->decCtx, dec, targetWidth, targetHeight);
+    // Frame threading buffers several frames before the first output, which
+    // only pays off when decoding a whole clip.
+    decoder->decCtx->thread_type = threadType;
+    decoder->decCtx->thread_count = 0;
+    if (pooledFrames) {
+        decoder->framePool = std::make_unique<FramePool>();
+        decoder->framePool->attach(decoder->decCtx);
+    }
+
+    if (avcodec_open2(decoder->decCtx, dec, nullptr) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open decoder");
+        return nullptr;
+    }
+    return decoder;
+}
+
+bool probeVideoSize(const std::string& rawPath, int& width, int& height, bool upright) {
+    std::string path = stripFileScheme(rawPath);
+    AVFormatContext* fmtCtx = nullptr;
+    if (avformat_open_input(&fmtCtx, path.c_str(), nullptr, nullptr) < 0) return false;
+    bool found = false;
+    if (avformat_find_stream_info(fmtCtx, nullptr) >= 0) {
+        int index = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (index >= 0) {
+            width = fmtCtx->streams[index]->codecpar->width;
+            height = fmtCtx->streams[index]->codecpar->height;
+            found = width > 0 && height > 0;
+            if (upright && (displayQuarterTurns(fmtCtx->streams[index]) & 1)) std::swap(width, height);
+        }
+    }
+    avformat_close_input(&fmtCtx);
+    return found;
+}
+
+int displayQuarterTurns(const AVStream* st) {
+    const AVPacketSideData* sd = av_packet_side_data_get(st->codecpar->coded_side_data, st->codecpar->nb_coded_side_data,
+                                                         AV_PKT_DATA_DISPLAYMATRIX);
+    if (!sd || sd->size < 9 * sizeof(int32_t)) return 0;
+    // The matrix's angle is counterclockwise.
+    double degrees = av_display_rotation_get(reinterpret_cast<const int32_t*>(sd->data));
+    if (std::isnan(degrees)) return 0;
+    int turns = static_cast<int>(std::lround(-degrees / 90)) % 4;
+    return turns < 0 ? turns + 4 : turns;
+}
+
+AVPacket* readKeyframePacketAt(VideoDecoder& decoder, double timeSec, const KeyframeIndex* index) {
+    AVStream* st = decoder.stream();
+    int64_t target = av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE) target += st->start_time;
+
+    const KeyframeEntry* keyframe = index && index->streamIndex == decoder.streamIndex ? index->nearest(target) : nullptr;
+    if (!keyframe || !seekToKeyframe(decoder.fmtCtx, *index, *keyframe)) {
+        // Let the demuxer pick the closest keyframe on either side of the target.
+        if (avformat_seek_file(decoder.fmtCtx, decoder.streamIndex, INT64_MIN, target, INT64_MAX, 0) < 0) {
+            av_seek_frame(decoder.fmtCtx, decoder.streamIndex, target, AVSEEK_FLAG_BACKWARD);
+        }
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    while (av_read_frame(decoder.fmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == decoder.streamIndex && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            return pkt;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    return nullptr;
+}
+
+AVFrame* decodeKeyframeAt(VideoDecoder& decoder, double timeSec, const KeyframeIndex* index) {
+    AVPacket* pkt = readKeyframePacketAt(decoder, timeSec, index);
+    if (!pkt) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No keyframe found near %.3fs", timeSec);
+        return nullptr;
+    }
+    avcodec_flush_buffers(decoder.decCtx);
+    decoder.decCtx->skip_frame = AVDISCARD_NONKEY;
+
+    AVFrame* frame = av_frame_alloc();
+    bool gotFrame = decodeSinglePacket(decoder.decCtx, pkt, frame);
+    av_packet_free(&pkt);
+    if (!gotFrame) {
+        av_frame_free(&frame);
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No keyframe decoded near %.3fs", timeSec);
+        return nullptr;
+    }
+    return frame;
+}
+
+AVFrame* decodeStandaloneKeyframe(const AVCodecParameters* par, const AVPacket* pkt, int targetWidth, int targetHeight) {
+    const AVCodec* dec = avcodec_find_decoder(par->codec_id);
+    if (!dec) return nullptr;
+    AVCodecContext* decCtx = avcodec_alloc_context3(dec);
+    if (!decCtx) return nullptr;
+    AVFrame* frame = nullptr;
+    if (avcodec_parameters_to_context(decCtx, par) >= 0) {
+        applyLowres(decCtx, dec, targetWidth, targetHeight);
+        // Parallelism comes from running several of these at once.
+        decCtx->thread_count = 1;
+        decCtx->skip_frame = AVDISCARD_NONKEY;
+        if (avcodec_open2(decCtx, dec, nullptr) >= 0) {
+            frame = av_frame_alloc();
+            if (!decodeSinglePacket(decCtx, pkt, frame)) av_frame_free(&frame);
+        }
+    }
+    avcodec_free_context(&decCtx);
+    return frame;
+}
+
+double packetTimeSec(const VideoDecoder& decoder, const AVPacket* pkt) {
+    AVStream* st = decoder.stream();
+    int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    if (pts == AV_NOPTS_VALUE) return 0;
+    if (st->start_time != AV_NOPTS_VALUE) pts -= st->start_time;
+    return pts * av_q2d(st->time_base);
+}
+
+void seekVideoBefore(VideoDecoder& decoder, double timeSec) {
+    AVStream* st = decoder.stream();
+    int64_t target = av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE) target += st->start_time;
+    av_seek_frame(decoder.fmtCtx, decoder.streamIndex, target, AVSEEK_FLAG_BACKWARD);
+    avcodec_flush_buffers(decoder.decCtx);
+}
+
+bool decodeVideoFrames(VideoDecoder& decoder, const std::function<bool(AVFrame*)>& onFrame) {
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    bool ok = true;
+    bool draining = false;
+    bool stop = false;
+    while (!stop) {
+        if (!draining) {
+            if (av_read_frame(decoder.fmtCtx, pkt) < 0) {
+                draining = true;
+                avcodec_send_packet(decoder.decCtx, nullptr);
+            } else {
+                bool isVideo = pkt->stream_index == decoder.streamIndex;
+                if (isVideo) avcodec_send_packet(decoder.decCtx, pkt);
+                av_packet_unref(pkt);
+                if (!isVideo) continue;
+            }
+        }
+        int ret = 0;
+        while (!stop && (ret = avcodec_receive_frame(decoder.decCtx, frame)) == 0) {
+            if (!onFrame(frame)) stop = true;
+            av_frame_unref(frame);
+        }
+        if (draining && ret == AVERROR_EOF) break;
+        if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            ok = false;
+            break;
+        }
+    }
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return ok;
+}
+
+double frameTimeSec(const VideoDecoder& decoder, const AVFrame* frame) {
+    AVStream* st = decoder.stream();
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    if (pts == AV_NOPTS_VALUE) return 0;
+    if (st->start_time != AV_NOPTS_VALUE) pts -= st->start_time;
+    return pts * av_q2d(st->time_base);
+}
+
+void fitTargetSize(int srcWidth, int srcHeight, int& width, int& height) {
+    if (srcWidth <= 0 || srcHeight <= 0) return;
+    if (width <= 0 && height <= 0) {
+        width = srcWidth;
+        height = srcHeight;
+    } else if (width <= 0) {
+        width = static_cast<int>(std::lround(static_cast<double>(height) * srcWidth / srcHeight));
+    } else if (height <= 0) {
+        height = static_cast<int>(std::lround(static_cast<double>(width) * srcHeight / srcWidth));
+    }
+    // Keep chroma-subsampled outputs happy.
+    width = std::max(2, width & ~1);
+    height = std::max(2, height & ~1);
+}
+
+void rotateImage(const uint8_t* src, int srcStride, int width, int height, int bytesPerPixel, int quarterTurns, uint8_t* dst,
+                 int dstStride) {
+    quarterTurns &= 3;
+    switch (bytesPerPixel) {
+    case 1: rotatePixels<1>(src, srcStride, width, height, quarterTurns, dst, dstStride); break;
+    case 2: rotatePixels<2>(src, srcStride, width, height, quarterTurns, dst, dstStride); break;
+    case 3: rotatePixels<3>(src, srcStride, width, height, quarterTurns, dst, dstStride); break;
+    case 4: rotatePixels<4>(src, srcStride, width, height, quarterTurns, dst, dstStride); break;
+    case 8: rotatePixels<8>(src, srcStride, width, height, quarterTurns, dst, dstStride); break;
+    default: break;
+    }
+}
+
+AVFrame* rotateFrame(const AVFrame* src, int quarterTurns) {
+    AVPixelFormat format = static_cast<AVPixelFormat>(src->format);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_PAL)) ||
+        desc->log2_chroma_w != desc->log2_chroma_h) {
+        return nullptr;
+    }
+    // Bytes per pixel of each plane.
+    int pixelBytes[4] = {};
+    for (int c = 0; c < desc->nb_components; ++c) {
+        pixelBytes[desc->comp[c].plane] = std::max(pixelBytes[desc->comp[c].plane], desc->comp[c].step);
+    }
+    bool odd = quarterTurns & 1;
+    AVFrame* dst = av_frame_alloc();
+    if (!dst) return nullptr;
+    dst->format = format;
+    dst->width = odd ? src->height : src->width;
+    dst->height = odd ? src->width : src->height;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    for (int p = 0; p < av_pix_fmt_count_planes(format); ++p) {
+        int shift = p == 1 || p == 2 ? desc->log2_chroma_w : 0;
+        rotateImage(src->data[p], src->linesize[p], AV_CEIL_RSHIFT(src->width, shift), AV_CEIL_RSHIFT(src->height, shift),
+                    pixelBytes[p], quarterTurns, dst->data[p], dst->linesize[p]);
+    }
+    av_frame_copy_props(dst, src);
+    return dst;
+}
+
+bool scaleFrameInto(const AVFrame* src, int width, int height, AVPixelFormat dstFormat, uint8_t* dst, size_t dstSize,
+                    int quarterTurns) {
+    int needed = av_image_get_buffer_size(dstFormat, width, height, 1);
+    if (needed < 0 || static_cast<size_t>(needed) > dstSize) return false;
+    if (quarterTurns & 3) {
+        AVFrame* upright = scaleFrame(src, width, height, dstFormat, quarterTurns);
+        if (!upright) return false;
+        int copied = av_image_copy_to_buffer(dst, needed, upright->data, upright->linesize, dstFormat, width, height, 1);
+        av_frame_free(&upright);
+        return copied > 0;
+    }
+    SwsContext* sws = sws_getContext(src->width, src->height, static_cast<AVPixelFormat>(src->format),
+                                     width, height, dstFormat, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) return false;
+    uint8_t* dstData[4];
+    int dstLinesize[4];
+    av_image_fill_arrays(dstData, dstLinesize, dst, dstFormat, width, height, 1);
+    int rows = sws_scale(sws, src->data, src->linesize, 0, src->height, dstData, dstLinesize);
+    sws_freeContext(sws);
+    return rows > 0;
+}
+
+AVFrame* scaleFrame(const AVFrame* src, int width, int height, AVPixelFormat dstFormat, int quarterTurns) {
+    if (quarterTurns & 3) {
+        bool odd = quarterTurns & 1;
+        AVFrame* scaled = scaleFrame(src, odd ? height : width, odd ? width : height, dstFormat);
+        AVFrame* upright = scaled ? rotateFrame(scaled, quarterTurns) : nullptr;
+        av_frame_free(&scaled);
+        return upright;
+    }
+    AVFrame* dst = av_frame_alloc();
+    if (!dst) return nullptr;
+    dst->format = dstFormat;
+    dst->width = width;
+    dst->height = height;
+    if (av_frame_get_buffer(dst, 0) < 0) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    SwsContext* sws = sws_getContext(src->width, src->height, static_cast<AVPixelFormat>(src->format),
+                                     width, height, dstFormat, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        av_frame_free(&dst);
+        return nullptr;
+    }
+    sws_scale(sws, src->data, src->linesize, 0, src->height, dst->data, dst->linesize);
+    sws_freeContext(sws);
+    dst->pts = src->pts;
+    return dst;
+}
+
+bool stillFormatAvailable(const std::string& format) {
+    if (format == "jpeg" || format == "jpg") return avcodec_find_encoder(AV_CODEC_ID_MJPEG) != nullptr;
+    if (format == "webp") return avcodec_find_encoder_by_name("libwebp") != nullptr;
+    return false;
+}
+
+std::vector<uint8_t> encodeStill(const AVFrame* src, int width, int height, const std::string& format, int quarterTurns) {
+    std::vector<uint8_t> bytes;
+    const AVCodec* enc = nullptr;
+    AVPixelFormat pixFmt = AV_PIX_FMT_YUV420P;
+    if (format == "jpeg" || format == "jpg") {
+        enc = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        // MJPEG wants full-range YUV; the J formats are deprecated but are
+        // still what the encoder advertises.
+        pixFmt = AV_PIX_FMT_YUVJ420P;
+    } else if (format == "webp") {
+        enc = avcodec_find_encoder_by_name("libwebp");
+    }
+    if (!enc) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No encoder for still format: %s", format.c_str());
+        return bytes;
+    }
+
+    AVFrame* scaled = scaleFrame(src, width, height, pixFmt, quarterTurns);
+    if (!scaled) return bytes;
+
+    AVCodecContext* encCtx = avcodec_alloc_context3(enc);
+    AVPacket* pkt = av_packet_alloc();
+    encCtx->width = width;
+    encCtx->height = height;
+    encCtx->pix_fmt = pixFmt;
+    encCtx->time_base = AVRational{1, 25};
+    if (enc->id == AV_CODEC_ID_MJPEG) {
+        encCtx->flags |= AV_CODEC_FLAG_QSCALE;
+        encCtx->global_quality = FF_QP2LAMBDA * 4;
+    } else {
+        av_opt_set_double(encCtx->priv_data, "quality", 75, 0);
+    }
+    if (avcodec_open2(encCtx, enc, nullptr) >= 0) {
+        scaled->pts = 0;
+        if (avcodec_send_frame(encCtx, scaled) >= 0) {
+            avcodec_send_frame(encCtx, nullptr);
+            while (avcodec_receive_packet(encCtx, pkt) == 0) {
+                bytes.insert(bytes.end(), pkt->data, pkt->data + pkt->size);
+                av_packet_unref(pkt);
+            }
+        }
+    } else {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open still encoder");
+    }
+    av_packet_free(&pkt);
+    avcodec_free_context(&encCtx);
+    av_frame_free(&scaled);
+    return bytes;
+}
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    FILE* f = fopen(stripFileScheme(path).c_str(), "wb");
+    if (!f) return false;
+    size_t written = fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+    return written == bytes.size();
+}
+
+} // namespace facebook::react
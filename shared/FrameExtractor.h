@@ -0,0 +1,116 @@
+#pragma once
+
+#include "FramePool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+}
+
+namespace facebook::react {
+
+class KeyframeIndex;
+
+// Demuxer + video decoder pair for one clip. Owns both contexts.
+struct VideoDecoder {
+  AVFormatContext* fmtCtx = nullptr;
+  AVCodecContext* decCtx = nullptr;
+  int streamIndex = -1;
+  // Set when opened with pooledFrames.
+  std::unique_ptr<FramePool> framePool;
+
+  VideoDecoder() = default;
+  VideoDecoder(const VideoDecoder&) = delete;
+  VideoDecoder& operator=(const VideoDecoder&) = delete;
+  ~VideoDecoder();
+
+  AVStream* stream() const { return fmtCtx->streams[streamIndex]; }
+  double durationSec() const;
+};
+
+// Open `path` and its best video stream. When a target size is given,
+// lowres decoding is enabled as far as the codec allows without dropping
+// below it. Slice threading suits single-frame work; pass FF_THREAD_FRAME
+// for sequential decoding of whole clips. pooledFrames decodes into a
+// FramePool, for long runs of frames. Returns nullptr on failure.
+std::unique_ptr<VideoDecoder> openVideoDecoder(const std::string& path, int targetWidth = 0, int targetHeight = 0,
+                                               int threadType = FF_THREAD_SLICE, bool pooledFrames = false);
+
+// Read the coded size of the best video stream without opening a decoder;
+// with `upright`, the size it is shown at (see displayQuarterTurns).
+bool probeVideoSize(const std::string& path, int& width, int& height, bool upright = false);
+
+// Clockwise quarter turns (0-3) that show frames of `st` upright, from its
+// display matrix. Phones store portrait recordings as landscape frames with
+// a 90 degree display matrix.
+int displayQuarterTurns(const AVStream* st);
+
+// Seek to the keyframe nearest timeSec and return its packet without
+// decoding anything. With a keyframe index for the same file the nearest
+// keyframe is looked up exactly instead of left to the demuxer. Returns
+// nullptr when no keyframe follows the seek point.
+AVPacket* readKeyframePacketAt(VideoDecoder& decoder, double timeSec, const KeyframeIndex* index = nullptr);
+
+// Seek to the keyframe nearest timeSec and decode only that frame
+// (non-key packets are never sent to the decoder). Returns nullptr on failure.
+AVFrame* decodeKeyframeAt(VideoDecoder& decoder, double timeSec, const KeyframeIndex* index = nullptr);
+
+// Decode one keyframe packet with a private, single-threaded decoder so that
+// several keyframes can be decoded in parallel. Returns nullptr on failure.
+AVFrame* decodeStandaloneKeyframe(const AVCodecParameters* par, const AVPacket* pkt, int targetWidth = 0, int targetHeight = 0);
+
+// Seek to the last keyframe at or before timeSec and flush the decoder, so
+// decoding resumes from there.
+void seekVideoBefore(VideoDecoder& decoder, double timeSec);
+
+// Decode every frame of the video stream in order, handing each to onFrame
+// (the frame is unreferenced afterwards). Returning false from onFrame stops
+// early. Returns false on a decode error.
+bool decodeVideoFrames(VideoDecoder& decoder, const std::function<bool(AVFrame*)>& onFrame);
+
+// Presentation time of a decoded frame / demuxed packet in seconds.
+double frameTimeSec(const VideoDecoder& decoder, const AVFrame* frame);
+double packetTimeSec(const VideoDecoder& decoder, const AVPacket* pkt);
+
+// Fill in a missing (<= 0) output dimension from the frame's aspect ratio.
+void fitTargetSize(int srcWidth, int srcHeight, int& width, int& height);
+
+// Copy a width x height image of bytesPerPixel-byte pixels to dst turned
+// clockwise by quarterTurns; dst is height x width for odd turns.
+void rotateImage(const uint8_t* src, int srcStride, int width, int height, int bytesPerPixel, int quarterTurns, uint8_t* dst,
+                 int dstStride);
+
+// `src` turned clockwise by quarterTurns into a newly allocated frame. Takes
+// byte-aligned formats whose chroma is subsampled the same both ways
+// (yuv420p, nv12, rgba, ...); nullptr for others.
+AVFrame* rotateFrame(const AVFrame* src, int quarterTurns);
+
+// The scaling functions below take the output size as shown: with
+// quarterTurns the frame is scaled to the turned size, then turned.
+
+// Scale + convert in one swscale pass into a tightly packed buffer
+// (alignment 1), e.g. RGBA for direct upload to a JS ArrayBuffer.
+bool scaleFrameInto(const AVFrame* src, int width, int height, AVPixelFormat dstFormat, uint8_t* dst, size_t dstSize,
+                    int quarterTurns = 0);
+
+// Scale + convert in one swscale pass into a newly allocated frame.
+AVFrame* scaleFrame(const AVFrame* src, int width, int height, AVPixelFormat dstFormat, int quarterTurns = 0);
+
+// Scale `src` to width x height and encode it as a still image
+// ("jpeg"/"jpg" or "webp"). Returns an empty vector on failure.
+std::vector<uint8_t> encodeStill(const AVFrame* src, int width, int height, const std::string& format, int quarterTurns = 0);
+
+// Whether encodeStill can produce `format` in this build. WebP needs libwebp,
+// which the bundled FFmpeg is built without.
+bool stillFormatAvailable(const std::string& format);
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes);
+
+} // namespace facebook::react
@@ -0,0 +1,127 @@
+#include "FramePool.h"
+#include <android/log.h>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Stride alignment for frames that don't come from a decoder; enough for
+// NEON/SSE loads in swscale and the encoders.
+constexpr int kStrideAlign = 64;
+
+} // namespace
+
+FramePool::~FramePool() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseLocked();
+}
+
+void FramePool::releaseLocked() {
+    for (AVBufferPool*& pool : pools_) {
+        if (pool) av_buffer_pool_uninit(&pool);
+    }
+}
+
+AVBufferRef* FramePool::allocBuffer(void* opaque, size_t size) {
+    // Only plane 0's pool counts, so one frame is one allocation. Runs under
+    // mutex_ from inside getBuffer.
+    if (opaque) static_cast<FramePool*>(opaque)->stats_.peakResidentFrames++;
+    return av_buffer_alloc(size);
+}
+
+int FramePool::resetLocked(const AVFrame* frame, AVCodecContext* decCtx) {
+    releaseLocked();
+    format_ = -1;
+    AVPixelFormat format = static_cast<AVPixelFormat>(frame->format);
+    int width = frame->width;
+    int height = frame->height;
+    int strideAlign[AV_NUM_DATA_POINTERS];
+    if (decCtx) {
+        avcodec_align_dimensions2(decCtx, &width, &height, strideAlign);
+    } else {
+        for (int& align : strideAlign) align = kStrideAlign;
+    }
+    // Widen until every plane's stride is aligned, as FFmpeg's default
+    // allocator does.
+    int linesizes[4];
+    int unaligned;
+    do {
+        int ret = av_image_fill_linesizes(linesizes, format, width);
+        if (ret < 0) return ret;
+        width += width & ~(width - 1);
+        unaligned = 0;
+        for (int i = 0; i < 4; ++i) unaligned |= linesizes[i] % strideAlign[i];
+    } while (unaligned);
+
+    ptrdiff_t strides[4];
+    for (int i = 0; i < 4; ++i) strides[i] = linesizes[i];
+    size_t sizes[4];
+    int ret = av_image_fill_plane_sizes(sizes, format, height, strides);
+    if (ret < 0) return ret;
+    for (int i = 0; i < 4 && sizes[i] > 0; ++i) {
+        // Same tail padding as the default allocator: decoders may read a
+        // little past the last row.
+        pools_[i] = av_buffer_pool_init2(sizes[i] + 16 + kStrideAlign - 1, i == 0 ? this : nullptr, &FramePool::allocBuffer, nullptr);
+        if (!pools_[i]) {
+            releaseLocked();
+            return AVERROR(ENOMEM);
+        }
+        linesize_[i] = linesizes[i];
+    }
+    format_ = frame->format;
+    width_ = frame->width;
+    height_ = frame->height;
+    stats_.peakResidentFrames = 0;
+    return 0;
+}
+
+int FramePool::getBuffer(AVFrame* frame, AVCodecContext* decCtx) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame->format != format_ || frame->width != width_ || frame->height != height_) {
+        int ret = resetLocked(frame, decCtx);
+        if (ret < 0) return ret;
+    }
+    uint64_t allocated = stats_.peakResidentFrames;
+    for (int i = 0; i < 4 && pools_[i]; ++i) {
+        frame->buf[i] = av_buffer_pool_get(pools_[i]);
+        if (!frame->buf[i]) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = linesize_[i];
+    }
+    frame->extended_data = frame->data;
+    stats_.requests++;
+    if (stats_.peakResidentFrames == allocated) stats_.hits++;
+    return 0;
+}
+
+int FramePool::getBuffer2(AVCodecContext* decCtx, AVFrame* frame, int flags) {
+    auto* pool = static_cast<FramePool*>(decCtx->opaque);
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+    if (!pool || decCtx->codec_type != AVMEDIA_TYPE_VIDEO || !(decCtx->codec->capabilities & AV_CODEC_CAP_DR1) || !desc ||
+        (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+        return avcodec_default_get_buffer2(decCtx, frame, flags);
+    }
+    int ret = pool->getBuffer(frame, decCtx);
+    if (ret < 0) __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Frame pool allocation failed (%d)", ret);
+    return ret;
+}
+
+void FramePool::attach(AVCodecContext* decCtx) {
+    decCtx->opaque = this;
+    decCtx->get_buffer2 = &FramePool::getBuffer2;
+}
+
+FramePoolStats FramePool::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+namespace facebook::react {
+
+struct FramePoolStats {
+  uint64_t requests = 0;
+  uint64_t hits = 0;
+  // Buffers the pool had to create for the current geometry, which is also
+  // the most frames that were alive at once.
+  uint64_t peakResidentFrames = 0;
+};
+
+// Picture buffers recycled through AVBufferPool: once a pipeline reaches its
+// steady state every frame reuses memory released by an earlier one, so
+// there are no large allocations per frame. Thread-safe. The pool is rebuilt
+// when the frame geometry changes; buffers still in flight keep the old one
+// alive until they are released.
+class FramePool {
+public:
+  FramePool() = default;
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+  ~FramePool();
+
+  // Give `frame` (format, width and height set) pooled buffers. With a
+  // decoder context the planes are padded and aligned the way that codec
+  // needs. Returns 0 or an AVERROR.
+  int getBuffer(AVFrame* frame, AVCodecContext* decCtx = nullptr);
+
+  // Route decCtx's picture allocations through this pool (call before
+  // avcodec_open2). Codecs that cannot decode into caller-provided buffers
+  // keep the default allocator. The pool must outlive the decoder.
+  void attach(AVCodecContext* decCtx);
+
+  FramePoolStats stats();
+
+private:
+  static int getBuffer2(AVCodecContext* decCtx, AVFrame* frame, int flags);
+  static AVBufferRef* allocBuffer(void* opaque, size_t size);
+  int resetLocked(const AVFrame* frame, AVCodecContext* decCtx);
+  void releaseLocked();
+
+  std::mutex mutex_;
+  int format_ = -1;
+  int width_ = 0;
+  int height_ = 0;
+  int linesize_[4] = {};
+  AVBufferPool* pools_[4] = {};
+  FramePoolStats stats_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,214 @@
+#include "KeyframeIndex.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace facebook::react {
+
+namespace {
+
+constexpr uint32_t kIndexMagic = 0x314b5853;  // "SXK1"
+
+bool statFile(const std::string& path, int64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+template <typename T>
+bool writePod(FILE* f, const T& value) {
+    return fwrite(&value, sizeof(T), 1, f) == 1;
+}
+
+template <typename T>
+bool readPod(FILE* f, T& value) {
+    return fread(&value, sizeof(T), 1, f) == 1;
+}
+
+} // namespace
+
+std::string KeyframeIndex::sidecarPathFor(const std::string& mediaPath) {
+    std::string path = stripFileScheme(mediaPath);
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) path = path.substr(0, dot);
+    return path + ".kfindex";
+}
+
+std::shared_ptr<KeyframeIndex> KeyframeIndex::build(const std::string& mediaPath) {
+    std::string path = stripFileScheme(mediaPath);
+    auto index = std::make_shared<KeyframeIndex>();
+    if (!statFile(path, index->fileSize_, index->fileMtime_)) return nullptr;
+
+    AVFormatContext* fmtCtx = nullptr;
+    if (avformat_open_input(&fmtCtx, path.c_str(), nullptr, nullptr) < 0) return nullptr;
+    if (avformat_find_stream_info(fmtCtx, nullptr) < 0) {
+        avformat_close_input(&fmtCtx);
+        return nullptr;
+    }
+    index->streamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (index->streamIndex < 0) {
+        avformat_close_input(&fmtCtx);
+        return nullptr;
+    }
+    AVStream* st = fmtCtx->streams[index->streamIndex];
+    index->timeBase = st->time_base;
+    index->startTime = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    for (unsigned int i = 0; i < fmtCtx->nb_streams; i++) {
+        if (static_cast<int>(i) != index->streamIndex) fmtCtx->streams[i]->discard = AVDISCARD_ALL;
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    while (av_read_frame(fmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == index->streamIndex) {
+            if (pkt->flags & AV_PKT_FLAG_KEY) {
+                KeyframeEntry entry;
+                entry.pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+                entry.dts = pkt->dts;
+                entry.pos = pkt->pos;
+                index->entries.push_back(entry);
+            }
+            if (!index->entries.empty()) index->entries.back().gopFrames++;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&fmtCtx);
+
+    // Keyframes come out in decode order; open-GOP streams can have a
+    // keyframe's pts slightly out of order, and lookups need pts order.
+    std::stable_sort(index->entries.begin(), index->entries.end(),
+                     [](const KeyframeEntry& a, const KeyframeEntry& b) { return a.pts < b.pts; });
+    return index;
+}
+
+bool KeyframeIndex::save(const std::string& mediaPath) const {
+    std::string sidecar = sidecarPathFor(mediaPath);
+    std::string tmpPath = sidecar + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) return false;
+    bool ok = writePod(f, kIndexMagic) && writePod(f, fileSize_) && writePod(f, fileMtime_) &&
+              writePod(f, static_cast<int32_t>(streamIndex)) && writePod(f, static_cast<int32_t>(timeBase.num)) &&
+              writePod(f, static_cast<int32_t>(timeBase.den)) && writePod(f, startTime) &&
+              writePod(f, static_cast<uint32_t>(entries.size()));
+    if (ok && !entries.empty()) ok = fwrite(entries.data(), sizeof(KeyframeEntry), entries.size(), f) == entries.size();
+    fclose(f);
+    if (!ok || rename(tmpPath.c_str(), sidecar.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<KeyframeIndex> KeyframeIndex::load(const std::string& mediaPath) {
+    std::string path = stripFileScheme(mediaPath);
+    int64_t size = 0;
+    int64_t mtime = 0;
+    if (!statFile(path, size, mtime)) return nullptr;
+    FILE* f = fopen(sidecarPathFor(path).c_str(), "rb");
+    if (!f) return nullptr;
+
+    auto index = std::make_shared<KeyframeIndex>();
+    uint32_t magic = 0;
+    int32_t stream = 0;
+    int32_t tbNum = 0;
+    int32_t tbDen = 0;
+    uint32_t count = 0;
+    bool ok = readPod(f, magic) && magic == kIndexMagic && readPod(f, index->fileSize_) && readPod(f, index->fileMtime_) &&
+              index->fileSize_ == size && index->fileMtime_ == mtime &&
+              readPod(f, stream) && readPod(f, tbNum) && readPod(f, tbDen) && tbDen > 0 &&
+              readPod(f, index->startTime) && readPod(f, count);
+    if (ok) {
+        index->streamIndex = stream;
+        index->timeBase = AVRational{tbNum, tbDen};
+        index->entries.resize(count);
+        ok = count == 0 || fread(index->entries.data(), sizeof(KeyframeEntry), count, f) == count;
+    }
+    fclose(f);
+    return ok ? index : nullptr;
+}
+
+bool KeyframeIndex::matchesFile(const std::string& mediaPath) const {
+    int64_t size = 0;
+    int64_t mtime = 0;
+    return statFile(stripFileScheme(mediaPath), size, mtime) && size == fileSize_ && mtime == fileMtime_;
+}
+
+const KeyframeEntry* KeyframeIndex::atOrBefore(int64_t pts) const {
+    if (entries.empty()) return nullptr;
+    auto it = std::upper_bound(entries.begin(), entries.end(), pts,
+                               [](int64_t value, const KeyframeEntry& e) { return value < e.pts; });
+    if (it == entries.begin()) return &entries.front();
+    return &*std::prev(it);
+}
+
+const KeyframeEntry* KeyframeIndex::nearest(int64_t pts) const {
+    const KeyframeEntry* before = atOrBefore(pts);
+    if (!before) return nullptr;
+    const KeyframeEntry* after = before + 1;
+    if (after < entries.data() + entries.size() && after->pts - pts < pts - before->pts) return after;
+    return before;
+}
+
+int64_t KeyframeIndex::ptsForTime(double timeSec) const {
+    return startTime + av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, timeBase);
+}
+
+double KeyframeIndex::timeForPts(int64_t pts) const {
+    return (pts - startTime) * av_q2d(timeBase);
+}
+
+bool seekToKeyframe(AVFormatContext* fmtCtx, const KeyframeIndex& index, const KeyframeEntry& keyframe) {
+    if (index.streamIndex < 0 || index.streamIndex >= static_cast<int>(fmtCtx->nb_streams)) return false;
+    AVStream* st = fmtCtx->streams[index.streamIndex];
+    bool containerIndexed = avformat_index_get_entries_count(st) > 0;
+    if (!containerIndexed && keyframe.pos >= 0 && !(fmtCtx->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        if (av_seek_frame(fmtCtx, index.streamIndex, keyframe.pos, AVSEEK_FLAG_BYTE) >= 0) return true;
+    }
+    int64_t ts = keyframe.dts != AV_NOPTS_VALUE ? std::min(keyframe.pts, keyframe.dts) : keyframe.pts;
+    return av_seek_frame(fmtCtx, index.streamIndex, ts, AVSEEK_FLAG_BACKWARD) >= 0;
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndexStore::find(const std::string& mediaPath) {
+    std::string path = stripFileScheme(mediaPath);
+    std::shared_ptr<const KeyframeIndex> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = indexes_.find(path);
+        if (it != indexes_.end()) cached = it->second;
+    }
+    // The clip may have been rewritten in place (re-recorded, trimmed over).
+    if (cached && cached->matchesFile(path)) return cached;
+    if (cached) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = indexes_.find(path);
+        if (it != indexes_.end() && it->second == cached) indexes_.erase(it);
+    }
+    std::shared_ptr<const KeyframeIndex> index = KeyframeIndex::load(path);
+    if (!index) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    indexes_[path] = index;
+    return index;
+}
+
+std::shared_ptr<const KeyframeIndex> KeyframeIndexStore::build(const std::string& mediaPath) {
+    std::string path = stripFileScheme(mediaPath);
+    std::shared_ptr<KeyframeIndex> index = KeyframeIndex::build(path);
+    if (!index) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to build keyframe index for %s", path.c_str());
+        return nullptr;
+    }
+    if (!index->save(path)) {
+        // Read-only location: keep it in memory for this session.
+        __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Could not write keyframe index sidecar for %s", path.c_str());
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    indexes_[path] = index;
+    return index;
+}
+
+} // namespace facebook::react
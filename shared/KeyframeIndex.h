@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace facebook::react {
+
+struct KeyframeEntry {
+  int64_t pts = 0;
+  int64_t dts = 0;
+  // Byte offset of the packet in the file, -1 if the demuxer didn't know it.
+  int64_t pos = -1;
+  // Video packets from this keyframe up to (not including) the next one.
+  uint32_t gopFrames = 0;
+};
+
+// Keyframes of a clip's video stream in presentation order, persisted as a
+// compact binary sidecar ("<name>.kfindex") next to the clip and validated
+// against the clip's size and mtime.
+class KeyframeIndex {
+public:
+  static std::string sidecarPathFor(const std::string& mediaPath);
+
+  // One packet-level pass over the file (nothing is decoded).
+  static std::shared_ptr<KeyframeIndex> build(const std::string& mediaPath);
+  // nullptr if there is no sidecar or it is stale.
+  static std::shared_ptr<KeyframeIndex> load(const std::string& mediaPath);
+  bool save(const std::string& mediaPath) const;
+  // Whether the clip still has the size and mtime the index was built from.
+  bool matchesFile(const std::string& mediaPath) const;
+
+  // Binary searches over `entries`; nullptr when the index is empty.
+  const KeyframeEntry* atOrBefore(int64_t pts) const;
+  const KeyframeEntry* nearest(int64_t pts) const;
+
+  // Convert between seconds from the start of the clip and stream pts.
+  int64_t ptsForTime(double timeSec) const;
+  double timeForPts(int64_t pts) const;
+
+  int streamIndex = -1;
+  AVRational timeBase{1, 1};
+  int64_t startTime = 0;
+  std::vector<KeyframeEntry> entries;
+
+private:
+  int64_t fileSize_ = 0;
+  int64_t fileMtime_ = 0;
+};
+
+// Seek fmtCtx so the next video packet read is exactly `keyframe`: a byte
+// seek when the container has no index of its own, otherwise a timestamp
+// seek to the keyframe's exact pts (which the demuxer resolves immediately).
+bool seekToKeyframe(AVFormatContext* fmtCtx, const KeyframeIndex& index, const KeyframeEntry& keyframe);
+
+// Process-wide cache of loaded indexes keyed by media path.
+class KeyframeIndexStore {
+public:
+  // Memory first, then the sidecar on disk; never builds. Indexes whose clip
+  // has changed since are dropped. May return nullptr.
+  std::shared_ptr<const KeyframeIndex> find(const std::string& mediaPath);
+  // Build (and persist) a fresh index. Blocking; run on a worker thread.
+  std::shared_ptr<const KeyframeIndex> build(const std::string& mediaPath);
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const KeyframeIndex>> indexes_;
+};
+
+} // namespace facebook::react
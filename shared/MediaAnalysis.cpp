@@ -0,0 +1,489 @@
+#include "MediaAnalysis.h"
+#include "AudioDecoder.h"
+#include "FrameExtractor.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace facebook::react {
+
+namespace {
+
+// Peaks don't need full bandwidth; 16 kHz mono keeps the resampler and the
+// reduction cheap while still catching transients.
+constexpr int kWaveformSampleRate = 16000;
+
+// Stream partial results roughly this many times per clip.
+constexpr int kWaveformUpdates = 16;
+
+// Width the scene analysis works at; cuts are obvious even at thumbnail size.
+constexpr int kAnalysisWidth = 128;
+
+// Pick the largest power-of-two decimation that keeps the plane at least
+// kAnalysisWidth wide.
+int decimationStep(int width) {
+    int step = 1;
+    while (step < 16 && width / (step * 2) >= kAnalysisWidth) step *= 2;
+    return step;
+}
+
+// Make the decoder as cheap as possible for statistics-only passes: skip the
+// in-loop deblocking filter, take the fast (non bit-exact) paths and drop
+// non-reference frames, which at worst reports a cut one frame late.
+void configureAnalysisDecoder(AVCodecContext* decCtx) {
+    decCtx->skip_frame = AVDISCARD_NONREF;
+    decCtx->skip_loop_filter = AVDISCARD_ALL;
+    decCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+}
+
+// Edge analysis. Black: dark and flat (covers both limited- and full-range
+// black). Frozen: a repeated frame, far below the sensor noise of any live
+// camera shot, so static tripod footage is not mistaken for it.
+constexpr double kBlackMaxMean = 32.0;
+constexpr double kBlackMaxStdDev = 10.0;
+constexpr double kFrozenMaxMeanDiff = 0.1;
+
+// -50 dBFS over 20 ms windows: below a phone mic's room-noise floor.
+constexpr int kSilenceSampleRate = 16000;
+constexpr size_t kSilenceWindow = kSilenceSampleRate / 50;
+constexpr double kSilenceMaxRms = 0.00316;
+
+// Anything shorter than this after trimming is left alone.
+constexpr double kMinTrimmedSec = 0.5;
+
+struct FrameClass {
+    double timeSec = 0;
+    double endSec = 0;
+    bool dead = false;
+    bool keyframe = false;
+};
+
+// Decode from the decoder's current position, classifying every frame until
+// one starts after untilSec (or the stream ends).
+bool classifyFrames(VideoDecoder& decoder, double untilSec, std::vector<FrameClass>& frames) {
+    AVStream* st = decoder.stream();
+    double fallbackDuration = st->avg_frame_rate.num > 0 ? av_q2d(av_inv_q(st->avg_frame_rate)) : 1.0 / 30;
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> previous;
+    return decodeVideoFrames(decoder, [&](AVFrame* frame) {
+        double t = frameTimeSec(decoder, frame);
+        if (t > untilSec) return false;
+        int step = decimationStep(frame->width);
+        int w = frame->width / step;
+        int h = frame->height / step;
+        if (w <= 0 || h <= 0) return true;
+        current.resize(static_cast<size_t>(w) * h);
+        decimatePlane(frame->data[0], frame->linesize[0], frame->width, frame->height, step, current.data());
+
+        uint64_t sum = 0;
+        uint64_t sumSq = 0;
+        sumAndSquares(current.data(), current.size(), sum, sumSq);
+        double mean = static_cast<double>(sum) / current.size();
+        double variance = std::max(0.0, static_cast<double>(sumSq) / current.size() - mean * mean);
+        bool black = mean <= kBlackMaxMean && std::sqrt(variance) <= kBlackMaxStdDev;
+        bool frozen = previous.size() == current.size() &&
+                      static_cast<double>(sumAbsDiff(current.data(), previous.data(), current.size())) / current.size() <= kFrozenMaxMeanDiff;
+
+        FrameClass fc;
+        fc.timeSec = t;
+        fc.endSec = t + (frame->duration > 0 ? frame->duration * av_q2d(st->time_base) : fallbackDuration);
+        fc.dead = black || frozen;
+        fc.keyframe = (frame->flags & AV_FRAME_FLAG_KEY) != 0;
+        // The first frame of a frozen run only turns out to be frozen once
+        // its repeat arrives.
+        if (frozen && !frames.empty() && frames.back().timeSec < t) frames.back().dead = true;
+        frames.push_back(fc);
+        std::swap(current, previous);
+        return true;
+    });
+}
+
+// EBU R128 / ITU-R BS.1770-4 at 48 kHz stereo (L/R weight 1). Energy is
+// kept per 100 ms step; gating blocks (400 ms) and short-term windows (3 s)
+// are averages of consecutive steps, so there is no sample history.
+constexpr int kLoudnessSampleRate = 48000;
+constexpr size_t kLoudnessStep = kLoudnessSampleRate / 10;
+constexpr size_t kMomentarySteps = 4;
+constexpr size_t kShortTermSteps = 30;
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kRelativeGateLu = -10.0;
+constexpr double kRangeGateLu = -20.0;
+
+// True peak: 4x oversampling through a 48-tap windowed-sinc interpolator
+// (12 taps per phase), as BS.1770-4 Annex 2 suggests.
+constexpr int kOversample = 4;
+constexpr int kPhaseTaps = 12;
+// Digital silence reports -140 dBTP rather than -inf.
+constexpr double kPeakFloor = 1e-7;
+
+double energyToLufs(double energy) {
+    return energy > 0 ? -0.691 + 10.0 * std::log10(energy) : -HUGE_VAL;
+}
+
+double lufsToEnergy(double lufs) {
+    return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+class LoudnessMeter {
+public:
+  LoudnessMeter() {
+      // K-weighting: high-shelf pre-filter, then the RLB high-pass.
+      const double pi = 3.14159265358979323846;
+      double k = std::tan(pi * 1681.974450955533 / kLoudnessSampleRate);
+      double q = 0.7071752369554196;
+      double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+      double vb = std::pow(vh, 0.4996667741545416);
+      double a0 = 1.0 + k / q + k * k;
+      double shelf[5] = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                         2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+      k = std::tan(pi * 38.13547087602444 / kLoudnessSampleRate);
+      q = 0.5003270373238773;
+      a0 = 1.0 + k / q + k * k;
+      double highPass[5] = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+      std::copy(shelf, shelf + 5, coeffs_);
+      std::copy(highPass, highPass + 5, coeffs_ + 5);
+
+      const double center = (kOversample * kPhaseTaps - 1) / 2.0;
+      for (int n = 0; n < kOversample * kPhaseTaps; ++n) {
+          double t = (n - center) / kOversample;
+          double sinc = t == 0 ? 1.0 : std::sin(pi * t) / (pi * t);
+          double window = 0.5 - 0.5 * std::cos(2.0 * pi * (n + 0.5) / (kOversample * kPhaseTaps));
+          taps_[n % kOversample][n / kOversample] = sinc * window;
+      }
+  }
+
+  // Interleaved stereo at kLoudnessSampleRate.
+  void addSamples(const float* samples, size_t frames) {
+      size_t offset = 0;
+      while (offset < frames) {
+          size_t take = std::min(frames - offset, kLoudnessStep - stepFrames_);
+          biquadCascadeStereo(samples + offset * 2, take, coeffs_, state_, stepSumSq_);
+          trackTruePeak(samples + offset * 2, take);
+          stepFrames_ += take;
+          offset += take;
+          if (stepFrames_ == kLoudnessStep) {
+              steps_.push_back((stepSumSq_[0] + stepSumSq_[1]) / kLoudnessStep);
+              stepSumSq_[0] = stepSumSq_[1] = 0;
+              stepFrames_ = 0;
+          }
+      }
+      totalFrames_ += frames;
+  }
+
+  LoudnessStats result() const {
+      LoudnessStats stats;
+      stats.durationSec = static_cast<double>(totalFrames_) / kLoudnessSampleRate;
+      stats.truePeakDbtp = 20.0 * std::log10(std::max(peak_, kPeakFloor));
+      stats.integratedLufs = gatedLoudness(windowEnergies(kMomentarySteps), kRelativeGateLu);
+
+      // Loudness range: spread (10th to 95th percentile) of the gated
+      // short-term loudness.
+      std::vector<double> shortTerm = windowEnergies(kShortTermSteps);
+      double gate = std::max(kAbsoluteGateLufs, gatedLoudness(shortTerm, 0) + kRangeGateLu);
+      std::vector<double> levels;
+      for (double e : shortTerm) {
+          double lufs = energyToLufs(e);
+          if (lufs > gate) levels.push_back(lufs);
+      }
+      if (levels.size() >= 2) {
+          std::sort(levels.begin(), levels.end());
+          auto at = [&](double p) { return levels[static_cast<size_t>(std::lround(p * (levels.size() - 1)))]; };
+          stats.loudnessRange = at(0.95) - at(0.10);
+      }
+      return stats;
+  }
+
+private:
+  // Mean energy of every window of `length` steps, hopping one step.
+  std::vector<double> windowEnergies(size_t length) const {
+      std::vector<double> windows;
+      double sum = 0;
+      for (size_t i = 0; i < steps_.size(); ++i) {
+          sum += steps_[i];
+          if (i >= length) sum -= steps_[i - length];
+          if (i + 1 >= length) windows.push_back(std::max(0.0, sum) / length);
+      }
+      return windows;
+  }
+
+  // Mean loudness of the windows above the absolute gate, then of those
+  // within relativeGateLu of that (skipped when relativeGateLu is 0).
+  // Silence reports the absolute gate.
+  static double gatedLoudness(const std::vector<double>& windows, double relativeGateLu) {
+      double gate = lufsToEnergy(kAbsoluteGateLufs);
+      for (int pass = 0; pass < (relativeGateLu != 0 ? 2 : 1); ++pass) {
+          double sum = 0;
+          size_t count = 0;
+          for (double e : windows) {
+              if (e <= gate) continue;
+              sum += e;
+              count++;
+          }
+          if (count == 0) return kAbsoluteGateLufs;
+          if (pass == 1 || relativeGateLu == 0) return energyToLufs(sum / count);
+          gate = lufsToEnergy(energyToLufs(sum / count) + relativeGateLu);
+      }
+      return kAbsoluteGateLufs;
+  }
+
+  void trackTruePeak(const float* samples, size_t frames) {
+      float lo = 0;
+      float hi = 0;
+      double unused = 0;
+      reducePeaks(samples, frames * 2, lo, hi, unused);
+      peak_ = std::max(peak_, static_cast<double>(std::max(-lo, hi)));
+      for (size_t i = 0; i < frames; ++i) {
+          for (int c = 0; c < 2; ++c) {
+              double* history = history_[c];
+              std::copy_backward(history, history + kPhaseTaps - 1, history + kPhaseTaps);
+              history[0] = samples[i * 2 + c];
+              for (int phase = 0; phase < kOversample; ++phase) {
+                  double v = 0;
+                  for (int t = 0; t < kPhaseTaps; ++t) v += taps_[phase][t] * history[t];
+                  peak_ = std::max(peak_, std::fabs(v));
+              }
+          }
+      }
+  }
+
+  double coeffs_[10];
+  double state_[8] = {};
+  double stepSumSq_[2] = {};
+  size_t stepFrames_ = 0;
+  size_t totalFrames_ = 0;
+  std::vector<double> steps_;
+  double taps_[kOversample][kPhaseTaps];
+  double history_[2][kPhaseTaps] = {};
+  double peak_ = 0;
+};
+
+} // namespace
+
+bool extractWaveformPeaks(const std::string& path, int buckets,
+                          const std::function<void(int, const std::vector<float>&)>& onPartial,
+                          std::vector<float>& peaks) {
+    if (buckets <= 0) return false;
+    auto decoder = openAudioDecoder(path, kWaveformSampleRate, 1);
+    if (!decoder) return false;
+
+    double duration = decoder->durationSec();
+    size_t expectedSamples = static_cast<size_t>(std::max(1.0, duration * kWaveformSampleRate));
+    size_t samplesPerBucket = std::max<size_t>(1, (expectedSamples + buckets - 1) / buckets);
+    int batch = std::max(1, buckets / kWaveformUpdates);
+
+    struct Bucket {
+        float min = 0;
+        float max = 0;
+        double sumSq = 0;
+        size_t count = 0;
+    };
+    std::vector<Bucket> state(buckets);
+    size_t sampleIndex = 0;
+    int nextToEmit = 0;
+
+    auto emitUpTo = [&](int endBucket) {
+        if (endBucket <= nextToEmit) return;
+        std::vector<float> partial;
+        partial.reserve(static_cast<size_t>(endBucket - nextToEmit) * 3);
+        for (int b = nextToEmit; b < endBucket; ++b) {
+            const Bucket& s = state[b];
+            partial.push_back(s.count ? s.min : 0.0f);
+            partial.push_back(s.count ? s.max : 0.0f);
+            partial.push_back(s.count ? static_cast<float>(std::sqrt(s.sumSq / s.count)) : 0.0f);
+        }
+        peaks.insert(peaks.end(), partial.begin(), partial.end());
+        if (onPartial) onPartial(nextToEmit, partial);
+        nextToEmit = endBucket;
+    };
+
+    bool ok = decodeAudio(*decoder, [&](const float* samples, size_t frames) {
+        size_t offset = 0;
+        while (offset < frames) {
+            // Overrun of the duration estimate all lands in the last bucket.
+            int bucket = static_cast<int>(std::min<size_t>(sampleIndex / samplesPerBucket, buckets - 1));
+            size_t bucketEnd = bucket == buckets - 1 ? SIZE_MAX : (bucket + 1) * samplesPerBucket;
+            size_t take = std::min(frames - offset, bucketEnd - sampleIndex);
+            Bucket& s = state[bucket];
+            if (s.count == 0) {
+                s.min = samples[offset];
+                s.max = samples[offset];
+            }
+            reducePeaks(samples + offset, take, s.min, s.max, s.sumSq);
+            s.count += take;
+            offset += take;
+            sampleIndex += take;
+        }
+        int completed = static_cast<int>(std::min<size_t>(sampleIndex / samplesPerBucket, buckets - 1));
+        if (completed - nextToEmit >= batch) emitUpTo(completed);
+        return true;
+    });
+    emitUpTo(buckets);
+    return ok;
+}
+
+bool detectSceneChanges(const std::string& path, double threshold, int maxCuts, double minSpacingSec,
+                        std::vector<SceneCut>& cuts, double& durationSec) {
+    auto decoder = openVideoDecoder(path, kAnalysisWidth, 0, FF_THREAD_FRAME);
+    if (!decoder) return false;
+    configureAnalysisDecoder(decoder->decCtx);
+    durationSec = decoder->durationSec();
+
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> previous;
+    uint32_t prevHist[64] = {};
+    bool havePrevious = false;
+    std::vector<SceneCut> candidates;
+
+    bool ok = decodeVideoFrames(*decoder, [&](AVFrame* frame) {
+        // Every YUV format we decode from cameras has a full-resolution
+        // 8-bit luma plane first.
+        int step = decimationStep(frame->width);
+        int w = frame->width / step;
+        int h = frame->height / step;
+        if (w <= 0 || h <= 0) return true;
+        current.resize(static_cast<size_t>(w) * h);
+        decimatePlane(frame->data[0], frame->linesize[0], frame->width, frame->height, step, current.data());
+
+        uint32_t hist[64] = {};
+        histogram64(current.data(), current.size(), hist);
+        if (havePrevious && previous.size() == current.size()) {
+            uint64_t histDistance = 0;
+            for (int b = 0; b < 64; ++b) histDistance += hist[b] > prevHist[b] ? hist[b] - prevHist[b] : prevHist[b] - hist[b];
+            double histScore = static_cast<double>(histDistance) / (2.0 * current.size());
+            double diffScore = static_cast<double>(sumAbsDiff(current.data(), previous.data(), current.size())) / (255.0 * current.size());
+            double score = 0.5 * histScore + 0.5 * diffScore;
+            if (score >= threshold) candidates.push_back({frameTimeSec(*decoder, frame), score});
+        }
+        std::swap(current, previous);
+        memcpy(prevHist, hist, sizeof(hist));
+        havePrevious = true;
+        return true;
+    });
+
+    // Strongest first, then drop weaker cuts too close to a stronger one
+    // (fades and camera flashes produce runs of high-scoring frames).
+    std::sort(candidates.begin(), candidates.end(), [](const SceneCut& a, const SceneCut& b) { return a.score > b.score; });
+    for (const SceneCut& candidate : candidates) {
+        if (maxCuts > 0 && static_cast<int>(cuts.size()) >= maxCuts) break;
+        bool tooClose = false;
+        for (const SceneCut& kept : cuts) {
+            if (std::abs(kept.timeSec - candidate.timeSec) < minSpacingSec) {
+                tooClose = true;
+                break;
+            }
+        }
+        if (!tooClose) cuts.push_back(candidate);
+    }
+    return ok;
+}
+
+bool detectDeadEdges(const std::string& path, double maxEdgeSec, EdgeTrim& trim) {
+    auto decoder = openVideoDecoder(path, kAnalysisWidth, 0, FF_THREAD_FRAME);
+    if (!decoder) return false;
+    // Trim points need every frame, so keep non-reference frames.
+    configureAnalysisDecoder(decoder->decCtx);
+    decoder->decCtx->skip_frame = AVDISCARD_DEFAULT;
+    trim.durationSec = decoder->durationSec();
+    trim.endSec = trim.durationSec;
+    double edge = std::min(maxEdgeSec, trim.durationSec / 2);
+    if (edge <= 0) return true;
+
+    std::vector<FrameClass> head;
+    if (!classifyFrames(*decoder, edge, head)) return false;
+    std::vector<FrameClass> tail;
+    double tailFrom = trim.durationSec - edge;
+    AVStream* st = decoder->stream();
+    int64_t seekTarget = av_rescale_q(static_cast<int64_t>(tailFrom * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE) seekTarget += st->start_time;
+    av_seek_frame(decoder->fmtCtx, decoder->streamIndex, seekTarget, AVSEEK_FLAG_BACKWARD);
+    avcodec_flush_buffers(decoder->decCtx);
+    if (!classifyFrames(*decoder, trim.durationSec + 1, tail)) return false;
+
+    double videoStart = head.empty() ? 0 : edge;
+    for (const FrameClass& fc : head) {
+        if (!fc.dead) {
+            videoStart = fc.timeSec;
+            break;
+        }
+    }
+    double videoEnd = tail.empty() ? trim.durationSec : tailFrom;
+    for (auto it = tail.rbegin(); it != tail.rend() && it->timeSec >= tailFrom; ++it) {
+        if (!it->dead) {
+            videoEnd = std::min(trim.durationSec, it->endSec);
+            break;
+        }
+    }
+    if (!head.empty() && head.front().timeSec >= videoStart) videoStart = 0;
+    trim.videoHeadSec = videoStart;
+    trim.videoTailSec = trim.durationSec - videoEnd;
+
+    double start = videoStart;
+    double end = videoEnd;
+    auto audio = openAudioDecoder(path, kSilenceSampleRate, 1);
+    if (audio) {
+        trim.hasAudio = true;
+        double firstLoud = -1;
+        double lastLoud = -1;
+        size_t sampleIndex = 0;
+        float lo = 0;
+        float hi = 0;
+        double sumSq = 0;
+        size_t filled = 0;
+        decodeAudio(*audio, [&](const float* samples, size_t count) {
+            size_t offset = 0;
+            while (offset < count) {
+                size_t take = std::min(count - offset, kSilenceWindow - filled);
+                reducePeaks(samples + offset, take, lo, hi, sumSq);
+                filled += take;
+                offset += take;
+                sampleIndex += take;
+                if (filled == kSilenceWindow) {
+                    if (std::sqrt(sumSq / kSilenceWindow) > kSilenceMaxRms) {
+                        double windowStart = static_cast<double>(sampleIndex - kSilenceWindow) / kSilenceSampleRate;
+                        if (firstLoud < 0) firstLoud = windowStart;
+                        lastLoud = static_cast<double>(sampleIndex) / kSilenceSampleRate;
+                    }
+                    sumSq = 0;
+                    filled = 0;
+                }
+            }
+            return true;
+        });
+        double audioStart = firstLoud < 0 ? edge : std::min(firstLoud, edge);
+        double audioEnd = lastLoud < 0 ? tailFrom : std::max(std::min(lastLoud, trim.durationSec), tailFrom);
+        trim.audioHeadSec = audioStart;
+        trim.audioTailSec = trim.durationSec - audioEnd;
+        // Keep anything that is alive on either track.
+        start = std::min(start, audioStart);
+        end = std::max(end, audioEnd);
+    }
+
+    if (end - start < kMinTrimmedSec) {
+        start = 0;
+        end = trim.durationSec;
+    }
+    trim.startSec = start;
+    trim.endSec = end;
+    trim.keyframeStartSec = 0;
+    for (const FrameClass& fc : head) {
+        if (fc.timeSec > start) break;
+        if (fc.keyframe) trim.keyframeStartSec = fc.timeSec;
+    }
+    return true;
+}
+
+bool measureLoudness(const std::string& path, LoudnessStats& stats) {
+    auto decoder = openAudioDecoder(path, kLoudnessSampleRate, 2);
+    if (!decoder) return false;
+    LoudnessMeter meter;
+    bool ok = decodeAudio(*decoder, [&](const float* samples, size_t frames) {
+        meter.addSamples(samples, frames);
+        return true;
+    });
+    if (!ok) return false;
+    stats = meter.result();
+    return true;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+// Decode the audio of `path` once and reduce it into `buckets` evenly sized
+// buckets of [min, max, rms] (mono, -1..1), appended to `peaks`. Completed
+// buckets are handed to onPartial(firstBucket, flatPeaks) in batches while
+// decoding progresses. Returns false if the clip has no decodable audio.
+bool extractWaveformPeaks(const std::string& path, int buckets,
+                          const std::function<void(int, const std::vector<float>&)>& onPartial,
+                          std::vector<float>& peaks);
+
+struct SceneCut {
+  double timeSec = 0;
+  // 0..1, blend of luma histogram distance and mean absolute frame difference.
+  double score = 0;
+};
+
+// Decode the video at reduced resolution (lowres where the codec supports it,
+// otherwise a decimated luma plane) and return up to maxCuts scene changes
+// scoring above `threshold`, strongest first, at least minSpacingSec apart.
+bool detectSceneChanges(const std::string& path, double threshold, int maxCuts, double minSpacingSec,
+                        std::vector<SceneCut>& cuts, double& durationSec);
+
+struct EdgeTrim {
+  double durationSec = 0;
+  // Recommended in/out points: everything outside [startSec, endSec) is
+  // dead picture (black or frozen) with silent or no audio.
+  double startSec = 0;
+  double endSec = 0;
+  // The keyframe at or before startSec, where a stream-copy trim can begin.
+  double keyframeStartSec = 0;
+  // Dead time found at each edge, per track.
+  double videoHeadSec = 0;
+  double videoTailSec = 0;
+  double audioHeadSec = 0;
+  double audioTailSec = 0;
+  bool hasAudio = false;
+};
+
+// Classify the frames in the first and last maxEdgeSec of `path` as black or
+// frozen from decimated luma statistics, and the audio as silent from 20 ms
+// RMS windows, then recommend in/out points that drop only dead edges.
+// Nothing further than maxEdgeSec from either end is ever trimmed.
+bool detectDeadEdges(const std::string& path, double maxEdgeSec, EdgeTrim& trim);
+
+struct LoudnessStats {
+  double durationSec = 0;
+  // EBU R128: gated programme loudness (LUFS; -70 for silence), loudness
+  // range (LU) and 4x oversampled true peak (dBTP, -140 for silence).
+  double integratedLufs = -70;
+  double loudnessRange = 0;
+  double truePeakDbtp = -140;
+};
+
+// Stream the audio of `path` once through K-weighting (at 48 kHz stereo) and
+// a true-peak meter. Returns false if the clip has no decodable audio.
+bool measureLoudness(const std::string& path, LoudnessStats& stats);
+
+} // namespace facebook::react
@@ -0,0 +1,203 @@
+#include "MediaCache.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+constexpr size_t kFingerprintChunk = 64 * 1024;
+constexpr const char* kEntrySuffix = ".bin";
+
+bool endsWith(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+void MediaCache::configure(const std::string& rawDirectory, uint64_t maxBytes) {
+    std::string directory = stripFileScheme(rawDirectory);
+    while (directory.size() > 1 && directory.back() == '/') directory.pop_back();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    maxBytes_ = maxBytes;
+    bytesUsed_ = 0;
+    lru_.clear();
+    index_.clear();
+    if (directory_.empty() || maxBytes_ == 0) return;
+
+    mkdir(directory_.c_str(), 0700);
+    DIR* dir = opendir(directory_.c_str());
+    if (!dir) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Media cache directory unavailable: %s", directory_.c_str());
+        directory_.clear();
+        return;
+    }
+    // Rebuild LRU order from mtimes, which get() bumps on every hit.
+    struct Found {
+        std::string key;
+        uint64_t size;
+        int64_t mtime;
+    };
+    std::vector<Found> found;
+    while (dirent* ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (!endsWith(name, kEntrySuffix)) continue;
+        struct stat st;
+        if (stat((directory_ + "/" + name).c_str(), &st) != 0) continue;
+        found.push_back({name.substr(0, name.size() - 4), static_cast<uint64_t>(st.st_size), static_cast<int64_t>(st.st_mtime)});
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.mtime > b.mtime; });
+    for (const Found& f : found) {
+        lru_.push_back({f.key, f.size});
+        index_[f.key] = std::prev(lru_.end());
+        bytesUsed_ += f.size;
+    }
+    evictLocked();
+}
+
+bool MediaCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !directory_.empty() && maxBytes_ > 0;
+}
+
+std::string MediaCache::directory() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return directory_;
+}
+
+uint64_t MediaCache::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesUsed_;
+}
+
+std::string MediaCache::fingerprint(const std::string& rawPath) {
+    std::string path = stripFileScheme(rawPath);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return "";
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return "";
+    }
+
+    AVMurMur3* hash = av_murmur3_alloc();
+    if (!hash) {
+        close(fd);
+        return "";
+    }
+    av_murmur3_init_seeded(hash, static_cast<uint64_t>(st.st_size) ^ (static_cast<uint64_t>(st.st_mtime) << 32));
+    std::vector<uint8_t> chunk(kFingerprintChunk);
+    ssize_t head = pread(fd, chunk.data(), chunk.size(), 0);
+    if (head > 0) av_murmur3_update(hash, chunk.data(), head);
+    if (st.st_size > static_cast<off_t>(kFingerprintChunk)) {
+        ssize_t tail = pread(fd, chunk.data(), chunk.size(), st.st_size - kFingerprintChunk);
+        if (tail > 0) av_murmur3_update(hash, chunk.data(), tail);
+    }
+    close(fd);
+
+    uint8_t digest[16];
+    av_murmur3_final(hash, digest);
+    av_free(hash);
+
+    char out[64];
+    int n = snprintf(out, sizeof(out), "%llx-", static_cast<unsigned long long>(st.st_size));
+    for (uint8_t b : digest) n += snprintf(out + n, sizeof(out) - n, "%02x", b);
+    return out;
+}
+
+bool MediaCache::get(const std::string& key, std::vector<uint8_t>& out) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) return false;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        path = pathForKeyLocked(key);
+    }
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        // Deleted behind our back (e.g. the OS cleared the cache directory).
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) removeLocked(it->second);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out.resize(size > 0 ? size : 0);
+    size_t read = fread(out.data(), 1, out.size(), f);
+    fclose(f);
+    if (read != out.size()) return false;
+    // Persist recency for the next configure().
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+void MediaCache::put(const std::string& key, const std::vector<uint8_t>& bytes) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (directory_.empty() || maxBytes_ == 0 || bytes.size() > maxBytes_) return;
+        path = pathForKeyLocked(key);
+    }
+
+    // Write to a private temp file and rename, so concurrent readers never
+    // see a partially written entry.
+    std::string tmpPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) return;
+    size_t written = fwrite(bytes.data(), 1, bytes.size(), f);
+    fclose(f);
+    if (written != bytes.size() || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        bytesUsed_ -= it->second->size;
+        lru_.erase(it->second);
+    }
+    lru_.push_front({key, bytes.size()});
+    index_[key] = lru_.begin();
+    bytesUsed_ += bytes.size();
+    evictLocked();
+}
+
+std::string MediaCache::pathForKeyLocked(const std::string& key) const {
+    return directory_ + "/" + key + kEntrySuffix;
+}
+
+void MediaCache::removeLocked(std::list<Entry>::iterator it) {
+    bytesUsed_ -= it->size;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
+
+void MediaCache::evictLocked() {
+    while (bytesUsed_ > maxBytes_ && !lru_.empty()) {
+        auto victim = std::prev(lru_.end());
+        unlink(pathForKeyLocked(victim->key).c_str());
+        removeLocked(victim);
+    }
+}
+
+} // namespace facebook::react
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace facebook::react {
+
+// On-disk, content-addressed blob cache for derived media (thumbnails,
+// filmstrips, ...). Entries live as one file each under the configured
+// directory; total size is kept under a byte budget by evicting the least
+// recently used entries. All methods are safe to call from any thread.
+class MediaCache {
+public:
+  // (Re)point the cache at `directory` and index what is already there,
+  // oldest-used first. A zero budget or empty directory disables the cache.
+  void configure(const std::string& directory, uint64_t maxBytes);
+  bool enabled() const;
+
+  // Cheap content fingerprint: file size, mtime and a hash of the first and
+  // last 64 KB. Empty if the file cannot be read.
+  static std::string fingerprint(const std::string& path);
+
+  bool get(const std::string& key, std::vector<uint8_t>& out);
+  void put(const std::string& key, const std::vector<uint8_t>& bytes);
+
+  // Directory entries are stored in; empty when disabled.
+  std::string directory() const;
+  uint64_t bytesUsed() const;
+
+private:
+  struct Entry {
+    std::string key;
+    uint64_t size = 0;
+  };
+
+  std::string pathForKeyLocked(const std::string& key) const;
+  void removeLocked(std::list<Entry>::iterator it);
+  void evictLocked();
+
+  mutable std::mutex mutex_;
+  std::string directory_;
+  uint64_t maxBytes_ = 0;
+  uint64_t bytesUsed_ = 0;
+  // Front is most recently used.
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace facebook::react {
+
+// Remove file:// prefix if present
+inline std::string stripFileScheme(std::string path) {
+    if (path.rfind("file://", 0) == 0) path = path.substr(7);
+    return path;
+}
+
+// Escape a string for embedding inside a JSON string literal.
+inline std::string jsonEscape(const std::string& value) {
+    std::string out;
+    out.reserve(value.size() + 2);
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+// Split a JSON array of flat objects ("[{...},{...}]") into the individual
+// object texts. Nested objects are not supported; the overlay, range and
+// rendition payloads we receive from JS are all flat.
+inline std::vector<std::string> splitJsonObjects(const std::string& json) {
+    std::vector<std::string> objects;
+    size_t pos = 0;
+    while ((pos = json.find('{', pos)) != std::string::npos) {
+        size_t end = json.find('}', pos);
+        if (end == std::string::npos) break;
+        objects.push_back(json.substr(pos, end - pos + 1));
+        pos = end + 1;
+    }
+    return objects;
+}
+
+// Raw value of `key` in a flat JSON object: the unquoted text of a string,
+// or the literal text of a number/boolean. Empty if the key is missing.
+inline std::string jsonField(const std::string& obj, const std::string& key) {
+    size_t k = obj.find('"' + key + '"');
+    if (k == std::string::npos) return "";
+    size_t c = obj.find(":", k);
+    if (c == std::string::npos) return "";
+    size_t v1 = obj.find_first_not_of(" \t\r\n", c + 1);
+    if (v1 == std::string::npos) return "";
+    if (obj[v1] == '"') {
+        size_t v2 = obj.find('"', v1 + 1);
+        return obj.substr(v1 + 1, v2 - v1 - 1);
+    }
+    size_t v2 = obj.find_first_of(",}", v1);
+    std::string value = obj.substr(v1, v2 - v1);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\n' || value.back() == '\r' || value.back() == '\t')) value.pop_back();
+    return value;
+}
+
+inline double jsonNumber(const std::string& obj, const std::string& key, double fallback) {
+    std::string value = jsonField(obj, key);
+    if (value.empty()) return fallback;
+    try {
+        return std::stod(value);
+    } catch (...) {
+        return fallback;
+    }
+}
+
+inline bool jsonBool(const std::string& obj, const std::string& key, bool fallback) {
+    std::string value = jsonField(obj, key);
+    if (value == "true") return true;
+    if (value == "false") return false;
+    return fallback;
+}
+
+} // namespace facebook::react
@@ -1,6 +1,20 @@
 
 #include "NativeFFmpegModule.h"
+#include "AudioEdit.h"
+#include "ClipJoin.h"
+#include "Filmstrip.h"
+#include "ExportPipeline.h"
+#include "FrameExtractor.h"
+#include "MediaAnalysis.h"
+#include "MediaUtils.h"
+#include "OverlayFilter.h"
+#include "ProxyManager.h"
+#include <algorithm>
 #include <android/log.h>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <optional>
 #include <sstream>
 
 // FFmpeg includes (ensure all needed are present)
@@ -20,8 +34,274 @@ extern "C" {
 
 namespace facebook::react {
 
+namespace {
+
+// Heap-backed storage handed to JS as an ArrayBuffer without a copy.
+class ByteBuffer : public jsi::MutableBuffer {
+public:
+    explicit ByteBuffer(size_t size) : bytes_(size) {}
+    explicit ByteBuffer(std::vector<uint8_t>&& bytes) : bytes_(std::move(bytes)) {}
+    size_t size() const override { return bytes_.size(); }
+    uint8_t* data() override { return bytes_.data(); }
+
+private:
+    std::vector<uint8_t> bytes_;
+};
+
+// Thumbnail / sprite sheet payloads as stored in the media cache: a small
+// fixed header with the metadata the JS result needs, then the image bytes
+// (encoded JPEG/WebP or raw RGBA).
+constexpr uint32_t kStillMagic = 0x31545853;  // "SXT1"
+constexpr uint32_t kSheetMagic = 0x31535853;  // "SXS1"
+constexpr uint32_t kPeaksMagic = 0x31505853;  // "SXP1"
+
+struct StillImage {
+    int32_t width = 0;
+    int32_t height = 0;
+    double timeSec = 0;
+    std::vector<uint8_t> bytes;
+};
+
+struct SpriteSheet {
+    int32_t columns = 0;
+    int32_t rows = 0;
+    int32_t tileWidth = 0;
+    int32_t tileHeight = 0;
+    std::vector<FilmstripTile> tiles;
+    std::vector<uint8_t> bytes;
+};
+
+template <typename T>
+void appendPod(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template <typename T>
+bool readPod(const std::vector<uint8_t>& in, size_t& offset, T& value) {
+    if (offset + sizeof(T) > in.size()) return false;
+    memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+std::vector<uint8_t> packStill(const StillImage& image) {
+    std::vector<uint8_t> out;
+    out.reserve(image.bytes.size() + 32);
+    appendPod(out, kStillMagic);
+    appendPod(out, image.width);
+    appendPod(out, image.height);
+    appendPod(out, image.timeSec);
+    out.insert(out.end(), image.bytes.begin(), image.bytes.end());
+    return out;
+}
+
+bool unpackStill(const std::vector<uint8_t>& blob, StillImage& image) {
+    size_t offset = 0;
+    uint32_t magic = 0;
+    if (!readPod(blob, offset, magic) || magic != kStillMagic) return false;
+    if (!readPod(blob, offset, image.width) || !readPod(blob, offset, image.height) || !readPod(blob, offset, image.timeSec)) return false;
+    image.bytes.assign(blob.begin() + offset, blob.end());
+    return !image.bytes.empty();
+}
+
+std::vector<uint8_t> packSpriteSheet(const SpriteSheet& sheet) {
+    std::vector<uint8_t> out;
+    out.reserve(sheet.bytes.size() + 32 + sheet.tiles.size() * 16);
+    appendPod(out, kSheetMagic);
+    appendPod(out, sheet.columns);
+    appendPod(out, sheet.rows);
+    appendPod(out, sheet.tileWidth);
+    appendPod(out, sheet.tileHeight);
+    appendPod(out, static_cast<int32_t>(sheet.tiles.size()));
+    for (const FilmstripTile& tile : sheet.tiles) {
+        appendPod(out, static_cast<int32_t>(tile.index));
+        appendPod(out, tile.timeSec);
+    }
+    out.insert(out.end(), sheet.bytes.begin(), sheet.bytes.end());
+    return out;
+}
+
+bool unpackSpriteSheet(const std::vector<uint8_t>& blob, SpriteSheet& sheet) {
+    size_t offset = 0;
+    uint32_t magic = 0;
+    int32_t tileCount = 0;
+    if (!readPod(blob, offset, magic) || magic != kSheetMagic) return false;
+    if (!readPod(blob, offset, sheet.columns) || !readPod(blob, offset, sheet.rows) ||
+        !readPod(blob, offset, sheet.tileWidth) || !readPod(blob, offset, sheet.tileHeight) ||
+        !readPod(blob, offset, tileCount) || tileCount < 0) return false;
+    sheet.tiles.resize(tileCount);
+    for (FilmstripTile& tile : sheet.tiles) {
+        int32_t index = 0;
+        if (!readPod(blob, offset, index) || !readPod(blob, offset, tile.timeSec)) return false;
+        tile.index = index;
+    }
+    sheet.bytes.assign(blob.begin() + offset, blob.end());
+    return !sheet.bytes.empty();
+}
+
+std::vector<uint8_t> packPeaks(const std::vector<float>& peaks) {
+    std::vector<uint8_t> out;
+    out.reserve(8 + peaks.size() * sizeof(float));
+    appendPod(out, kPeaksMagic);
+    appendPod(out, static_cast<int32_t>(peaks.size()));
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(peaks.data());
+    out.insert(out.end(), p, p + peaks.size() * sizeof(float));
+    return out;
+}
+
+bool unpackPeaks(const std::vector<uint8_t>& blob, std::vector<float>& peaks) {
+    size_t offset = 0;
+    uint32_t magic = 0;
+    int32_t count = 0;
+    if (!readPod(blob, offset, magic) || magic != kPeaksMagic || !readPod(blob, offset, count) || count < 0) return false;
+    if (blob.size() - offset != static_cast<size_t>(count) * sizeof(float)) return false;
+    peaks.resize(count);
+    memcpy(peaks.data(), blob.data() + offset, blob.size() - offset);
+    return true;
+}
+
+// Probe a single file into a compact JSON record for gallery badges. Never
+// throws; failures come back as {"ok":false,...} so a batch keeps going.
+std::string probeFileJson(const std::string& rawPath) {
+    std::string path = stripFileScheme(rawPath);
+    std::ostringstream out;
+    out << "{\"path\":\"" << jsonEscape(rawPath) << "\"";
+
+    AVFormatContext* fmtCtx = nullptr;
+    int ret = avformat_open_input(&fmtCtx, path.c_str(), nullptr, nullptr);
+    if (ret < 0) {
+        char errbuf[256];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        out << ",\"ok\":false,\"error\":\"Failed to open input file: " << jsonEscape(errbuf) << "\"}";
+        return out.str();
+    }
+    ret = avformat_find_stream_info(fmtCtx, nullptr);
+    if (ret < 0) {
+        avformat_close_input(&fmtCtx);
+        out << ",\"ok\":false,\"error\":\"Failed to find stream info\"}";
+        return out.str();
+    }
+
+    int64_t duration = fmtCtx->duration == AV_NOPTS_VALUE ? 0 : fmtCtx->duration;
+    out << ",\"ok\":true";
+    out << ",\"format\":\"" << jsonEscape(fmtCtx->iformat->name) << "\"";
+    out << ",\"durationSec\":" << std::abs(static_cast<double>(duration) / AV_TIME_BASE);
+    out << ",\"bitRate\":" << fmtCtx->bit_rate;
+    out << ",\"streams\":" << fmtCtx->nb_streams;
+
+    int videoIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (videoIndex >= 0) {
+        AVStream* st = fmtCtx->streams[videoIndex];
+        AVRational fps = av_guess_frame_rate(fmtCtx, st, nullptr);
+        out << ",\"width\":" << st->codecpar->width;
+        out << ",\"height\":" << st->codecpar->height;
+        out << ",\"fps\":" << (fps.den ? av_q2d(fps) : 0.0);
+        out << ",\"videoCodec\":\"" << avcodec_get_name(st->codecpar->codec_id) << "\"";
+    }
+    int audioIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    out << ",\"hasAudio\":" << (audioIndex >= 0 ? "true" : "false");
+    if (audioIndex >= 0) {
+        out << ",\"audioCodec\":\"" << avcodec_get_name(fmtCtx->streams[audioIndex]->codecpar->codec_id) << "\"";
+    }
+    out << "}";
+
+    avformat_close_input(&fmtCtx);
+    return out.str();
+}
+
+// Stream-copy [start, start + duration) of every stream. Shared by trimVideo
+// and the analysis-driven trims, which run on worker threads.
+bool streamCopyTrim(std::string inputPath, std::string outputPath, double start, double duration, KeyframeIndexStore& keyframeIndexes) {
+    inputPath = stripFileScheme(inputPath);
+    outputPath = stripFileScheme(outputPath);
+    AVFormatContext* inFmtCtx = nullptr;
+    AVFormatContext* outFmtCtx = nullptr;
+    bool success = false;
+    int64_t seek_target = 0;
+    double endTime = 0;
+    AVPacket pkt;
+    std::shared_ptr<const KeyframeIndex> keyframes;
+    const KeyframeEntry* keyframe = nullptr;
+
+    if (avformat_open_input(&inFmtCtx, inputPath.c_str(), nullptr, nullptr) < 0) return false;
+    if (avformat_find_stream_info(inFmtCtx, nullptr) < 0) goto end;
+
+    avformat_alloc_output_context2(&outFmtCtx, nullptr, nullptr, outputPath.c_str());
+    if (!outFmtCtx) goto end;
+
+    // Copy all streams
+    for (unsigned int i = 0; i < inFmtCtx->nb_streams; i++) {
+        AVStream* outStream = avformat_new_stream(outFmtCtx, nullptr);
+        if (!outStream) goto end;
+        if (avcodec_parameters_copy(outStream->codecpar, inFmtCtx->streams[i]->codecpar) < 0) goto end;
+        outStream->codecpar->codec_tag = 0;
+    }
+
+    if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&outFmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) goto end;
+    }
+
+    if (avformat_write_header(outFmtCtx, nullptr) < 0) goto end;
+
+    // Seek to start: straight to the keyframe at or before it when the clip
+    // has been indexed, otherwise let the demuxer search.
+    keyframes = keyframeIndexes.find(inputPath);
+    // (An index of some other stream would seek that stream's timeline.)
+    if (keyframes && keyframes->streamIndex != av_find_best_stream(inFmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0)) keyframes.reset();
+    keyframe = keyframes ? keyframes->atOrBefore(keyframes->ptsForTime(start)) : nullptr;
+    if (!keyframe || !seekToKeyframe(inFmtCtx, *keyframes, *keyframe)) {
+        seek_target = start * AV_TIME_BASE;
+        if (av_seek_frame(inFmtCtx, -1, seek_target, AVSEEK_FLAG_BACKWARD) < 0) goto end;
+    }
+
+    endTime = start + duration;
+    while (av_read_frame(inFmtCtx, &pkt) >= 0) {
+        double pkt_time = pkt.pts * av_q2d(inFmtCtx->streams[pkt.stream_index]->time_base);
+        if (pkt_time < start) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        if (pkt_time > endTime) {
+            av_packet_unref(&pkt);
+            break;
+        }
+        av_interleaved_write_frame(outFmtCtx, &pkt);
+        av_packet_unref(&pkt);
+    }
+
+    av_write_trailer(outFmtCtx);
+    success = true;
+
+end:
+    if (inFmtCtx) avformat_close_input(&inFmtCtx);
+    if (outFmtCtx) {
+        if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
+        avformat_free_context(outFmtCtx);
+    }
+    return success;
+}
+
+std::string edgeTrimJson(const EdgeTrim& trim) {
+    std::ostringstream out;
+    out << "{\"durationSec\":" << trim.durationSec << ",\"startSec\":" << trim.startSec << ",\"endSec\":" << trim.endSec
+        << ",\"keyframeStartSec\":" << trim.keyframeStartSec << ",\"videoHeadSec\":" << trim.videoHeadSec
+        << ",\"videoTailSec\":" << trim.videoTailSec << ",\"audioHeadSec\":" << trim.audioHeadSec
+        << ",\"audioTailSec\":" << trim.audioTailSec << ",\"hasAudio\":" << (trim.hasAudio ? "true" : "false") << "}";
+    return out.str();
+}
+
+} // namespace
+
 NativeFFmpegModule::NativeFFmpegModule(std::shared_ptr<CallInvoker> jsInvoker)
-    : NativeFFmpegModuleCxxSpec(std::move(jsInvoker)) {}
+    : NativeFFmpegModuleCxxSpec(std::move(jsInvoker)),
+      workerPool_(std::make_shared<ThreadPool>(ThreadPool::defaultThreadCount())),
+      decodePool_(std::make_shared<ThreadPool>(ThreadPool::defaultThreadCount())),
+      filmstripPool_(std::make_shared<ThreadPool>(1)),
+      mediaCache_(std::make_shared<MediaCache>()),
+      proxies_(std::make_shared<ProxyManager>()),
+      keyframeIndexes_(std::make_shared<KeyframeIndexStore>()),
+      palettes_(std::make_shared<PaletteCache>()) {}
 
 std::string NativeFFmpegModule::getFFmpegVersion(jsi::Runtime& rt) {
     return av_version_info();   
@@ -56,6 +336,50 @@ std::string NativeFFmpegModule::getVideoMetaData(jsi::Runtime& rt, std::string f
     return out.str();
 }
 
+AsyncPromise<double> NativeFFmpegModule::probeMany(jsi::Runtime& rt, std::vector<std::string> paths, bool ordered, AsyncCallback<double, std::string> onResult) {
+    AsyncPromise<double> promise(rt, jsInvoker_);
+    if (paths.empty()) {
+        promise.resolve(0);
+        return promise;
+    }
+
+    // Shared by every probe task. Results are emitted under the lock, so the
+    // callbacks reach the JS queue in emission order and the promise always
+    // resolves after the last result.
+    struct Batch {
+        std::vector<std::string> paths;
+        std::vector<std::optional<std::string>> pending;
+        std::mutex mutex;
+        size_t nextToEmit = 0;
+        size_t completed = 0;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->paths = std::move(paths);
+    batch->pending.resize(batch->paths.size());
+
+    for (size_t i = 0; i < batch->paths.size(); ++i) {
+        workerPool_->enqueue([batch, i, ordered, onResult, promise]() mutable {
+            std::string result = probeFileJson(batch->paths[i]);
+
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (!ordered) {
+                onResult.call(static_cast<double>(i), std::move(result));
+            } else {
+                batch->pending[i] = std::move(result);
+                while (batch->nextToEmit < batch->pending.size() && batch->pending[batch->nextToEmit]) {
+                    onResult.call(static_cast<double>(batch->nextToEmit), std::move(*batch->pending[batch->nextToEmit]));
+                    batch->pending[batch->nextToEmit].reset();
+                    batch->nextToEmit++;
+                }
+            }
+            if (++batch->completed == batch->paths.size()) {
+                promise.resolve(static_cast<double>(batch->completed));
+            }
+        });
+    }
+    return promise;
+}
+
 bool NativeFFmpegModule::muteVideo(jsi::Runtime& rt, std::string inputPath, std::string outputPath) {
     // Remove file:// prefix if present
     if (inputPath.rfind("file://", 0) == 0) inputPath = inputPath.substr(7);
@@ -108,430 +432,619 @@ end:
 }
 
 bool NativeFFmpegModule::trimLast2Seconds(jsi::Runtime& rt, std::string inputPath, std::string outputPath) {
-    // Remove file:// prefix if present
-    if (inputPath.rfind("file://", 0) == 0) inputPath = inputPath.substr(7);
-    if (outputPath.rfind("file://", 0) == 0) outputPath = outputPath.substr(7);
-    // Get duration using FFmpeg/libav
-    AVFormatContext *formatContext = nullptr;
-    int ret = avformat_open_input(&formatContext, inputPath.c_str(), nullptr, nullptr);
-    if (ret < 0) return false;
-    ret = avformat_find_stream_info(formatContext, nullptr);
-    if (ret < 0) {
+    // Always cuts the last 2 s, dead or not; autoTrim drops only what is dead.
+    AVFormatContext* formatContext = nullptr;
+    if (avformat_open_input(&formatContext, stripFileScheme(inputPath).c_str(), nullptr, nullptr) < 0) return false;
+    if (avformat_find_stream_info(formatContext, nullptr) < 0) {
         avformat_close_input(&formatContext);
         return false;
     }
     int64_t duration = formatContext->duration;
     avformat_close_input(&formatContext);
     if (duration == AV_NOPTS_VALUE) return false;
-    double durationInSeconds = std::abs(static_cast<double>(duration) / AV_TIME_BASE);
-    double trimDuration = durationInSeconds - 2.0;
+    double trimDuration = std::abs(static_cast<double>(duration) / AV_TIME_BASE) - 2.0;
     if (trimDuration <= 0) return false;
-    // Use FFmpeg CLI to trim last 2 seconds
-    std::string ffmpegPath = "/data/data/com.anonymous.StoryXLive/files/ffmpeg";
-    if (access(ffmpegPath.c_str(), X_OK) != 0) {
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "ffmpeg binary not executable or not found at: %s", ffmpegPath.c_str());
-    }
-    std::ostringstream cmd;
-    cmd << ffmpegPath << " -y -i '" << inputPath << "' -ss 0 -t " << trimDuration << " -c copy '" << outputPath << "'";
-    int sysret = system(cmd.str().c_str());
-    return sysret == 0;
+    return streamCopyTrim(inputPath, outputPath, 0, trimDuration, *keyframeIndexes_);
 }
 
 bool NativeFFmpegModule::trimVideo(jsi::Runtime& rt, std::string inputPath, std::string outputPath, double start, double duration) {
-    // Remove file:// prefix if present
-    if (inputPath.rfind("file://", 0) == 0) inputPath = inputPath.substr(7);
-    if (outputPath.rfind("file://", 0) == 0) outputPath = outputPath.substr(7);
-    AVFormatContext* inFmtCtx = nullptr;
-    AVFormatContext* outFmtCtx = nullptr;
-    bool success = false;
-    int64_t seek_target = 0;
-    double endTime = 0;
-    AVPacket pkt;
+    return streamCopyTrim(inputPath, outputPath, start, duration, *keyframeIndexes_);
+}
 
-    if (avformat_open_input(&inFmtCtx, inputPath.c_str(), nullptr, nullptr) < 0) return false;
-    if (avformat_find_stream_info(inFmtCtx, nullptr) < 0) goto end;
+bool NativeFFmpegModule::burnOverlays(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string overlaysJson, std::string workDir, std::string exportOptionsJson) {
+    std::string filter;
+    if (!buildOverlayFilter(overlaysJson, workDir, 1.0, filter)) return false;
+    if (filter.empty()) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No overlays or font not found");
+        return false;
+    }
+    ExportStats stats;
+    if (!exportVideo(inputPath, outputPath, overlaysJson, workDir, parseExportOptions(exportOptionsJson), stats)) return false;
+    __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Exported %lld frames at %dx%d with %s (%s) in %.2fs, %lld bytes",
+                        static_cast<long long>(stats.frames), stats.width, stats.height, stats.profile.c_str(), stats.encoder.c_str(),
+                        stats.elapsedSec, static_cast<long long>(stats.outputBytes));
+    __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Frame pool: %llu/%llu hits, peak %llu resident frames; %lld frames bypassed the filter graph",
+                        static_cast<unsigned long long>(stats.poolHits), static_cast<unsigned long long>(stats.poolRequests),
+                        static_cast<unsigned long long>(stats.peakResidentFrames), static_cast<long long>(stats.bypassedFrames));
+    return true;
+}
 
-    avformat_alloc_output_context2(&outFmtCtx, nullptr, nullptr, outputPath.c_str());
-    if (!outFmtCtx) goto end;
+AsyncPromise<std::string> NativeFFmpegModule::generateProxy(jsi::Runtime& rt, std::string inputPath, double maxHeight) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    auto proxies = proxies_;
+    workerPool_->enqueue([proxies, inputPath, maxHeight, promise]() mutable {
+        std::string proxyPath = proxies->generate(inputPath, static_cast<int>(maxHeight));
+        if (proxyPath.empty()) {
+            promise.reject(Error("Proxy generation failed for " + inputPath));
+        } else {
+            promise.resolve(proxyPath);
+        }
+    });
+    return promise;
+}
 
-    // Copy all streams
-    for (unsigned int i = 0; i < inFmtCtx->nb_streams; i++) {
-        AVStream* outStream = avformat_new_stream(outFmtCtx, nullptr);
-        if (!outStream) goto end;
-        if (avcodec_parameters_copy(outStream->codecpar, inFmtCtx->streams[i]->codecpar) < 0) goto end;
-        outStream->codecpar->codec_tag = 0;
-    }
+bool NativeFFmpegModule::configureMediaCache(jsi::Runtime& rt, std::string directory, double maxBytes) {
+    mediaCache_->configure(directory, maxBytes > 0 ? static_cast<uint64_t>(maxBytes) : 0);
+    return mediaCache_->enabled();
+}
 
-    if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
-        if (avio_open(&outFmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) goto end;
+AsyncPromise<std::string> NativeFFmpegModule::generateThumbnail(jsi::Runtime& rt, std::string filePath, double timeSec, double width, double height, std::string format, std::string outputPath) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    if (format != "rgba" && !stillFormatAvailable(format)) {
+        promise.reject(Error("Unsupported format: " + format + " is not in this build"));
+        return promise;
     }
+    auto mediaCache = mediaCache_;
+    auto proxies = proxies_;
+    auto keyframeIndexes = keyframeIndexes_;
+    decodePool_->enqueue([mediaCache, proxies, keyframeIndexes, filePath, timeSec, width, height, format, outputPath, promise]() mutable {
+        int targetWidth = static_cast<int>(width);
+        int targetHeight = static_cast<int>(height);
+        std::string cacheKey;
+        if (mediaCache->enabled()) {
+            std::string fingerprint = MediaCache::fingerprint(filePath);
+            if (!fingerprint.empty()) {
+                std::ostringstream key;
+                key << fingerprint << "-thumb-" << format << "-" << targetWidth << "x" << targetHeight << "-" << std::llround(timeSec * 1000);
+                cacheKey = key.str();
+            }
+        }
 
-    if (avformat_write_header(outFmtCtx, nullptr) < 0) goto end;
+        StillImage image;
+        std::vector<uint8_t> blob;
+        bool cached = !cacheKey.empty() && mediaCache->get(cacheKey, blob) && unpackStill(blob, image);
+        if (!cached) {
+            std::string source = proxies->resolve(filePath, targetWidth, targetHeight);
+            auto decoder = openVideoDecoder(source, targetWidth, targetHeight);
+            if (!decoder) {
+                promise.reject(Error("Failed to open video " + filePath));
+                return;
+            }
+            auto keyframes = keyframeIndexes->find(source);
+            AVFrame* frame = decodeKeyframeAt(*decoder, timeSec, keyframes.get());
+            if (!frame) {
+                promise.reject(Error("Failed to decode keyframe of " + filePath));
+                return;
+            }
+            // Sized and turned as the clip is shown.
+            int turns = displayQuarterTurns(decoder->stream());
+            int shownWidth = frame->width << decoder->decCtx->lowres;
+            int shownHeight = frame->height << decoder->decCtx->lowres;
+            if (turns & 1) std::swap(shownWidth, shownHeight);
+            fitTargetSize(shownWidth, shownHeight, targetWidth, targetHeight);
+            image.width = targetWidth;
+            image.height = targetHeight;
+            image.timeSec = frameTimeSec(*decoder, frame);
+            if (format == "rgba") {
+                image.bytes.resize(static_cast<size_t>(targetWidth) * targetHeight * 4);
+                if (!scaleFrameInto(frame, targetWidth, targetHeight, AV_PIX_FMT_RGBA, image.bytes.data(), image.bytes.size(), turns)) {
+                    image.bytes.clear();
+                }
+            } else {
+                image.bytes = encodeStill(frame, targetWidth, targetHeight, format, turns);
+            }
+            av_frame_free(&frame);
+            if (image.bytes.empty()) {
+                promise.reject(Error("Failed to encode " + format));
+                return;
+            }
+            if (!cacheKey.empty()) mediaCache->put(cacheKey, packStill(image));
+        }
 
-    // Seek to start
-    seek_target = start * AV_TIME_BASE;
-    if (av_seek_frame(inFmtCtx, -1, seek_target, AVSEEK_FLAG_BACKWARD) < 0) goto end;
+        if (!writeFile(outputPath, image.bytes)) {
+            promise.reject(Error("Failed to write " + outputPath));
+            return;
+        }
+        std::ostringstream out;
+        out << "{\"uri\":\"" << jsonEscape(outputPath) << "\",\"width\":" << image.width << ",\"height\":" << image.height
+            << ",\"timeSec\":" << image.timeSec << ",\"cached\":" << (cached ? "true" : "false") << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
 
-    endTime = start + duration;
-    while (av_read_frame(inFmtCtx, &pkt) >= 0) {
-        double pkt_time = pkt.pts * av_q2d(inFmtCtx->streams[pkt.stream_index]->time_base);
-        if (pkt_time < start) {
-            av_packet_unref(&pkt);
-            continue;
+AsyncPromise<std::string> NativeFFmpegModule::generateFilmstrip(jsi::Runtime& rt, std::string filePath, double count, double tileWidth, std::string format, std::string outputPath) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    if (format != "rgba" && !stillFormatAvailable(format)) {
+        promise.reject(Error("Unsupported format: " + format + " is not in this build"));
+        return promise;
+    }
+    auto decodePool = decodePool_;
+    auto mediaCache = mediaCache_;
+    auto proxies = proxies_;
+    auto keyframeIndexes = keyframeIndexes_;
+    filmstripPool_->enqueue([decodePool, mediaCache, proxies, keyframeIndexes, filePath, count, tileWidth, format, outputPath,
+                             promise]() mutable {
+        std::string cacheKey;
+        if (mediaCache->enabled()) {
+            std::string fingerprint = MediaCache::fingerprint(filePath);
+            if (!fingerprint.empty()) {
+                std::ostringstream key;
+                key << fingerprint << "-strip-" << format << "-" << static_cast<int>(count) << "-" << static_cast<int>(tileWidth);
+                cacheKey = key.str();
+            }
         }
-        if (pkt_time > endTime) {
-            av_packet_unref(&pkt);
-            break;
+
+        SpriteSheet sheet;
+        std::vector<uint8_t> blob;
+        bool cached = !cacheKey.empty() && mediaCache->get(cacheKey, blob) && unpackSpriteSheet(blob, sheet);
+        if (!cached) {
+            std::string source = proxies->resolve(filePath, static_cast<int>(tileWidth));
+            auto keyframes = keyframeIndexes->find(source);
+            auto strip = buildFilmstrip(source, static_cast<int>(count), static_cast<int>(tileWidth), *decodePool, keyframes.get());
+            if (!strip) {
+                promise.reject(Error("Failed to build filmstrip for " + filePath));
+                return;
+            }
+            AVFrame* frame = strip->sheet;
+            if (format == "rgba") {
+                sheet.bytes.resize(static_cast<size_t>(frame->width) * frame->height * 4);
+                av_image_copy_to_buffer(sheet.bytes.data(), static_cast<int>(sheet.bytes.size()), frame->data, frame->linesize,
+                                        AV_PIX_FMT_RGBA, frame->width, frame->height, 1);
+            } else {
+                sheet.bytes = encodeStill(frame, frame->width, frame->height, format);
+            }
+            if (sheet.bytes.empty()) {
+                promise.reject(Error("Failed to encode " + format));
+                return;
+            }
+            sheet.columns = strip->columns;
+            sheet.rows = strip->rows;
+            sheet.tileWidth = strip->tileWidth;
+            sheet.tileHeight = strip->tileHeight;
+            sheet.tiles = std::move(strip->tiles);
+            if (!cacheKey.empty()) mediaCache->put(cacheKey, packSpriteSheet(sheet));
         }
-        av_interleaved_write_frame(outFmtCtx, &pkt);
-        av_packet_unref(&pkt);
-    }
 
-    av_write_trailer(outFmtCtx);
-    success = true;
+        if (!writeFile(outputPath, sheet.bytes)) {
+            promise.reject(Error("Failed to write " + outputPath));
+            return;
+        }
+        std::ostringstream out;
+        out << "{\"uri\":\"" << jsonEscape(outputPath) << "\",\"tiles\":[";
+        for (size_t i = 0; i < sheet.tiles.size(); ++i) {
+            if (i > 0) out << ",";
+            out << "{\"index\":" << sheet.tiles[i].index << ",\"timeSec\":" << sheet.tiles[i].timeSec << "}";
+        }
+        out << "],\"columns\":" << sheet.columns << ",\"rows\":" << sheet.rows << ",\"tileWidth\":" << sheet.tileWidth
+            << ",\"tileHeight\":" << sheet.tileHeight << ",\"cached\":" << (cached ? "true" : "false") << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
 
-end:
-    if (inFmtCtx) avformat_close_input(&inFmtCtx);
-    if (outFmtCtx) {
-        if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
-        avformat_free_context(outFmtCtx);
+double NativeFFmpegModule::openPreviewSession(jsi::Runtime& rt, std::string inputPath, double displayWidth, double displayHeight, std::string workDir) {
+    int referenceWidth = 0;
+    int referenceHeight = 0;
+    if (!probeVideoSize(inputPath, referenceWidth, referenceHeight, true)) return -1;
+    int width = static_cast<int>(displayWidth);
+    int height = static_cast<int>(displayHeight);
+    fitTargetSize(referenceWidth, referenceHeight, width, height);
+
+    std::string source = proxies_->resolve(inputPath, width, height);
+    auto session = PreviewSession::open(source, referenceWidth, referenceHeight, width, height, workDir, keyframeIndexes_->find(source));
+    if (!session) return -1;
+    int sessionId = nextSessionId_++;
+    previewSessions_[sessionId] = std::move(session);
+    return sessionId;
+}
+
+jsi::Object NativeFFmpegModule::renderPreviewFrame(jsi::Runtime& rt, double sessionId, double timeSec, std::string overlaysJson) {
+    jsi::Object result(rt);
+    result.setProperty(rt, "ok", false);
+    auto it = previewSessions_.find(static_cast<int>(sessionId));
+    if (it == previewSessions_.end()) {
+        result.setProperty(rt, "error", jsi::String::createFromUtf8(rt, "Unknown preview session"));
+        return result;
     }
-    return success;
+    std::vector<uint8_t> rgba;
+    double shownAtSec = 0;
+    if (!it->second->render(timeSec, overlaysJson, rgba, shownAtSec)) {
+        result.setProperty(rt, "error", jsi::String::createFromUtf8(rt, "Failed to render preview frame"));
+        return result;
+    }
+    result.setProperty(rt, "data", jsi::ArrayBuffer(rt, std::make_shared<ByteBuffer>(std::move(rgba))));
+    result.setProperty(rt, "width", it->second->width());
+    result.setProperty(rt, "height", it->second->height());
+    result.setProperty(rt, "timeSec", shownAtSec);
+    result.setProperty(rt, "ok", true);
+    return result;
 }
 
-bool NativeFFmpegModule::burnOverlays(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string overlaysJson, std::string workDir) {
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "burnOverlays: entered");
+void NativeFFmpegModule::closePreviewSession(jsi::Runtime& rt, double sessionId) {
+    previewSessions_.erase(static_cast<int>(sessionId));
+}
 
-    // --- FFmpeg C API overlay scaffold ---
-    // 1. Open input file
-    AVFormatContext* fmt_ctx = nullptr;
-    if (avformat_open_input(&fmt_ctx, inputPath.c_str(), nullptr, nullptr) < 0) {
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open input: %s", inputPath.c_str());
-        return false;
+double NativeFFmpegModule::openScrubSession(jsi::Runtime& rt, std::string inputPath, double displayWidth, double displayHeight, double maxBytes) {
+    int width = static_cast<int>(displayWidth);
+    int height = static_cast<int>(displayHeight);
+    std::string source = proxies_->resolve(inputPath, width, height);
+    auto session = ScrubSession::open(source, width, height, maxBytes > 0 ? static_cast<size_t>(maxBytes) : 0,
+                                      keyframeIndexes_->find(source));
+    if (!session) return -1;
+    int sessionId = nextSessionId_++;
+    scrubSessions_[sessionId] = std::move(session);
+    return sessionId;
+}
+
+jsi::Object NativeFFmpegModule::scrubFrame(jsi::Runtime& rt, double sessionId, double timeSec) {
+    jsi::Object result(rt);
+    result.setProperty(rt, "ok", false);
+    auto it = scrubSessions_.find(static_cast<int>(sessionId));
+    if (it == scrubSessions_.end()) {
+        result.setProperty(rt, "error", jsi::String::createFromUtf8(rt, "Unknown scrub session"));
+        return result;
     }
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Input opened: %s", inputPath.c_str());
-    if (avformat_find_stream_info(fmt_ctx, nullptr) < 0) {
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to find stream info");
-        return false;
+    std::vector<uint8_t> rgba;
+    double shownAtSec = 0;
+    bool hit = false;
+    if (!it->second->frameAt(timeSec, rgba, shownAtSec, hit)) {
+        // Nothing decoded yet; the session keeps decoding, so ask again.
+        result.setProperty(rt, "error", jsi::String::createFromUtf8(rt, "Frame not ready"));
+        result.setProperty(rt, "pending", true);
+        return result;
     }
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Stream info found");
-    int video_stream_index = -1;
-    for (unsigned int i = 0; i < fmt_ctx->nb_streams; i++) {
-        if (fmt_ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_stream_index = i;
-            break;
+    result.setProperty(rt, "data", jsi::ArrayBuffer(rt, std::make_shared<ByteBuffer>(std::move(rgba))));
+    result.setProperty(rt, "width", it->second->width());
+    result.setProperty(rt, "height", it->second->height());
+    result.setProperty(rt, "timeSec", shownAtSec);
+    result.setProperty(rt, "hit", hit);
+    result.setProperty(rt, "ok", true);
+    return result;
+}
+
+jsi::Object NativeFFmpegModule::getScrubStats(jsi::Runtime& rt, double sessionId) {
+    jsi::Object result(rt);
+    auto it = scrubSessions_.find(static_cast<int>(sessionId));
+    if (it == scrubSessions_.end()) return result;
+    ScrubStats stats = it->second->stats();
+    result.setProperty(rt, "requests", static_cast<double>(stats.requests));
+    result.setProperty(rt, "hits", static_cast<double>(stats.hits));
+    result.setProperty(rt, "hitRate", stats.requests > 0 ? static_cast<double>(stats.hits) / stats.requests : 0.0);
+    result.setProperty(rt, "decodedFrames", static_cast<double>(stats.decodedFrames));
+    result.setProperty(rt, "seeks", static_cast<double>(stats.seeks));
+    result.setProperty(rt, "cachedFrames", static_cast<double>(stats.cachedFrames));
+    result.setProperty(rt, "cachedBytes", static_cast<double>(stats.cachedBytes));
+    return result;
+}
+
+void NativeFFmpegModule::closeScrubSession(jsi::Runtime& rt, double sessionId) {
+    scrubSessions_.erase(static_cast<int>(sessionId));
+}
+
+AsyncPromise<double> NativeFFmpegModule::extractWaveform(jsi::Runtime& rt, std::string inputPath, double buckets, AsyncCallback<double, std::vector<double>> onPeaks) {
+    AsyncPromise<double> promise(rt, jsInvoker_);
+    auto cache = mediaCache_;
+    int bucketCount = static_cast<int>(buckets);
+    workerPool_->enqueue([cache, inputPath, bucketCount, onPeaks, promise]() mutable {
+        std::string cacheKey;
+        if (cache->enabled()) {
+            std::string fingerprint = MediaCache::fingerprint(inputPath);
+            if (!fingerprint.empty()) cacheKey = fingerprint + "-peaks-" + std::to_string(bucketCount);
         }
-    }
-    if (video_stream_index == -1) {
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No video stream found");
-        return false;
-    }
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Video stream index: %d", video_stream_index);
 
-    // 2. Set up decoder
-    const AVCodec* dec = avcodec_find_decoder(fmt_ctx->streams[video_stream_index]->codecpar->codec_id);
-    if (!dec) {
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Decoder not found");
-        avformat_close_input(&fmt_ctx);
-        return false;
-    }
-    AVCodecContext* dec_ctx = avcodec_alloc_context3(dec);
-    if (!dec_ctx) {
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to alloc decoder context");
-        avformat_close_input(&fmt_ctx);
-        return false;
-    }
-    if (avcodec_parameters_to_context(dec_ctx, fmt_ctx->streams[video_stream_index]->codecpar) < 0) {
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to copy codec params to context");
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        return false;
-    }
-    if (avcodec_open2(dec_ctx, dec, nullptr) < 0) {
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open decoder");
-        return false;
-    }
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Decoder opened");
-
-    // 3. Build filter string from overlaysJson (reuse your logic)
-    std::string fontPath = workDir + "/SpaceMono-Regular.ttf";
-    std::vector<std::string> filterParts;
-    try {
-        size_t pos = 0;
-        while ((pos = overlaysJson.find("{", pos)) != std::string::npos) {
-            size_t end = overlaysJson.find("}", pos);
-            if (end == std::string::npos) break;
-            std::string obj = overlaysJson.substr(pos, end - pos + 1);
-            auto getVal = [&](const std::string& key) -> std::string {
-                size_t k = obj.find('"' + key + '"');
-                if (k == std::string::npos) return "";
-                size_t c = obj.find(":", k);
-                if (c == std::string::npos) return "";
-                size_t v1 = obj.find_first_of("\"0123456789-", c+1);
-                if (v1 == std::string::npos) return "";
-                if (obj[v1] == '"') {
-                    size_t v2 = obj.find('"', v1+1);
-                    return obj.substr(v1+1, v2-v1-1);
-                } else {
-                    size_t v2 = obj.find_first_of(",}", v1);
-                    return obj.substr(v1, v2-v1);
-                }
-            };
-            std::string type = getVal("type");
-            std::string content = getVal("content");
-            std::string x = getVal("x");
-            std::string y = getVal("y");
-            std::string scale = getVal("scale");
-            if ((type == "emoji" || type == "text") && !fontPath.empty()) {
-                // Clean up font path (remove double slashes)
-                std::string cleanFontPath = fontPath;
-                while (cleanFontPath.find("//") != std::string::npos) {
-                    cleanFontPath.replace(cleanFontPath.find("//"), 2, "/");
-                }
-                std::ostringstream f;
-                f << "drawtext=text='" << content << "'";
-                // Cast x/y to int for FFmpeg drawtext
-                if (x.empty()) {
-                    f << ":x=0";
-                } else {
-                    try {
-                        f << ":x=" << std::to_string(static_cast<int>(std::stof(x)));
-                    } catch (...) {
-                        f << ":x=0";
-                    }
-                }
-                if (y.empty()) {
-                    f << ":y=0";
-                } else {
-                    try {
-                        f << ":y=" << std::to_string(static_cast<int>(std::stof(y)));
-                    } catch (...) {
-                        f << ":y=0";
-                    }
-                }
-                f << ":fontsize=" << (scale.empty() ? "40" : std::to_string((int)(std::stof(scale)*40)));
-                f << ":fontcolor=white";
-                f << ":fontfile='" << cleanFontPath << "'";
-                filterParts.push_back(f.str());
-            }
-            pos = end+1;
+        std::vector<float> peaks;
+        std::vector<uint8_t> blob;
+        if (!cacheKey.empty() && cache->get(cacheKey, blob) && unpackPeaks(blob, peaks)) {
+            onPeaks.call(0.0, std::vector<double>(peaks.begin(), peaks.end()));
+            promise.resolve(static_cast<double>(peaks.size() / 3));
+            return;
         }
-    } catch (...) {
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Overlay JSON parse error");
-        return false;
-    }
-    if (filterParts.empty()) {
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "No overlays or font not found");
-        return false;
-    }
-    std::ostringstream filter;
-    for (size_t i = 0; i < filterParts.size(); ++i) {
-        if (i > 0) filter << ",";
-        filter << filterParts[i];
-    }
 
-    // 4. Set up filter graph
-    AVFilterGraph* filter_graph = avfilter_graph_alloc();
-    AVFilterContext* buffersrc_ctx = nullptr;
-    AVFilterContext* buffersink_ctx = nullptr;
-    char args[512];
-    snprintf(args, sizeof(args),
-        "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-        dec_ctx->width, dec_ctx->height, dec_ctx->pix_fmt,
-        fmt_ctx->streams[video_stream_index]->time_base.num,
-        fmt_ctx->streams[video_stream_index]->time_base.den,
-        dec_ctx->sample_aspect_ratio.num, dec_ctx->sample_aspect_ratio.den);
-    avfilter_graph_create_filter(&buffersrc_ctx, avfilter_get_by_name("buffer"), "in", args, nullptr, filter_graph);
-    avfilter_graph_create_filter(&buffersink_ctx, avfilter_get_by_name("buffersink"), "out", nullptr, nullptr, filter_graph);
-    AVFilterInOut* outputs = avfilter_inout_alloc();
-    AVFilterInOut* inputs  = avfilter_inout_alloc();
-    outputs->name       = av_strdup("in");
-    outputs->filter_ctx = buffersrc_ctx;
-    outputs->pad_idx    = 0;
-
-    // Log the filter string before parsing
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Filter string: %s", filter.str().c_str());
-    outputs->next       = nullptr;
-    inputs->name        = av_strdup("out");
-    inputs->filter_ctx  = buffersink_ctx;
-    inputs->pad_idx     = 0;
-    inputs->next        = nullptr;
-    int parse_ret = avfilter_graph_parse_ptr(filter_graph, filter.str().c_str(), &inputs, &outputs, nullptr);
-    if (parse_ret < 0) {
-        char errbuf[256];
-        av_strerror(parse_ret, errbuf, sizeof(errbuf));
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to parse filter graph: %s", errbuf);
-        avfilter_inout_free(&inputs);
-        avfilter_inout_free(&outputs);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        return false;
-    }
-    if (avfilter_graph_config(filter_graph, nullptr) < 0) {
-        avfilter_inout_free(&inputs);
-        avfilter_inout_free(&outputs);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to config filter graph");
-        return false;
-    }
-    avfilter_inout_free(&inputs);
-    avfilter_inout_free(&outputs);
-
-    // 5. Read, filter, encode, and mux frames (video only)
-    AVFormatContext* out_fmt_ctx = nullptr;
-    AVStream* out_stream = nullptr;
-    const AVCodec* enc = nullptr;
-    AVCodecContext* enc_ctx = nullptr;
-    int ret = 0;
-
-    // Create output context
-    avformat_alloc_output_context2(&out_fmt_ctx, nullptr, nullptr, outputPath.c_str());
-    if (!out_fmt_ctx) {
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to alloc output context");
-        return false;
-    }
-    // Add video stream to output
-    enc = avcodec_find_encoder(dec_ctx->codec_id);
-    if (!enc) {
-        avformat_free_context(out_fmt_ctx);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Encoder not found");
-        return false;
-    }
-    out_stream = avformat_new_stream(out_fmt_ctx, enc);
-    if (!out_stream) {
-        avformat_free_context(out_fmt_ctx);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to create output stream");
-        return false;
-    }
-    enc_ctx = avcodec_alloc_context3(enc);
-    enc_ctx->height = dec_ctx->height;
-    enc_ctx->width = dec_ctx->width;
-    enc_ctx->sample_aspect_ratio = dec_ctx->sample_aspect_ratio;
-    // Use decoder's pixel format to avoid deprecated pix_fmts
-    enc_ctx->pix_fmt = dec_ctx->pix_fmt;
-    enc_ctx->time_base = dec_ctx->time_base;
-    if (out_fmt_ctx->oformat->flags & AVFMT_GLOBALHEADER)
-        enc_ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-    if (avcodec_open2(enc_ctx, enc, nullptr) < 0) {
-        avcodec_free_context(&enc_ctx);
-        avformat_free_context(out_fmt_ctx);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open encoder");
-        return false;
-    }
-    ret = avcodec_parameters_from_context(out_stream->codecpar, enc_ctx);
-    if (ret < 0) {
-        avcodec_free_context(&enc_ctx);
-        avformat_free_context(out_fmt_ctx);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to copy encoder params");
-        return false;
-    }
-    // Open output file
-    if (!(out_fmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-        if (avio_open(&out_fmt_ctx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) {
-            avcodec_free_context(&enc_ctx);
-            avformat_free_context(out_fmt_ctx);
-            avfilter_graph_free(&filter_graph);
-            avcodec_free_context(&dec_ctx);
-            avformat_close_input(&fmt_ctx);
-            __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to open output file");
-            return false;
+        bool ok = extractWaveformPeaks(inputPath, bucketCount, [&](int firstBucket, const std::vector<float>& partial) {
+            onPeaks.call(static_cast<double>(firstBucket), std::vector<double>(partial.begin(), partial.end()));
+        }, peaks);
+        if (!ok) {
+            promise.reject(Error("No decodable audio in " + inputPath));
+            return;
         }
-    }
-    // Write header
-    if (avformat_write_header(out_fmt_ctx, nullptr) < 0) {
-        avio_closep(&out_fmt_ctx->pb);
-        avcodec_free_context(&enc_ctx);
-        avformat_free_context(out_fmt_ctx);
-        avfilter_graph_free(&filter_graph);
-        avcodec_free_context(&dec_ctx);
-        avformat_close_input(&fmt_ctx);
-        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to write header");
-        return false;
-    }
+        if (!cacheKey.empty()) cache->put(cacheKey, packPeaks(peaks));
+        promise.resolve(static_cast<double>(peaks.size() / 3));
+    });
+    return promise;
+}
 
-    // Frame processing loop
-    AVPacket* pkt = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
-    AVFrame* filt_frame = av_frame_alloc();
-    while (av_read_frame(fmt_ctx, pkt) >= 0) {
-        if (pkt->stream_index == video_stream_index) {
-            ret = avcodec_send_packet(dec_ctx, pkt);
-            if (ret < 0) continue;
-            while (ret >= 0) {
-                ret = avcodec_receive_frame(dec_ctx, frame);
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                if (ret < 0) break;
-                // Push frame to filter
-                if (av_buffersrc_add_frame(buffersrc_ctx, frame) < 0) break;
-                // Pull filtered frames
-                while (av_buffersink_get_frame(buffersink_ctx, filt_frame) >= 0) {
-                    // Encode filtered frame
-                    ret = avcodec_send_frame(enc_ctx, filt_frame);
-                    if (ret < 0) break;
-                    AVPacket out_pkt = {0};
-                    while (avcodec_receive_packet(enc_ctx, &out_pkt) == 0) {
-                        out_pkt.stream_index = out_stream->index;
-                        av_packet_rescale_ts(&out_pkt, enc_ctx->time_base, out_stream->time_base);
-                        av_interleaved_write_frame(out_fmt_ctx, &out_pkt);
-                        av_packet_unref(&out_pkt);
-                    }
-                    av_frame_unref(filt_frame);
-                }
-                av_frame_unref(frame);
+AsyncPromise<std::string> NativeFFmpegModule::detectScenes(jsi::Runtime& rt, std::string inputPath, double threshold, double maxCuts) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    // Analysis only needs low-res frames, so a proxy is always good enough.
+    std::string source = proxies_->resolve(inputPath);
+    workerPool_->enqueue([source, inputPath, threshold, maxCuts, promise]() mutable {
+        std::vector<SceneCut> cuts;
+        double durationSec = 0;
+        if (!detectSceneChanges(source, threshold > 0 ? threshold : 0.3, static_cast<int>(maxCuts), 1.0, cuts, durationSec)) {
+            promise.reject(Error("Scene detection failed for " + inputPath));
+            return;
+        }
+
+        std::vector<double> boundaries;
+        for (const SceneCut& cut : cuts) boundaries.push_back(cut.timeSec);
+        std::sort(boundaries.begin(), boundaries.end());
+
+        std::ostringstream out;
+        out << "{\"durationSec\":" << durationSec << ",\"cuts\":[";
+        for (size_t i = 0; i < cuts.size(); ++i) {
+            if (i > 0) out << ",";
+            out << "{\"timeSec\":" << cuts[i].timeSec << ",\"score\":" << cuts[i].score << "}";
+        }
+        out << "],\"segments\":[";
+        double start = 0;
+        for (size_t i = 0; i <= boundaries.size(); ++i) {
+            double end = i < boundaries.size() ? boundaries[i] : durationSec;
+            if (i > 0) out << ",";
+            out << "{\"start\":" << start << ",\"duration\":" << std::max(0.0, end - start) << "}";
+            start = end;
+        }
+        out << "]}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::buildKeyframeIndex(jsi::Runtime& rt, std::string inputPath) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    auto keyframeIndexes = keyframeIndexes_;
+    workerPool_->enqueue([keyframeIndexes, inputPath, promise]() mutable {
+        auto index = keyframeIndexes->build(inputPath);
+        if (!index) {
+            promise.reject(Error("Keyframe indexing failed for " + inputPath));
+            return;
+        }
+        uint64_t totalFrames = 0;
+        uint32_t maxGop = 0;
+        for (const KeyframeEntry& entry : index->entries) {
+            totalFrames += entry.gopFrames;
+            maxGop = std::max(maxGop, entry.gopFrames);
+        }
+        std::ostringstream out;
+        out << "{\"keyframes\":" << index->entries.size()
+            << ",\"averageGopFrames\":" << (index->entries.empty() ? 0.0 : static_cast<double>(totalFrames) / index->entries.size())
+            << ",\"maxGopFrames\":" << maxGop << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::detectTrimPoints(jsi::Runtime& rt, std::string inputPath, double maxEdgeSec) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([inputPath, maxEdgeSec, promise]() mutable {
+        EdgeTrim trim;
+        if (!detectDeadEdges(stripFileScheme(inputPath), maxEdgeSec > 0 ? maxEdgeSec : 3.0, trim)) {
+            promise.reject(Error("Trim analysis failed for " + inputPath));
+            return;
+        }
+        promise.resolve(edgeTrimJson(trim));
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::autoTrim(jsi::Runtime& rt, std::string inputPath, std::string outputPath, double maxEdgeSec) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    auto keyframeIndexes = keyframeIndexes_;
+    workerPool_->enqueue([keyframeIndexes, inputPath, outputPath, maxEdgeSec, promise]() mutable {
+        EdgeTrim trim;
+        if (!detectDeadEdges(stripFileScheme(inputPath), maxEdgeSec > 0 ? maxEdgeSec : 3.0, trim)) {
+            promise.reject(Error("Trim analysis failed for " + inputPath));
+            return;
+        }
+        // A stream copy can only start on a keyframe; the small margin keeps
+        // the keyframe itself on the right side of trimVideo's cut.
+        double start = std::max(0.0, trim.keyframeStartSec - 0.001);
+        if (!streamCopyTrim(inputPath, outputPath, start, trim.endSec - start, *keyframeIndexes)) {
+            promise.reject(Error("Trim failed for " + inputPath));
+            return;
+        }
+        promise.resolve(edgeTrimJson(trim));
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::analyzeLoudness(jsi::Runtime& rt, std::string inputPath) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([inputPath, promise]() mutable {
+        LoudnessStats stats;
+        if (!measureLoudness(stripFileScheme(inputPath), stats)) {
+            promise.reject(Error("No decodable audio in " + inputPath));
+            return;
+        }
+        __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Loudness of %s: %.1f LUFS, LRA %.1f LU, %.1f dBTP", inputPath.c_str(),
+                            stats.integratedLufs, stats.loudnessRange, stats.truePeakDbtp);
+        std::ostringstream out;
+        out << "{\"durationSec\":" << stats.durationSec << ",\"integratedLufs\":" << stats.integratedLufs
+            << ",\"loudnessRange\":" << stats.loudnessRange << ",\"truePeakDbtp\":" << stats.truePeakDbtp << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::extractAudio(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string format) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([inputPath, outputPath, format, promise]() mutable {
+        AudioExtractStats stats;
+        if (!facebook::react::extractAudio(inputPath, outputPath, format, stats)) {
+            promise.reject(Error("Audio extraction failed for " + inputPath));
+            return;
+        }
+        __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Extracted audio to %s (%s, %s): %.2fs, %lld bytes", outputPath.c_str(),
+                            stats.codec.c_str(), stats.streamCopied ? "copied" : "re-encoded", stats.durationSec,
+                            static_cast<long long>(stats.outputBytes));
+        std::ostringstream out;
+        out << "{\"output\":\"" << jsonEscape(outputPath) << "\",\"format\":\"" << stats.format << "\",\"codec\":\"" << stats.codec
+            << "\",\"streamCopied\":" << (stats.streamCopied ? "true" : "false") << ",\"durationSec\":" << stats.durationSec
+            << ",\"outputBytes\":" << stats.outputBytes << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::muteRanges(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string rangesJson) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([inputPath, outputPath, rangesJson, promise]() mutable {
+        std::vector<MuteRange> ranges = parseMuteRanges(rangesJson);
+        MuteStats stats;
+        if (!facebook::react::muteRanges(inputPath, outputPath, ranges, stats)) {
+            promise.reject(Error("Muting failed for " + inputPath));
+            return;
+        }
+        __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Muted %zu ranges in %s: %lld audio packets copied, %lld re-encoded%s",
+                            ranges.size(), outputPath.c_str(), static_cast<long long>(stats.copiedPackets),
+                            static_cast<long long>(stats.reencodedPackets), stats.spliced ? "" : " (whole track)");
+        std::ostringstream out;
+        out << "{\"output\":\"" << jsonEscape(outputPath) << "\",\"ranges\":" << ranges.size() << ",\"copiedPackets\":" << stats.copiedPackets
+            << ",\"reencodedPackets\":" << stats.reencodedPackets << ",\"spliced\":" << (stats.spliced ? "true" : "false") << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::concat(jsi::Runtime& rt, std::vector<std::string> inputPaths, std::string outputPath,
+                                                     std::string transitionsJson) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    auto keyframeIndexes = keyframeIndexes_;
+    workerPool_->enqueue([inputPaths, outputPath, transitionsJson, keyframeIndexes, promise]() mutable {
+        ConcatStats stats;
+        if (!concatClips(inputPaths, parseTransitions(transitionsJson), outputPath, *keyframeIndexes, stats)) {
+            promise.reject(Error("Concat failed for " + outputPath));
+            return;
+        }
+        __android_log_print(ANDROID_LOG_INFO, "FFmpegModule",
+                            "Joined %d clips into %s in %.2fs (%d transitions, %lld packets copied, %lld frames re-encoded)", stats.clips,
+                            outputPath.c_str(), stats.elapsedSec, stats.transitions, static_cast<long long>(stats.copiedVideoPackets),
+                            static_cast<long long>(stats.reencodedVideoFrames));
+        std::ostringstream out;
+        out << "{\"output\":\"" << jsonEscape(outputPath) << "\",\"clips\":" << stats.clips
+            << ",\"reencodedVideoClips\":" << stats.reencodedVideoClips << ",\"reencodedAudioClips\":" << stats.reencodedAudioClips
+            << ",\"transitions\":" << stats.transitions << ",\"copiedVideoPackets\":" << stats.copiedVideoPackets
+            << ",\"reencodedVideoFrames\":" << stats.reencodedVideoFrames << ",\"durationSec\":" << stats.durationSec
+            << ",\"elapsedSec\":" << stats.elapsedSec
+            << ",\"outputBytes\":" << stats.outputBytes << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::benchmarkExportProfiles(jsi::Runtime& rt, std::vector<std::string> inputPaths, std::string workDir) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([inputPaths, workDir, promise]() mutable {
+        // Serial on purpose: parallel exports would skew each other's timings.
+        std::ostringstream out;
+        out << "[";
+        bool first = true;
+        for (size_t clip = 0; clip < inputPaths.size(); ++clip) {
+            for (const ExportProfile& profile : exportProfiles()) {
+                std::string outputPath = stripFileScheme(workDir) + "/bench-" + profile.name + "-" + std::to_string(clip) + ".mp4";
+                ExportOptions options;
+                options.profile = profile.name;
+                ExportStats stats;
+                bool ok = exportVideo(inputPaths[clip], outputPath, "[]", workDir, options, stats);
+                remove(outputPath.c_str());
+                double fps = stats.elapsedSec > 0 ? stats.frames / stats.elapsedSec : 0;
+                double realtime = stats.elapsedSec > 0 ? stats.mediaDurationSec / stats.elapsedSec : 0;
+                double kbps = stats.mediaDurationSec > 0 ? stats.outputBytes * 8 / stats.mediaDurationSec / 1000 : 0;
+                __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "bench %s %s: %.2fs (%.1f fps, %.2fx realtime), %lld bytes (%.0f kbps)",
+                                    inputPaths[clip].c_str(), profile.name.c_str(), stats.elapsedSec, fps, realtime,
+                                    static_cast<long long>(stats.outputBytes), kbps);
+                if (!first) out << ",";
+                first = false;
+                out << "{\"clip\":\"" << jsonEscape(inputPaths[clip]) << "\",\"profile\":\"" << profile.name
+                    << "\",\"encoder\":\"" << stats.encoder << "\",\"ok\":" << (ok ? "true" : "false")
+                    << ",\"frames\":" << stats.frames << ",\"elapsedSec\":" << stats.elapsedSec << ",\"fps\":" << fps
+                    << ",\"realtime\":" << realtime << ",\"outputBytes\":" << stats.outputBytes << ",\"kbps\":" << kbps << "}";
             }
         }
-        av_packet_unref(pkt);
-    }
-    // Flush encoder
-    avcodec_send_frame(enc_ctx, nullptr);
-    AVPacket out_pkt = {0};
-    while (avcodec_receive_packet(enc_ctx, &out_pkt) == 0) {
-        out_pkt.stream_index = out_stream->index;
-        av_packet_rescale_ts(&out_pkt, enc_ctx->time_base, out_stream->time_base);
-        av_interleaved_write_frame(out_fmt_ctx, &out_pkt);
-        av_packet_unref(&out_pkt);
-    }
-    av_write_trailer(out_fmt_ctx);
-
-    // Cleanup
-    av_frame_free(&frame);
-    av_frame_free(&filt_frame);
-    av_packet_free(&pkt);
-    if (!(out_fmt_ctx->oformat->flags & AVFMT_NOFILE))
-        avio_closep(&out_fmt_ctx->pb);
-    avcodec_free_context(&enc_ctx);
-    avformat_free_context(out_fmt_ctx);
-    avfilter_graph_free(&filter_graph);
-    avcodec_free_context(&dec_ctx);
-    avformat_close_input(&fmt_ctx);
-    __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Overlay C API: Success");
-    return true;
+        out << "]";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+AsyncPromise<std::string> NativeFFmpegModule::exportRenditions(jsi::Runtime& rt, std::string planJson, std::string overlaysJson, std::string renditionsJson) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    workerPool_->enqueue([planJson, overlaysJson, renditionsJson, promise]() mutable {
+        EditPlan plan = parseEditPlan(planJson);
+        std::vector<Rendition> renditions = parseRenditions(renditionsJson);
+        if (plan.inputPath.empty() || renditions.empty()) {
+            promise.reject(Error("Export needs an input and at least one rendition"));
+            return;
+        }
+        std::vector<ExportStats> stats;
+        bool ok = facebook::react::exportRenditions(plan, overlaysJson, renditions, stats);
+        std::ostringstream out;
+        out << "[";
+        for (size_t i = 0; i < stats.size(); ++i) {
+            const ExportStats& s = stats[i];
+            __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Rendition %s (%s, %s, %dx%d): %lld frames in %.2fs, %lld bytes",
+                                s.outputPath.c_str(), s.profile.c_str(), s.encoder.c_str(), s.width, s.height,
+                                static_cast<long long>(s.frames), s.elapsedSec, static_cast<long long>(s.outputBytes));
+            if (i > 0) out << ",";
+            out << "{\"output\":\"" << jsonEscape(s.outputPath) << "\",\"profile\":\"" << s.profile << "\",\"encoder\":\""
+                << s.encoder << "\",\"width\":" << s.width << ",\"height\":" << s.height << ",\"frames\":" << s.frames
+                << ",\"elapsedSec\":" << s.elapsedSec << ",\"outputBytes\":" << s.outputBytes
+                << ",\"targetBytes\":" << s.targetBytes << ",\"videoBitRate\":" << s.videoBitRate
+                << ",\"bypassedFrames\":" << s.bypassedFrames << ",\"decodedFrames\":" << s.decodedFrames << ",\"poolHits\":" << s.poolHits << ",\"poolRequests\":" << s.poolRequests
+                << ",\"peakResidentFrames\":" << s.peakResidentFrames << ",\"hasAudio\":" << (s.hasAudio ? "true" : "false")
+                << ",\"musicDuckedSec\":" << s.musicDuckedSec << ",\"audioGainDb\":" << s.audioGainDb << ",\"ok\":" << (s.ok ? "true" : "false") << "}";
+        }
+        out << "]";
+        if (!ok) {
+            promise.reject(Error("Export failed: " + out.str()));
+            return;
+        }
+        promise.resolve(out.str());
+    });
+    return promise;
 }
 
-}
\ No newline at end of file
+AsyncPromise<std::string> NativeFFmpegModule::exportAnimated(jsi::Runtime& rt, std::string planJson, std::string overlaysJson, std::string outputPath, std::string optionsJson) {
+    AsyncPromise<std::string> promise(rt, jsInvoker_);
+    auto palettes = palettes_;
+    workerPool_->enqueue([planJson, overlaysJson, outputPath, optionsJson, palettes, promise]() mutable {
+        EditPlan plan = parseEditPlan(planJson);
+        if (plan.inputPath.empty()) {
+            promise.reject(Error("Export needs an input"));
+            return;
+        }
+        AnimatedOptions options = parseAnimatedOptions(optionsJson);
+        if (!animatedFormatAvailable(options.format)) {
+            promise.reject(Error("Unsupported animated format: " + options.format + " is not in this build"));
+            return;
+        }
+        AnimatedStats stats;
+        if (!facebook::react::exportAnimated(plan, overlaysJson, outputPath, options, *palettes, stats)) {
+            promise.reject(Error("Animated export failed for " + plan.inputPath));
+            return;
+        }
+        __android_log_print(ANDROID_LOG_INFO, "FFmpegModule", "Animated %s %dx%d@%.2f: %lld frames in %.2fs (palette %s, %.2fs), %lld bytes",
+                            options.format.c_str(), stats.width, stats.height, stats.fps, static_cast<long long>(stats.frames),
+                            stats.elapsedSec, stats.paletteCached ? "cached" : "built", stats.paletteSec,
+                            static_cast<long long>(stats.outputBytes));
+        std::ostringstream out;
+        out << "{\"output\":\"" << jsonEscape(outputPath) << "\",\"format\":\"" << options.format << "\",\"width\":" << stats.width
+            << ",\"height\":" << stats.height << ",\"fps\":" << stats.fps << ",\"frames\":" << stats.frames
+            << ",\"paletteCached\":" << (stats.paletteCached ? "true" : "false") << ",\"paletteSec\":" << stats.paletteSec
+            << ",\"elapsedSec\":" << stats.elapsedSec << ",\"outputBytes\":" << stats.outputBytes << "}";
+        promise.resolve(out.str());
+    });
+    return promise;
+}
+
+}
@@ -2,8 +2,18 @@
 
 #include <AppSpecsJSI.h>
 
+#include "AnimatedExport.h"
+#include "KeyframeIndex.h"
+#include "MediaCache.h"
+#include "PreviewSession.h"
+#include "ProxyManager.h"
+#include "ScrubSession.h"
+#include "ThreadPool.h"
+
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -19,12 +29,152 @@ public:
 
   std::string getFFmpegVersion(jsi::Runtime& rt);
   std::string getVideoMetaData(jsi::Runtime& rt, std::string filePath);
+  // Probes every path on the worker pool and streams one JSON result per file
+  // to onResult as soon as it is ready (in input order when `ordered` is set).
+  // Resolves with the number of files probed; per-file failures are reported
+  // through onResult rather than rejecting the batch.
+  AsyncPromise<double> probeMany(jsi::Runtime& rt, std::vector<std::string> paths, bool ordered, AsyncCallback<double, std::string> onResult);
 
   // New methods
   bool muteVideo(jsi::Runtime& rt, std::string inputPath, std::string outputPath);
   bool trimLast2Seconds(jsi::Runtime& rt, std::string inputPath, std::string outputPath);
   bool trimVideo(jsi::Runtime& rt, std::string inputPath, std::string outputPath, double start, double duration);
-  bool burnOverlays(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string overlaysJson, std::string workDir);
+  // Re-encodes the video with overlays drawn in. exportOptionsJson is a flat
+  // object such as {"profile":"small-upload","resolution":720}; see
+  // ExportProfile.h for the options ("share-fast" at source size when empty).
+  bool burnOverlays(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string overlaysJson, std::string workDir, std::string exportOptionsJson);
+
+  // Opt-in: transcodes a low-res, short-GOP proxy next to inputPath in the
+  // background. Thumbnail/filmstrip/preview APIs pick it up automatically
+  // once it exists; burnOverlays/trimVideo keep reading the original.
+  AsyncPromise<std::string> generateProxy(jsi::Runtime& rt, std::string inputPath, double maxHeight);
+
+  // Enables the on-disk thumbnail/filmstrip cache under `directory`, capped
+  // at maxBytes with LRU eviction. Returns whether the cache is active.
+  bool configureMediaCache(jsi::Runtime& rt, std::string directory, double maxBytes);
+
+  // Decodes only the keyframe nearest timeSec on the decode pool and scales
+  // it straight to the target size. Writes outputPath ("jpeg" encoded, or
+  // tightly packed pixels for "rgba") and resolves with JSON { uri, width,
+  // height, timeSec, cached }. "webp" is rejected up front when libwebp is
+  // not in the build.
+  AsyncPromise<std::string> generateThumbnail(jsi::Runtime& rt, std::string filePath, double timeSec, double width, double height, std::string format, std::string outputPath);
+  // Packs `count` evenly spaced keyframes into one sprite sheet (tiles of
+  // tileWidth px, row-major) and returns it with a tile -> timestamp map.
+  // Same format/outputPath contract as generateThumbnail; resolves with JSON
+  // { uri, tiles: [{ index, timeSec }], columns, rows, tileWidth,
+  // tileHeight, cached }.
+  AsyncPromise<std::string> generateFilmstrip(jsi::Runtime& rt, std::string filePath, double count, double tileWidth, std::string format, std::string outputPath);
+
+  // Keeps a demuxer + decoder open on inputPath (or its proxy) for repeated
+  // renderPreviewFrame calls. Returns a session id, or -1 on failure.
+  double openPreviewSession(jsi::Runtime& rt, std::string inputPath, double displayWidth, double displayHeight, std::string workDir);
+  // Frame at timeSec with overlaysJson composited, as { data: ArrayBuffer
+  // (RGBA), width, height, timeSec }.
+  jsi::Object renderPreviewFrame(jsi::Runtime& rt, double sessionId, double timeSec, std::string overlaysJson);
+  void closePreviewSession(jsi::Runtime& rt, double sessionId);
+
+  // Trim-handle scrubbing: decoded, display-size frames are kept in a window
+  // of at most maxBytes around the playhead and prefetched in the direction
+  // it moves. scrubFrame returns { data: ArrayBuffer (RGBA), width, height,
+  // timeSec, hit }; getScrubStats reports { requests, hits, hitRate,
+  // decodedFrames, seeks, cachedFrames, cachedBytes }.
+  double openScrubSession(jsi::Runtime& rt, std::string inputPath, double displayWidth, double displayHeight, double maxBytes);
+  jsi::Object scrubFrame(jsi::Runtime& rt, double sessionId, double timeSec);
+  jsi::Object getScrubStats(jsi::Runtime& rt, double sessionId);
+  void closeScrubSession(jsi::Runtime& rt, double sessionId);
+
+  // Decodes the audio once into `buckets` [min, max, rms] peaks, streaming
+  // completed buckets to onPeaks(firstBucket, flatPeaks) as they are ready.
+  // Finished peak data is kept in the media cache. Resolves with the bucket
+  // count.
+  AsyncPromise<double> extractWaveform(jsi::Runtime& rt, std::string inputPath, double buckets, AsyncCallback<double, std::vector<double>> onPeaks);
+
+  // Scene-change analysis at reduced resolution. Resolves with JSON
+  // { durationSec, cuts: [{ timeSec, score }], segments: [{ start, duration }] }
+  // where cuts are strongest first and segments (in time order) can be passed
+  // straight to trimVideo.
+  AsyncPromise<std::string> detectScenes(jsi::Runtime& rt, std::string inputPath, double threshold, double maxCuts);
+
+  // One demux-only pass recording every keyframe's pts/dts/byte offset and
+  // GOP length into a "<name>.kfindex" sidecar. trimVideo, thumbnails,
+  // filmstrips and preview sessions use it for exact keyframe lookups once it
+  // exists. Resolves with JSON { keyframes, averageGopFrames, maxGopFrames }.
+  AsyncPromise<std::string> buildKeyframeIndex(jsi::Runtime& rt, std::string inputPath);
+
+  // Looks for black/frozen video and silent audio within maxEdgeSec of
+  // either end. Resolves with JSON { durationSec, startSec, endSec,
+  // keyframeStartSec, videoHeadSec, videoTailSec, audioHeadSec, audioTailSec,
+  // hasAudio }.
+  AsyncPromise<std::string> detectTrimPoints(jsi::Runtime& rt, std::string inputPath, double maxEdgeSec);
+  // detectTrimPoints followed by a stream-copy trim to outputPath (starting
+  // at keyframeStartSec). Resolves with the same JSON.
+  AsyncPromise<std::string> autoTrim(jsi::Runtime& rt, std::string inputPath, std::string outputPath, double maxEdgeSec);
+
+  // EBU R128 loudness of the clip's audio in one decode pass. Resolves with
+  // JSON { durationSec, integratedLufs, loudnessRange, truePeakDbtp }; pass
+  // integratedLufs/truePeakDbtp to exports as loudnessLufs and
+  // loudnessTruePeakDbtp together with normalizeLufs.
+  AsyncPromise<std::string> analyzeLoudness(jsi::Runtime& rt, std::string inputPath);
+
+  // Saves the clip's audio as format ("m4a", "aac", "opus" or "wav"; empty
+  // follows outputPath's extension), copying the track when its codec fits
+  // and re-encoding otherwise. Resolves with JSON { output, format, codec,
+  // streamCopied, durationSec, outputBytes }.
+  AsyncPromise<std::string> extractAudio(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string format);
+  // Silences the ranges in rangesJson ([{ startSec, endSec }]) in the main
+  // audio track. Video is copied, and only the audio around each range is
+  // re-encoded. Resolves with JSON { output, ranges, copiedPackets,
+  // reencodedPackets, spliced }.
+  AsyncPromise<std::string> muteRanges(jsi::Runtime& rt, std::string inputPath, std::string outputPath, std::string rangesJson);
+  // Joins inputPaths end to end. Clips whose video or audio matches the
+  // first clip's are stream-copied onto one continuous timeline; the others
+  // are re-encoded to match. transitionsJson ([{ type, durationSec }], one
+  // per gap; "cut", "crossfade", "dipToBlack" or "slide") re-encodes only
+  // the GOPs around each transition. Resolves with JSON { output, clips,
+  // reencodedVideoClips, reencodedAudioClips, transitions,
+  // copiedVideoPackets, reencodedVideoFrames, durationSec, elapsedSec,
+  // outputBytes }.
+  AsyncPromise<std::string> concat(jsi::Runtime& rt, std::vector<std::string> inputPaths, std::string outputPath, std::string transitionsJson);
+
+  // Exports every clip once per export profile (no overlays, outputs in
+  // workDir are deleted afterwards) and resolves with a JSON array of
+  // { clip, profile, encoder, ok, frames, elapsedSec, fps, realtime,
+  // outputBytes, kbps }. Results are also written to logcat.
+  AsyncPromise<std::string> benchmarkExportProfiles(jsi::Runtime& rt, std::vector<std::string> inputPaths, std::string workDir);
+
+  // Exports the edit plan ({ input, workDir, startSec, durationSec, keepAudio,
+  // music, musicVolume, ... }) to every rendition in renditionsJson
+  // ([{ output, profile, resolution, targetBytes }]) from a single decode and
+  // overlay pass. Resolves with a JSON array of { output, profile, encoder,
+  // width, height, frames, elapsedSec, outputBytes, targetBytes, videoBitRate,
+  // bypassedFrames, decodedFrames, poolHits, poolRequests,
+  // peakResidentFrames, hasAudio, musicDuckedSec, audioGainDb, ok }; rejects
+  // if any rendition failed.
+  AsyncPromise<std::string> exportRenditions(jsi::Runtime& rt, std::string planJson, std::string overlaysJson, std::string renditionsJson);
+
+  // Exports the edit plan as an animated GIF or WebP. optionsJson is
+  // { format: "gif"|"webp", width, fps, dither: "bayer"|"floyd" }. GIF
+  // palettes are cached per plan. Resolves with JSON { output, format,
+  // width, height, fps, frames, paletteCached, paletteSec, elapsedSec,
+  // outputBytes }.
+  AsyncPromise<std::string> exportAnimated(jsi::Runtime& rt, std::string planJson, std::string overlaysJson, std::string outputPath, std::string optionsJson);
+
+private:
+  std::shared_ptr<ThreadPool> workerPool_;
+  // Short interactive decodes (thumbnails, filmstrip tiles): kept apart from
+  // workerPool_ so they never queue behind a long export.
+  std::shared_ptr<ThreadPool> decodePool_;
+  // Runs buildFilmstrip, which waits on its tiles in decodePool_ and so must
+  // not run on a decodePool_ thread itself.
+  std::shared_ptr<ThreadPool> filmstripPool_;
+  std::shared_ptr<MediaCache> mediaCache_;
+  std::shared_ptr<ProxyManager> proxies_;
+  std::shared_ptr<KeyframeIndexStore> keyframeIndexes_;
+  std::shared_ptr<PaletteCache> palettes_;
+  std::unordered_map<int, std::shared_ptr<PreviewSession>> previewSessions_;
+  std::unordered_map<int, std::shared_ptr<ScrubSession>> scrubSessions_;
+  int nextSessionId_ = 1;
 };
 
 } // namespace facebook::react
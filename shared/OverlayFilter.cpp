@@ -0,0 +1,155 @@
+#include "OverlayFilter.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+namespace facebook::react {
+
+bool buildOverlayFilter(const std::string& overlaysJson, const std::string& workDir, double scale, std::string& filter) {
+    std::string fontPath = workDir + "/SpaceMono-Regular.ttf";
+    std::vector<std::string> filterParts;
+    try {
+        for (const std::string& obj : splitJsonObjects(overlaysJson)) {
+            std::string type = jsonField(obj, "type");
+            std::string content = jsonField(obj, "content");
+            std::string x = jsonField(obj, "x");
+            std::string y = jsonField(obj, "y");
+            std::string size = jsonField(obj, "scale");
+            if ((type == "emoji" || type == "text") && !fontPath.empty()) {
+                // Clean up font path (remove double slashes)
+                std::string cleanFontPath = fontPath;
+                while (cleanFontPath.find("//") != std::string::npos) {
+                    cleanFontPath.replace(cleanFontPath.find("//"), 2, "/");
+                }
+                std::ostringstream f;
+                f << "drawtext=text='" << content << "'";
+                // Cast x/y to int for FFmpeg drawtext
+                if (x.empty()) {
+                    f << ":x=0";
+                } else {
+                    try {
+                        f << ":x=" << std::to_string(static_cast<int>(std::stof(x) * scale));
+                    } catch (...) {
+                        f << ":x=0";
+                    }
+                }
+                if (y.empty()) {
+                    f << ":y=0";
+                } else {
+                    try {
+                        f << ":y=" << std::to_string(static_cast<int>(std::stof(y) * scale));
+                    } catch (...) {
+                        f << ":y=0";
+                    }
+                }
+                int fontSize = static_cast<int>((size.empty() ? 1.0f : std::stof(size)) * 40 * scale);
+                f << ":fontsize=" << std::max(1, fontSize);
+                f << ":fontcolor=white";
+                f << ":fontfile='" << cleanFontPath << "'";
+                double start = jsonNumber(obj, "startSec", 0);
+                double end = jsonNumber(obj, "endSec", 0);
+                if (end > 0) {
+                    f << ":enable='between(t," << start << "," << end << ")'";
+                } else if (start > 0) {
+                    f << ":enable='gte(t," << start << ")'";
+                }
+                filterParts.push_back(f.str());
+            }
+        }
+    } catch (...) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Overlay JSON parse error");
+        return false;
+    }
+
+    std::ostringstream out;
+    for (size_t i = 0; i < filterParts.size(); ++i) {
+        if (i > 0) out << ",";
+        out << filterParts[i];
+    }
+    filter = out.str();
+    return true;
+}
+
+std::vector<OverlayWindow> overlayWindows(const std::string& overlaysJson) {
+    std::vector<OverlayWindow> windows;
+    for (const std::string& obj : splitJsonObjects(overlaysJson)) {
+        std::string type = jsonField(obj, "type");
+        if (type != "emoji" && type != "text") continue;
+        OverlayWindow window;
+        window.startSec = jsonNumber(obj, "startSec", 0);
+        window.endSec = jsonNumber(obj, "endSec", 0);
+        windows.push_back(window);
+    }
+    return windows;
+}
+
+bool overlayVisibleAt(const std::vector<OverlayWindow>& windows, double timeSec) {
+    for (const OverlayWindow& window : windows) {
+        if (timeSec >= window.startSec && (window.endSec <= 0 || timeSec <= window.endSec)) return true;
+    }
+    return false;
+}
+
+std::string uprightScaleFilter(int width, int height, int quarterTurns) {
+    bool turned = quarterTurns & 1;
+    std::ostringstream chain;
+    chain << "scale=" << (turned ? height : width) << ":" << (turned ? width : height) << ":flags=bilinear";
+    switch (quarterTurns & 3) {
+    case 1: chain << ",transpose=clock"; break;
+    case 2: chain << ",hflip,vflip"; break;
+    case 3: chain << ",transpose=cclock"; break;
+    default: break;
+    }
+    return chain.str();
+}
+
+AVFilterGraph* createFilterGraph(const std::string& chain, int width, int height, AVPixelFormat pixFmt,
+                                 AVRational timeBase, AVRational sampleAspectRatio,
+                                 AVFilterContext** buffersrcCtx, AVFilterContext** buffersinkCtx) {
+    AVFilterGraph* graph = avfilter_graph_alloc();
+    if (!graph) return nullptr;
+    char args[512];
+    snprintf(args, sizeof(args),
+        "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+        width, height, pixFmt, timeBase.num, timeBase.den,
+        sampleAspectRatio.num, sampleAspectRatio.den ? sampleAspectRatio.den : 1);
+    if (avfilter_graph_create_filter(buffersrcCtx, avfilter_get_by_name("buffer"), "in", args, nullptr, graph) < 0 ||
+        avfilter_graph_create_filter(buffersinkCtx, avfilter_get_by_name("buffersink"), "out", nullptr, nullptr, graph) < 0) {
+        avfilter_graph_free(&graph);
+        return nullptr;
+    }
+
+    AVFilterInOut* outputs = avfilter_inout_alloc();
+    AVFilterInOut* inputs = avfilter_inout_alloc();
+    outputs->name = av_strdup("in");
+    outputs->filter_ctx = *buffersrcCtx;
+    outputs->pad_idx = 0;
+    outputs->next = nullptr;
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = *buffersinkCtx;
+    inputs->pad_idx = 0;
+    inputs->next = nullptr;
+
+    int ret = avfilter_graph_parse_ptr(graph, chain.empty() ? "null" : chain.c_str(), &inputs, &outputs, nullptr);
+    if (ret >= 0) ret = avfilter_graph_config(graph, nullptr);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0) {
+        char errbuf[256];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Failed to set up filter graph '%s': %s", chain.c_str(), errbuf);
+        avfilter_graph_free(&graph);
+        return nullptr;
+    }
+    return graph;
+}
+
+} // namespace facebook::react
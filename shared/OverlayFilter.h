@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+#include <libavutil/pixfmt.h>
+#include <libavutil/rational.h>
+}
+
+namespace facebook::react {
+
+// Build the drawtext filter chain for the overlays JSON produced by
+// OverlaySystem. Positions and font sizes are multiplied by `scale` so the
+// same overlays can be drawn on a downscaled frame. An overlay with
+// "startSec"/"endSec" is only drawn in that window of the output timeline.
+// Returns false if the JSON cannot be parsed; `filter` is left empty when
+// there is nothing to draw.
+bool buildOverlayFilter(const std::string& overlaysJson, const std::string& workDir, double scale, std::string& filter);
+
+// When an overlay is on screen; endSec of 0 means to the end.
+struct OverlayWindow {
+  double startSec = 0;
+  double endSec = 0;
+};
+
+// Windows of the overlays buildOverlayFilter draws, one per overlay.
+std::vector<OverlayWindow> overlayWindows(const std::string& overlaysJson);
+// Whether any overlay is drawn at timeSec.
+bool overlayVisibleAt(const std::vector<OverlayWindow>& windows, double timeSec);
+
+// Scale to width x height as shown, then turn upright by quarterTurns
+// clockwise quarter turns (see displayQuarterTurns). Turning after the scale
+// keeps it to output-size frames.
+std::string uprightScaleFilter(int width, int height, int quarterTurns);
+
+// buffer -> `chain` -> buffersink, configured for frames of the given
+// geometry and format. Returns nullptr (and logs) on failure.
+AVFilterGraph* createFilterGraph(const std::string& chain, int width, int height, AVPixelFormat pixFmt,
+                                 AVRational timeBase, AVRational sampleAspectRatio,
+                                 AVFilterContext** buffersrcCtx, AVFilterContext** buffersinkCtx);
+
+} // namespace facebook::react
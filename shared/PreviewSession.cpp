@@ -0,0 +1,171 @@
+#include "PreviewSession.h"
+#include "OverlayFilter.h"
+#include <android/log.h>
+#include <sstream>
+
+extern "C" {
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Enough to step back and forth across a couple of frames without re-decoding
+// while keeping 4K sessions well under 100 MB.
+constexpr size_t kRecentFrames = 4;
+
+// Requests this far ahead of the newest decoded frame decode forward rather
+// than seek; typical phone recordings have a keyframe every 1-2 s.
+constexpr double kForwardDecodeWindowSec = 1.0;
+
+} // namespace
+
+std::unique_ptr<PreviewSession> PreviewSession::open(const std::string& sourcePath, int referenceWidth, int referenceHeight,
+                                                     int displayWidth, int displayHeight, const std::string& workDir,
+                                                     std::shared_ptr<const KeyframeIndex> keyframes) {
+    std::unique_ptr<PreviewSession> session(new PreviewSession());
+    fitTargetSize(referenceWidth, referenceHeight, displayWidth, displayHeight);
+    session->decoder_ = openVideoDecoder(sourcePath, displayWidth, displayHeight);
+    if (!session->decoder_) return nullptr;
+    if (keyframes && keyframes->streamIndex == session->decoder_->streamIndex) session->keyframes_ = std::move(keyframes);
+    session->quarterTurns_ = displayQuarterTurns(session->decoder_->stream());
+    session->workDir_ = workDir;
+    session->displayWidth_ = displayWidth;
+    session->displayHeight_ = displayHeight;
+    session->overlayScale_ = referenceWidth > 0 ? static_cast<double>(displayWidth) / referenceWidth : 1.0;
+    return session;
+}
+
+PreviewSession::~PreviewSession() {
+    clearRecent();
+    avfilter_graph_free(&filterGraph_);
+}
+
+void PreviewSession::clearRecent() {
+    for (AVFrame*& frame : recent_) av_frame_free(&frame);
+    recent_.clear();
+}
+
+AVFrame* PreviewSession::decodeNext() {
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    for (;;) {
+        int ret = avcodec_receive_frame(decoder_->decCtx, frame);
+        if (ret == 0) {
+            frame->pts = frame->best_effort_timestamp;
+            break;
+        }
+        if (ret == AVERROR_EOF || eof_) {
+            av_frame_free(&frame);
+            break;
+        }
+        if (av_read_frame(decoder_->fmtCtx, pkt) < 0) {
+            eof_ = true;
+            avcodec_send_packet(decoder_->decCtx, nullptr);
+            continue;
+        }
+        if (pkt->stream_index == decoder_->streamIndex) avcodec_send_packet(decoder_->decCtx, pkt);
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    return frame;
+}
+
+const AVFrame* PreviewSession::frameAt(double timeSec) {
+    AVStream* st = decoder_->stream();
+    int64_t target = av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, st->time_base);
+    if (st->start_time != AV_NOPTS_VALUE) target += st->start_time;
+
+    // Already decoded: the newest frame at or before the target, as long as
+    // we know it is still the one on screen at that time.
+    for (size_t i = recent_.size(); i-- > 0;) {
+        const AVFrame* frame = recent_[i];
+        if (frame->pts > target) continue;
+        bool covered = i + 1 < recent_.size() || eof_ || target < frame->pts + std::max<int64_t>(frame->duration, 1);
+        if (covered) return frame;
+        break;
+    }
+
+    const KeyframeEntry* keyframe = keyframes_ ? keyframes_->atOrBefore(target) : nullptr;
+    bool decodeForward = !recent_.empty() && !eof_ && target > recent_.back()->pts;
+    if (decodeForward && keyframe) {
+        // Seeking would land on a keyframe we've already decoded past.
+        decodeForward = keyframe->pts <= recent_.back()->pts;
+    } else if (decodeForward) {
+        decodeForward = (target - recent_.back()->pts) * av_q2d(st->time_base) < kForwardDecodeWindowSec;
+    }
+    if (!decodeForward) {
+        if (!keyframe || !seekToKeyframe(decoder_->fmtCtx, *keyframes_, *keyframe)) {
+            av_seek_frame(decoder_->fmtCtx, decoder_->streamIndex, target, AVSEEK_FLAG_BACKWARD);
+        }
+        avcodec_flush_buffers(decoder_->decCtx);
+        clearRecent();
+        eof_ = false;
+    }
+
+    for (;;) {
+        AVFrame* frame = decodeNext();
+        if (!frame) return recent_.empty() ? nullptr : recent_.back();
+        recent_.push_back(frame);
+        if (recent_.size() > kRecentFrames) {
+            av_frame_free(&recent_.front());
+            recent_.pop_front();
+        }
+        if (frame->pts >= target) {
+            // Overshot: the previous frame is the one displayed at target.
+            if (frame->pts > target && recent_.size() >= 2) return recent_[recent_.size() - 2];
+            return frame;
+        }
+    }
+}
+
+bool PreviewSession::ensureFilter(const std::string& overlaysJson, const AVFrame* frame) {
+    if (filterGraph_ && overlaysJson == filterOverlaysJson_ && frame->width == filterWidth_ &&
+        frame->height == filterHeight_ && frame->format == filterFormat_) {
+        return true;
+    }
+    avfilter_graph_free(&filterGraph_);
+
+    std::string overlayChain;
+    if (!buildOverlayFilter(overlaysJson, workDir_, overlayScale_, overlayChain)) return false;
+    // Scale and turn first so drawtext works on upright display-size pixels.
+    std::ostringstream chain;
+    chain << uprightScaleFilter(displayWidth_, displayHeight_, quarterTurns_);
+    if (!overlayChain.empty()) chain << "," << overlayChain;
+    chain << ",format=rgba";
+
+    AVStream* st = decoder_->stream();
+    filterGraph_ = createFilterGraph(chain.str(), frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                     st->time_base, decoder_->decCtx->sample_aspect_ratio, &buffersrcCtx_, &buffersinkCtx_);
+    if (!filterGraph_) return false;
+    filterOverlaysJson_ = overlaysJson;
+    filterWidth_ = frame->width;
+    filterHeight_ = frame->height;
+    filterFormat_ = frame->format;
+    return true;
+}
+
+bool PreviewSession::render(double timeSec, const std::string& overlaysJson, std::vector<uint8_t>& rgba, double& shownAtSec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const AVFrame* frame = frameAt(timeSec);
+    if (!frame) return false;
+    if (!ensureFilter(overlaysJson, frame)) return false;
+
+    // KEEP_REF: the decoded frame stays in recent_ for the next request.
+    if (av_buffersrc_add_frame_flags(buffersrcCtx_, const_cast<AVFrame*>(frame), AV_BUFFERSRC_FLAG_KEEP_REF) < 0) return false;
+    AVFrame* out = av_frame_alloc();
+    bool ok = av_buffersink_get_frame(buffersinkCtx_, out) >= 0;
+    if (ok) {
+        int size = av_image_get_buffer_size(AV_PIX_FMT_RGBA, out->width, out->height, 1);
+        rgba.resize(size);
+        av_image_copy_to_buffer(rgba.data(), size, out->data, out->linesize, AV_PIX_FMT_RGBA, out->width, out->height, 1);
+        shownAtSec = frameTimeSec(*decoder_, frame);
+    }
+    av_frame_free(&out);
+    return ok;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "FrameExtractor.h"
+#include "KeyframeIndex.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavfilter/avfilter.h>
+}
+
+namespace facebook::react {
+
+// A warm demuxer + decoder for one clip, used to render "what the export will
+// look like" frames without running an export. The most recently decoded
+// frames are kept so that nearby timestamps are answered without a seek, and
+// requests slightly ahead of the playhead decode forward instead of seeking.
+class PreviewSession {
+public:
+  // sourcePath may be an editing proxy; overlay coordinates are expressed in
+  // referenceWidth x referenceHeight (the original's size as shown) and are
+  // scaled to the display size. Frames are turned upright by the source's
+  // display matrix. A display dimension of 0 keeps the aspect ratio. With a
+  // keyframe index for sourcePath, seeks land exactly on the keyframe before
+  // the target and forward decoding is chosen whenever no keyframe lies in
+  // between, however far ahead the target is.
+  static std::unique_ptr<PreviewSession> open(const std::string& sourcePath, int referenceWidth, int referenceHeight,
+                                              int displayWidth, int displayHeight, const std::string& workDir,
+                                              std::shared_ptr<const KeyframeIndex> keyframes = nullptr);
+  ~PreviewSession();
+
+  // Composite `overlaysJson` onto the frame shown at timeSec and write it as
+  // tightly packed RGBA at display size.
+  bool render(double timeSec, const std::string& overlaysJson, std::vector<uint8_t>& rgba, double& shownAtSec);
+
+  int width() const { return displayWidth_; }
+  int height() const { return displayHeight_; }
+
+private:
+  PreviewSession() = default;
+
+  // Borrowed reference into recent_; valid until the next decode.
+  const AVFrame* frameAt(double timeSec);
+  AVFrame* decodeNext();
+  void clearRecent();
+  bool ensureFilter(const std::string& overlaysJson, const AVFrame* frame);
+
+  std::unique_ptr<VideoDecoder> decoder_;
+  std::shared_ptr<const KeyframeIndex> keyframes_;
+  std::string workDir_;
+  int quarterTurns_ = 0;
+  int displayWidth_ = 0;
+  int displayHeight_ = 0;
+  double overlayScale_ = 1.0;
+  bool eof_ = false;
+
+  // Decoded frames in presentation order, oldest first.
+  std::deque<AVFrame*> recent_;
+
+  AVFilterGraph* filterGraph_ = nullptr;
+  AVFilterContext* buffersrcCtx_ = nullptr;
+  AVFilterContext* buffersinkCtx_ = nullptr;
+  std::string filterOverlaysJson_;
+  int filterWidth_ = 0;
+  int filterHeight_ = 0;
+  int filterFormat_ = -1;
+
+  std::mutex mutex_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,241 @@
+#include "ProxyManager.h"
+#include "ExportProfile.h"
+#include "FrameExtractor.h"
+#include "MediaUtils.h"
+#include <android/log.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// Keyframe every 10 frames and no B-frames: every scrub position is at most
+// a few cheap decodes from a keyframe.
+constexpr int kProxyGopSize = 10;
+
+bool fileMtime(const std::string& path, time_t& mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    mtime = st.st_mtime;
+    return true;
+}
+
+// Prefer x264 tuned for decode speed; fall back to the built-in MPEG-4 Part 2
+// encoder, which every FFmpeg build ships. Frames are rescaled into the
+// encoder's time_base, which may be coarser than timeBase.
+AVCodecContext* openProxyEncoder(int width, int height, AVRational timeBase, AVRational frameRate, bool globalHeader) {
+    const char* candidates[] = {"libx264", "mpeg4"};
+    for (const char* name : candidates) {
+        const AVCodec* enc = avcodec_find_encoder_by_name(name);
+        if (!enc) continue;
+        AVCodecContext* encCtx = avcodec_alloc_context3(enc);
+        encCtx->width = width;
+        encCtx->height = height;
+        encCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+        encCtx->time_base = encoderTimeBase(timeBase);
+        encCtx->framerate = frameRate;
+        encCtx->gop_size = kProxyGopSize;
+        encCtx->max_b_frames = 0;
+        encCtx->thread_count = 0;
+        if (globalHeader) encCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (enc->id == AV_CODEC_ID_H264) {
+            av_opt_set(encCtx->priv_data, "preset", "ultrafast", 0);
+            av_opt_set(encCtx->priv_data, "tune", "fastdecode", 0);
+            av_opt_set(encCtx->priv_data, "crf", "28", 0);
+        } else {
+            encCtx->flags |= AV_CODEC_FLAG_QSCALE;
+            encCtx->global_quality = FF_QP2LAMBDA * 6;
+        }
+        int ret = avcodec_open2(encCtx, enc, nullptr);
+        if (ret >= 0) return encCtx;
+        char errbuf[256];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        __android_log_print(ANDROID_LOG_WARN, "FFmpegModule", "Proxy: encoder %s failed to open: %s", name, errbuf);
+        avcodec_free_context(&encCtx);
+    }
+    return nullptr;
+}
+
+bool writeEncodedPackets(AVCodecContext* encCtx, AVFormatContext* outFmtCtx, AVStream* outStream, AVPacket* pkt) {
+    while (avcodec_receive_packet(encCtx, pkt) == 0) {
+        pkt->stream_index = outStream->index;
+        av_packet_rescale_ts(pkt, encCtx->time_base, outStream->time_base);
+        if (av_interleaved_write_frame(outFmtCtx, pkt) < 0) return false;
+    }
+    return true;
+}
+
+bool transcodeProxy(const std::string& inputPath, const std::string& outputPath, int maxHeight, int& outWidth, int& outHeight) {
+    auto decoder = openVideoDecoder(inputPath, 0, maxHeight, FF_THREAD_FRAME);
+    if (!decoder) return false;
+    AVStream* inStream = decoder->stream();
+    AVFormatContext* outFmtCtx = nullptr;
+    AVCodecContext* encCtx = nullptr;
+    AVStream* outStream = nullptr;
+    SwsContext* sws = nullptr;
+    AVPacket* pkt = av_packet_alloc();
+    AVFrame* frame = av_frame_alloc();
+    AVFrame* scaled = av_frame_alloc();
+    const AVPacketSideData* displayMatrix = nullptr;
+    bool success = false;
+    bool flushing = false;
+
+    outWidth = inStream->codecpar->width;
+    outHeight = inStream->codecpar->height;
+    if (outHeight > maxHeight) {
+        outWidth = 0;
+        outHeight = maxHeight;
+    }
+    fitTargetSize(inStream->codecpar->width, inStream->codecpar->height, outWidth, outHeight);
+
+    avformat_alloc_output_context2(&outFmtCtx, nullptr, "mp4", outputPath.c_str());
+    if (!outFmtCtx) goto end;
+    encCtx = openProxyEncoder(outWidth, outHeight, inStream->time_base, av_guess_frame_rate(decoder->fmtCtx, inStream, nullptr),
+                              outFmtCtx->oformat->flags & AVFMT_GLOBALHEADER);
+    if (!encCtx) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Proxy: no usable encoder");
+        goto end;
+    }
+    outStream = avformat_new_stream(outFmtCtx, nullptr);
+    if (!outStream) goto end;
+    if (avcodec_parameters_from_context(outStream->codecpar, encCtx) < 0) goto end;
+    outStream->time_base = encCtx->time_base;
+    // Keep the recording's rotation so proxy frames display like the original.
+    displayMatrix = av_packet_side_data_get(inStream->codecpar->coded_side_data, inStream->codecpar->nb_coded_side_data,
+                                            AV_PKT_DATA_DISPLAYMATRIX);
+    if (displayMatrix) {
+        AVPacketSideData* sd = av_packet_side_data_new(&outStream->codecpar->coded_side_data, &outStream->codecpar->nb_coded_side_data,
+                                                       AV_PKT_DATA_DISPLAYMATRIX, displayMatrix->size, 0);
+        if (sd) memcpy(sd->data, displayMatrix->data, displayMatrix->size);
+    }
+
+    if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) {
+        if (avio_open(&outFmtCtx->pb, outputPath.c_str(), AVIO_FLAG_WRITE) < 0) goto end;
+    }
+    if (avformat_write_header(outFmtCtx, nullptr) < 0) goto end;
+
+    scaled->format = AV_PIX_FMT_YUV420P;
+    scaled->width = outWidth;
+    scaled->height = outHeight;
+    if (av_frame_get_buffer(scaled, 0) < 0) goto end;
+
+    for (;;) {
+        if (!flushing) {
+            if (av_read_frame(decoder->fmtCtx, pkt) < 0) {
+                flushing = true;
+                avcodec_send_packet(decoder->decCtx, nullptr);
+            } else {
+                bool isVideo = pkt->stream_index == decoder->streamIndex;
+                if (isVideo) avcodec_send_packet(decoder->decCtx, pkt);
+                av_packet_unref(pkt);
+                if (!isVideo) continue;
+            }
+        }
+        int ret;
+        while ((ret = avcodec_receive_frame(decoder->decCtx, frame)) == 0) {
+            sws = sws_getCachedContext(sws, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                       outWidth, outHeight, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+            if (!sws || av_frame_make_writable(scaled) < 0) goto end;
+            sws_scale(sws, frame->data, frame->linesize, 0, frame->height, scaled->data, scaled->linesize);
+            scaled->pts = av_rescale_q(frame->best_effort_timestamp, inStream->time_base, encCtx->time_base);
+            av_frame_unref(frame);
+            if (avcodec_send_frame(encCtx, scaled) < 0) goto end;
+            if (!writeEncodedPackets(encCtx, outFmtCtx, outStream, pkt)) goto end;
+        }
+        if (flushing && ret == AVERROR_EOF) break;
+    }
+
+    avcodec_send_frame(encCtx, nullptr);
+    if (!writeEncodedPackets(encCtx, outFmtCtx, outStream, pkt)) goto end;
+    success = av_write_trailer(outFmtCtx) >= 0;
+    // Reported as shown, which is what resolve() compares against.
+    if (displayQuarterTurns(inStream) & 1) std::swap(outWidth, outHeight);
+
+end:
+    sws_freeContext(sws);
+    av_frame_free(&scaled);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    if (encCtx) avcodec_free_context(&encCtx);
+    if (outFmtCtx) {
+        if (!(outFmtCtx->oformat->flags & AVFMT_NOFILE)) avio_closep(&outFmtCtx->pb);
+        avformat_free_context(outFmtCtx);
+    }
+    return success;
+}
+
+} // namespace
+
+std::string ProxyManager::proxyPathFor(const std::string& originalPath) {
+    std::string path = stripFileScheme(originalPath);
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) path = path.substr(0, dot);
+    return path + ".proxy.mp4";
+}
+
+std::string ProxyManager::generate(const std::string& originalPath, int maxHeight) {
+    std::string input = stripFileScheme(originalPath);
+    std::string proxyPath = proxyPathFor(input);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!inFlight_.insert(input).second) return "";
+        known_.erase(input);
+    }
+
+    // Transcode under a temporary name so resolve() never sees a partial file.
+    std::string tmpPath = proxyPath + ".tmp.mp4";
+    int width = 0;
+    int height = 0;
+    bool ok = transcodeProxy(input, tmpPath, maxHeight > 0 ? maxHeight : 360, width, height) &&
+              rename(tmpPath.c_str(), proxyPath.c_str()) == 0;
+    if (!ok) {
+        unlink(tmpPath.c_str());
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Proxy generation failed for %s", input.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    inFlight_.erase(input);
+    if (!ok) return "";
+    known_[input] = {width, height};
+    return proxyPath;
+}
+
+std::string ProxyManager::resolve(const std::string& originalPath, int minWidth, int minHeight) {
+    std::string input = stripFileScheme(originalPath);
+    std::string proxyPath = proxyPathFor(input);
+    time_t originalMtime = 0;
+    time_t proxyMtime = 0;
+    if (!fileMtime(proxyPath, proxyMtime) || !fileMtime(input, originalMtime) || proxyMtime < originalMtime) {
+        return originalPath;
+    }
+
+    ProxyInfo info;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (inFlight_.count(input)) return originalPath;
+        auto it = known_.find(input);
+        if (it != known_.end()) info = it->second;
+    }
+    if (info.width == 0) {
+        // Proxy left by an earlier session: probe its size once.
+        if (!probeVideoSize(proxyPath, info.width, info.height, true)) return originalPath;
+        std::lock_guard<std::mutex> lock(mutex_);
+        known_[input] = info;
+    }
+    if (info.width < minWidth || info.height < minHeight) return originalPath;
+    return proxyPath;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace facebook::react {
+
+// Low-resolution editing proxies stored next to their originals as
+// "<name>.proxy.mp4". Preview, scrub and thumbnail paths resolve their input
+// through resolve(); exports keep reading the original.
+class ProxyManager {
+public:
+  static std::string proxyPathFor(const std::string& originalPath);
+
+  // Transcode a short-GOP, B-frame-free proxy no taller than maxHeight.
+  // Blocking; callers run it on a worker thread. Returns the proxy path, or
+  // an empty string on failure.
+  std::string generate(const std::string& originalPath, int maxHeight);
+
+  // The proxy for originalPath if one is complete, newer than the original
+  // and at least minWidth x minHeight as shown; otherwise originalPath
+  // itself.
+  std::string resolve(const std::string& originalPath, int minWidth = 0, int minHeight = 0);
+
+private:
+  struct ProxyInfo {
+    int width = 0;
+    int height = 0;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, ProxyInfo> known_;
+  std::unordered_set<std::string> inFlight_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,356 @@
+#include "ScrubSession.h"
+#include <android/log.h>
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+namespace facebook::react {
+
+namespace {
+
+// About 45 frames at 320x568, i.e. 1.5 s of 30 fps footage either side of
+// the playhead.
+constexpr size_t kDefaultMaxBytes = 32u << 20;
+
+// The window reaches this many times further in the direction of motion
+// than behind the playhead.
+constexpr size_t kAheadWeight = 3;
+
+// Without a keyframe index, targets this far ahead of the last decoded frame
+// decode forward rather than seek (same heuristic as PreviewSession).
+constexpr double kForwardDecodeWindowSec = 1.0;
+
+// A missed request blocks the JS thread for at most one frame interval,
+// kept within these bounds, before falling back to the nearest cached frame.
+constexpr auto kMinMissWait = std::chrono::milliseconds(4);
+constexpr auto kMaxMissWait = std::chrono::milliseconds(33);
+
+} // namespace
+
+std::unique_ptr<ScrubSession> ScrubSession::open(const std::string& sourcePath, int displayWidth, int displayHeight,
+                                                 size_t maxBytes, std::shared_ptr<const KeyframeIndex> keyframes) {
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    if (!probeVideoSize(sourcePath, sourceWidth, sourceHeight, true)) return nullptr;
+    fitTargetSize(sourceWidth, sourceHeight, displayWidth, displayHeight);
+
+    std::unique_ptr<ScrubSession> session(new ScrubSession());
+    session->decoder_ = openVideoDecoder(sourcePath, displayWidth, displayHeight);
+    if (!session->decoder_) return nullptr;
+    AVStream* st = session->decoder_->stream();
+    if (keyframes && keyframes->streamIndex == session->decoder_->streamIndex) session->keyframes_ = std::move(keyframes);
+    session->quarterTurns_ = displayQuarterTurns(st);
+    session->displayWidth_ = displayWidth;
+    session->displayHeight_ = displayHeight;
+    session->frameBytes_ = static_cast<size_t>(displayWidth) * displayHeight * 4;
+    session->maxBytes_ = std::max(maxBytes > 0 ? maxBytes : kDefaultMaxBytes, 2 * session->frameBytes_);
+    session->timeBase_ = st->time_base;
+    session->startPts_ = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+    if (st->avg_frame_rate.num > 0 && st->avg_frame_rate.den > 0) {
+        session->defaultDuration_ = std::max<int64_t>(1, av_rescale_q(1, av_inv_q(st->avg_frame_rate), st->time_base));
+    }
+
+    // The first frame pins the head of the clip and is what an untouched
+    // trim handle shows, so decode it before returning.
+    AVFrame* first = session->decodeNext();
+    if (!first) {
+        __android_log_print(ANDROID_LOG_ERROR, "FFmpegModule", "Scrub session: no frames in %s", sourcePath.c_str());
+        return nullptr;
+    }
+    std::vector<uint8_t> rgba;
+    bool converted = session->convert(first, rgba);
+    int64_t firstPts = first->pts;
+    int64_t firstDuration = first->duration > 0 ? first->duration : session->defaultDuration_;
+    av_frame_free(&first);
+    if (!converted) return nullptr;
+    session->lastDecodedPts_ = firstPts;
+    session->headPts_ = firstPts;
+    session->playhead_ = firstPts;
+    session->insertLocked(firstPts, firstDuration, AV_NOPTS_VALUE, std::move(rgba));
+
+    session->worker_ = std::thread([s = session.get()] { s->run(); });
+    return session;
+}
+
+ScrubSession::~ScrubSession() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    sws_freeContext(sws_);
+}
+
+AVFrame* ScrubSession::decodeNext() {
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    for (;;) {
+        int ret = avcodec_receive_frame(decoder_->decCtx, frame);
+        if (ret == 0) {
+            frame->pts = frame->best_effort_timestamp;
+            break;
+        }
+        if (ret != AVERROR(EAGAIN) || decoderEof_) {
+            av_frame_free(&frame);
+            break;
+        }
+        if (av_read_frame(decoder_->fmtCtx, pkt) < 0) {
+            decoderEof_ = true;
+            avcodec_send_packet(decoder_->decCtx, nullptr);
+            continue;
+        }
+        if (pkt->stream_index == decoder_->streamIndex) avcodec_send_packet(decoder_->decCtx, pkt);
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    return frame;
+}
+
+bool ScrubSession::convert(const AVFrame* frame, std::vector<uint8_t>& rgba) {
+    // Turned frames are scaled to the turned size, then turned upright.
+    bool turned = quarterTurns_ & 1;
+    int width = turned ? displayHeight_ : displayWidth_;
+    int height = turned ? displayWidth_ : displayHeight_;
+    sws_ = sws_getCachedContext(sws_, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                width, height, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_) return false;
+    rgba.resize(frameBytes_);
+    std::vector<uint8_t>& scaled = quarterTurns_ ? unturned_ : rgba;
+    if (quarterTurns_) unturned_.resize(frameBytes_);
+    uint8_t* dst[4] = {scaled.data(), nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {width * 4, 0, 0, 0};
+    if (sws_scale(sws_, frame->data, frame->linesize, 0, frame->height, dst, dstLinesize) <= 0) return false;
+    if (quarterTurns_) rotateImage(scaled.data(), width * 4, width, height, 4, quarterTurns_, rgba.data(), displayWidth_ * 4);
+    return true;
+}
+
+bool ScrubSession::positionedFor(int64_t want) const {
+    if (decoderEof_) return false;
+    if (lastDecodedPts_ == AV_NOPTS_VALUE) return want == seekedFor_;
+    if (lastDecodedPts_ > want) return false;
+    // Decoding on beats seeking as long as no keyframe lies in between.
+    if (keyframes_) {
+        const KeyframeEntry* keyframe = keyframes_->atOrBefore(want);
+        if (keyframe) return keyframe->pts <= lastDecodedPts_;
+    }
+    return (want - lastDecodedPts_) * av_q2d(timeBase_) < kForwardDecodeWindowSec;
+}
+
+void ScrubSession::seekFor(int64_t want) {
+    const KeyframeEntry* keyframe = keyframes_ ? keyframes_->atOrBefore(want) : nullptr;
+    if (!keyframe || !seekToKeyframe(decoder_->fmtCtx, *keyframes_, *keyframe)) {
+        av_seek_frame(decoder_->fmtCtx, decoder_->streamIndex, want, AVSEEK_FLAG_BACKWARD);
+    }
+    avcodec_flush_buffers(decoder_->decCtx);
+    decoderEof_ = false;
+    lastDecodedPts_ = AV_NOPTS_VALUE;
+}
+
+int64_t ScrubSession::clampLocked(int64_t pts) const {
+    pts = std::max(pts, headPts_);
+    if (lastFramePts_ != AV_NOPTS_VALUE) pts = std::min(pts, lastFramePts_);
+    return pts;
+}
+
+ScrubSession::Cache::const_iterator ScrubSession::findCoveringLocked(int64_t pts) const {
+    auto it = cache_.upper_bound(pts);
+    if (it == cache_.begin()) return cache_.end();
+    --it;
+    int64_t end = it->second.nextPts != AV_NOPTS_VALUE ? it->second.nextPts : it->first + it->second.duration;
+    return pts < end ? it : cache_.end();
+}
+
+ScrubSession::Cache::const_iterator ScrubSession::findNearestLocked(int64_t pts) const {
+    auto after = cache_.lower_bound(pts);
+    if (after == cache_.begin()) return after;
+    auto before = std::prev(after);
+    if (after == cache_.end()) return before;
+    return pts - before->first <= after->first - pts ? before : after;
+}
+
+int64_t ScrubSession::nextWantedLocked() const {
+    if (stalledGeneration_ == generation_) return AV_NOPTS_VALUE;
+    int64_t target = clampLocked(playhead_);
+    auto covering = findCoveringLocked(target);
+    if (covering == cache_.end()) return target;
+
+    // Split the frame budget (minus the frame on screen) between the two
+    // sides of the playhead, favouring the direction of motion.
+    size_t budget = maxBytes_ / frameBytes_ - 1;
+    size_t aheadBudget = budget * kAheadWeight / (kAheadWeight + 1);
+    size_t behindBudget = budget - aheadBudget;
+
+    // Follow linked frames outwards; the first gap is the next frame to decode.
+    auto extendForward = [&](size_t limit) -> int64_t {
+        auto it = covering;
+        for (size_t count = 0; count < limit; ++count) {
+            int64_t next = it->second.nextPts;
+            if (next == AV_NOPTS_VALUE) return it->first + 1;
+            if (next == eofPts_) return AV_NOPTS_VALUE;
+            auto found = cache_.find(next);
+            if (found == cache_.end()) return next;
+            it = found;
+        }
+        return AV_NOPTS_VALUE;
+    };
+    auto extendBackward = [&](size_t limit) -> int64_t {
+        auto it = covering;
+        for (size_t count = 0; count < limit; ++count) {
+            if (it->first <= headPts_) return AV_NOPTS_VALUE;
+            if (it == cache_.begin() || std::prev(it)->second.nextPts != it->first) return it->first - 1;
+            --it;
+        }
+        return AV_NOPTS_VALUE;
+    };
+
+    int64_t want = direction_ >= 0 ? extendForward(aheadBudget) : extendBackward(aheadBudget);
+    if (want == AV_NOPTS_VALUE) want = direction_ >= 0 ? extendBackward(behindBudget) : extendForward(behindBudget);
+    return want;
+}
+
+void ScrubSession::insertLocked(int64_t pts, int64_t duration, int64_t previousPts, std::vector<uint8_t>&& rgba) {
+    if (!rgba.empty() && cache_.find(pts) == cache_.end()) {
+        CachedFrame& frame = cache_[pts];
+        frame.duration = duration;
+        frame.rgba = std::move(rgba);
+        cachedBytes_ += frame.rgba.size();
+        insertedSinceSeek_++;
+    }
+    if (previousPts != AV_NOPTS_VALUE) {
+        auto previous = cache_.find(previousPts);
+        if (previous != cache_.end() && previous->second.nextPts != pts) {
+            previous->second.nextPts = pts;
+            insertedSinceSeek_++;
+        }
+    }
+    evictLocked();
+}
+
+void ScrubSession::evictLocked() {
+    // The window is a ring around the playhead: drop whichever end is
+    // furthest away, counting distance behind the direction of motion as
+    // kAheadWeight times as far.
+    while (cachedBytes_ > maxBytes_ && cache_.size() > 1) {
+        auto front = cache_.begin();
+        auto back = std::prev(cache_.end());
+        int64_t frontDistance = std::max<int64_t>(0, playhead_ - front->first);
+        int64_t backDistance = std::max<int64_t>(0, back->first - playhead_);
+        if (direction_ >= 0) {
+            frontDistance *= kAheadWeight;
+        } else {
+            backDistance *= kAheadWeight;
+        }
+        auto victim = frontDistance >= backDistance ? front : back;
+        cachedBytes_ -= victim->second.rgba.size();
+        cache_.erase(victim);
+    }
+}
+
+void ScrubSession::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        int64_t want = nextWantedLocked();
+        if (want == AV_NOPTS_VALUE) {
+            uint64_t seen = generation_;
+            cv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            continue;
+        }
+        uint64_t generation = generation_;
+        bool reseek = !positionedFor(want);
+        if (reseek) {
+            if (want == seekedFor_ && insertedSinceSeek_ == 0) {
+                // Seeking again for the same frame made no progress; wait for
+                // the playhead to move instead of spinning.
+                stalledGeneration_ = generation;
+                cv_.notify_all();
+                continue;
+            }
+            seekedFor_ = want;
+            insertedSinceSeek_ = 0;
+            stats_.seeks++;
+        }
+        lock.unlock();
+
+        if (reseek) seekFor(want);
+        int64_t previousPts = lastDecodedPts_;
+        AVFrame* frame = decodeNext();
+        int64_t pts = AV_NOPTS_VALUE;
+        int64_t duration = defaultDuration_;
+        std::vector<uint8_t> rgba;
+        if (frame) {
+            pts = frame->pts;
+            if (frame->duration > 0) duration = frame->duration;
+            lastDecodedPts_ = pts;
+            bool cached;
+            {
+                std::lock_guard<std::mutex> check(mutex_);
+                cached = cache_.find(pts) != cache_.end();
+            }
+            if (!cached && !convert(frame, rgba)) rgba.clear();
+            av_frame_free(&frame);
+        }
+
+        lock.lock();
+        if (pts == AV_NOPTS_VALUE) {
+            if (decoderEof_ && previousPts != AV_NOPTS_VALUE) {
+                // The last frame out of the decoder is the last one shown.
+                lastFramePts_ = previousPts;
+                auto last = cache_.find(previousPts);
+                eofPts_ = previousPts + (last != cache_.end() ? last->second.duration : defaultDuration_);
+                if (last != cache_.end()) last->second.nextPts = eofPts_;
+            } else {
+                stalledGeneration_ = generation;
+            }
+            cv_.notify_all();
+            continue;
+        }
+        stats_.decodedFrames++;
+        insertLocked(pts, duration, previousPts, std::move(rgba));
+        cv_.notify_all();
+    }
+}
+
+bool ScrubSession::frameAt(double timeSec, std::vector<uint8_t>& rgba, double& shownAtSec, bool& hit) {
+    int64_t target = startPts_ + av_rescale_q(static_cast<int64_t>(std::max(0.0, timeSec) * AV_TIME_BASE), AV_TIME_BASE_Q, timeBase_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.requests++;
+    if (target != playhead_) direction_ = target > playhead_ ? 1 : -1;
+    playhead_ = target;
+    generation_++;
+    cv_.notify_all();
+
+    auto it = findCoveringLocked(clampLocked(target));
+    hit = it != cache_.end();
+    if (hit) {
+        stats_.hits++;
+    } else {
+        auto frameInterval = std::chrono::microseconds(av_rescale_q(defaultDuration_, timeBase_, AV_TIME_BASE_Q));
+        auto wait = std::clamp<std::chrono::microseconds>(frameInterval, kMinMissWait, kMaxMissWait);
+        uint64_t generation = generation_;
+        cv_.wait_for(lock, wait, [&] {
+            it = findCoveringLocked(clampLocked(target));
+            return it != cache_.end() || stalledGeneration_ == generation || stopping_;
+        });
+        // Still decoding: show the closest frame we have and let the caller
+        // ask again; the background thread keeps working towards target.
+        if (it == cache_.end()) it = findNearestLocked(clampLocked(target));
+        if (it == cache_.end()) return false;
+    }
+    rgba = it->second.rgba;
+    shownAtSec = (it->first - startPts_) * av_q2d(timeBase_);
+    return true;
+}
+
+ScrubStats ScrubSession::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ScrubStats stats = stats_;
+    stats.cachedFrames = cache_.size();
+    stats.cachedBytes = cachedBytes_;
+    return stats;
+}
+
+} // namespace facebook::react
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "FrameExtractor.h"
+#include "KeyframeIndex.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SwsContext;
+
+namespace facebook::react {
+
+struct ScrubStats {
+  uint64_t requests = 0;
+  uint64_t hits = 0;
+  uint64_t decodedFrames = 0;
+  uint64_t seeks = 0;
+  size_t cachedFrames = 0;
+  size_t cachedBytes = 0;
+};
+
+// Serves frames for a trim handle or scrubber being dragged. A background
+// thread decodes frames, downscales them to display size as RGBA (turned
+// upright by the source's display matrix) and keeps them in a byte-capped
+// window around the playhead that reaches further in the direction the
+// playhead last moved. Cached frames are answered with a copy and no
+// decoding.
+class ScrubSession {
+public:
+  // displayWidth/displayHeight of 0 keep the aspect ratio; maxBytes of 0
+  // uses a default sized for a phone.
+  static std::unique_ptr<ScrubSession> open(const std::string& sourcePath, int displayWidth, int displayHeight,
+                                            size_t maxBytes, std::shared_ptr<const KeyframeIndex> keyframes = nullptr);
+  ~ScrubSession();
+
+  // Move the playhead to timeSec and copy out the frame shown there as
+  // tightly packed RGBA. On a miss this waits at most about one frame
+  // interval for the background thread, then copies out the nearest cached
+  // frame instead (shownAtSec says which); `hit` says whether the requested
+  // frame was already cached. Returns false only while nothing is cached.
+  bool frameAt(double timeSec, std::vector<uint8_t>& rgba, double& shownAtSec, bool& hit);
+
+  ScrubStats stats();
+  int width() const { return displayWidth_; }
+  int height() const { return displayHeight_; }
+
+private:
+  struct CachedFrame {
+    int64_t duration = 1;
+    // pts of the frame decoded right after this one (AV_NOPTS_VALUE if not
+    // known yet). Runs of linked frames are what the window is made of.
+    int64_t nextPts = AV_NOPTS_VALUE;
+    std::vector<uint8_t> rgba;
+  };
+  using Cache = std::map<int64_t, CachedFrame>;
+
+  ScrubSession() = default;
+
+  // Background thread.
+  void run();
+  AVFrame* decodeNext();
+  bool positionedFor(int64_t want) const;
+  void seekFor(int64_t want);
+  bool convert(const AVFrame* frame, std::vector<uint8_t>& rgba);
+
+  // Require mutex_.
+  int64_t clampLocked(int64_t pts) const;
+  Cache::const_iterator findCoveringLocked(int64_t pts) const;
+  Cache::const_iterator findNearestLocked(int64_t pts) const;
+  int64_t nextWantedLocked() const;
+  void insertLocked(int64_t pts, int64_t duration, int64_t previousPts, std::vector<uint8_t>&& rgba);
+  void evictLocked();
+
+  // Owned by the background thread once it is running.
+  std::unique_ptr<VideoDecoder> decoder_;
+  std::shared_ptr<const KeyframeIndex> keyframes_;
+  SwsContext* sws_ = nullptr;
+  int quarterTurns_ = 0;
+  // Scaled frame before it is turned upright.
+  std::vector<uint8_t> unturned_;
+  int64_t lastDecodedPts_ = AV_NOPTS_VALUE;
+  int64_t seekedFor_ = AV_NOPTS_VALUE;
+  bool decoderEof_ = false;
+
+  int displayWidth_ = 0;
+  int displayHeight_ = 0;
+  size_t frameBytes_ = 0;
+  size_t maxBytes_ = 0;
+  AVRational timeBase_{1, 1};
+  int64_t startPts_ = 0;
+  int64_t defaultDuration_ = 1;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  Cache cache_;
+  size_t cachedBytes_ = 0;
+  int64_t playhead_ = 0;
+  int direction_ = 1;
+  uint64_t generation_ = 0;
+  uint64_t stalledGeneration_ = UINT64_MAX;
+  int64_t headPts_ = 0;
+  int64_t lastFramePts_ = AV_NOPTS_VALUE;
+  int64_t eofPts_ = AV_NOPTS_VALUE;
+  uint64_t insertedSinceSeek_ = 0;
+  ScrubStats stats_;
+  bool stopping_ = false;
+
+  std::thread worker_;
+};
+
+} // namespace facebook::react
@@ -0,0 +1,425 @@
+#include "SimdKernels.h"
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define STORYX_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define STORYX_SSE2 1
+#endif
+
+namespace facebook::react {
+
+void reducePeaks(const float* samples, size_t count, float& min, float& max, double& sumSq) {
+    size_t i = 0;
+    float lo = min;
+    float hi = max;
+    double acc = 0;
+#if defined(STORYX_NEON)
+    if (count >= 4) {
+        float32x4_t vmin = vdupq_n_f32(lo);
+        float32x4_t vmax = vdupq_n_f32(hi);
+        float32x4_t vsum = vdupq_n_f32(0.0f);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t v = vld1q_f32(samples + i);
+            vmin = vminq_f32(vmin, v);
+            vmax = vmaxq_f32(vmax, v);
+            vsum = vmlaq_f32(vsum, v, v);
+        }
+        float lanes[4];
+        vst1q_f32(lanes, vmin);
+        lo = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        vst1q_f32(lanes, vmax);
+        hi = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        vst1q_f32(lanes, vsum);
+        acc = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#elif defined(STORYX_SSE2)
+    if (count >= 4) {
+        __m128 vmin = _mm_set1_ps(lo);
+        __m128 vmax = _mm_set1_ps(hi);
+        __m128 vsum = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(samples + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+            vsum = _mm_add_ps(vsum, _mm_mul_ps(v, v));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, vmin);
+        lo = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        _mm_storeu_ps(lanes, vmax);
+        hi = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        _mm_storeu_ps(lanes, vsum);
+        acc = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i < count; ++i) {
+        float v = samples[i];
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+        acc += static_cast<double>(v) * v;
+    }
+    min = lo;
+    max = hi;
+    sumSq += acc;
+}
+
+void decimatePlane(const uint8_t* src, int linesize, int width, int height, int step, uint8_t* dst) {
+    int dstWidth = width / step;
+    int dstHeight = height / step;
+    for (int y = 0; y < dstHeight; ++y) {
+        const uint8_t* row = src + static_cast<size_t>(y) * step * linesize;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth;
+        int x = 0;
+#if defined(STORYX_NEON)
+        // De-interleaving loads pick every 2nd/4th byte without a gather.
+        if (step == 4) {
+            for (; x + 16 <= dstWidth; x += 16) vst1q_u8(out + x, vld4q_u8(row + x * 4).val[0]);
+        } else if (step == 2) {
+            for (; x + 16 <= dstWidth; x += 16) vst1q_u8(out + x, vld2q_u8(row + x * 2).val[0]);
+        }
+#elif defined(STORYX_SSE2)
+        // Mask every 2nd/4th byte into the low byte of its lane, then pack
+        // the lanes down to bytes.
+        if (step == 4) {
+            const __m128i mask = _mm_set1_epi32(0xff);
+            for (; x + 16 <= dstWidth; x += 16) {
+                const __m128i* p = reinterpret_cast<const __m128i*>(row + x * 4);
+                __m128i lo = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(p), mask), _mm_and_si128(_mm_loadu_si128(p + 1), mask));
+                __m128i hi = _mm_packs_epi32(_mm_and_si128(_mm_loadu_si128(p + 2), mask), _mm_and_si128(_mm_loadu_si128(p + 3), mask));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+            }
+        } else if (step == 2) {
+            const __m128i mask = _mm_set1_epi16(0xff);
+            for (; x + 16 <= dstWidth; x += 16) {
+                const __m128i* p = reinterpret_cast<const __m128i*>(row + x * 2);
+                __m128i v = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128(p), mask), _mm_and_si128(_mm_loadu_si128(p + 1), mask));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), v);
+            }
+        }
+#endif
+        for (; x < dstWidth; ++x) out[x] = row[x * step];
+    }
+}
+
+uint64_t sumAbsDiff(const uint8_t* a, const uint8_t* b, size_t count) {
+    size_t i = 0;
+    uint64_t total = 0;
+#if defined(STORYX_NEON)
+    while (i + 16 <= count) {
+        // Pairwise-accumulate into 16-bit lanes; flush to 64-bit well before
+        // they can overflow (255 * 2 * 128 < 65536).
+        uint16x8_t acc = vdupq_n_u16(0);
+        size_t blockEnd = std::min(count, i + 16 * 128);
+        for (; i + 16 <= blockEnd; i += 16) {
+            acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+        }
+        uint64x2_t wide = vpaddlq_u32(vpaddlq_u16(acc));
+        total += vgetq_lane_u64(wide, 0) + vgetq_lane_u64(wide, 1);
+    }
+#elif defined(STORYX_SSE2)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < count; ++i) total += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return total;
+}
+
+void sumAndSquares(const uint8_t* samples, size_t count, uint64_t& sum, uint64_t& sumSq) {
+    size_t i = 0;
+    uint64_t total = 0;
+    uint64_t squares = 0;
+#if defined(STORYX_NEON)
+    while (i + 16 <= count) {
+        // Same 128-vector blocks as sumAbsDiff keep the 16-bit sum lanes and
+        // the 32-bit square lanes (2 * 2 * 255^2 per vector) from overflowing.
+        uint16x8_t accSum = vdupq_n_u16(0);
+        uint32x4_t accSq = vdupq_n_u32(0);
+        size_t blockEnd = std::min(count, i + 16 * 128);
+        for (; i + 16 <= blockEnd; i += 16) {
+            uint8x16_t v = vld1q_u8(samples + i);
+            accSum = vpadalq_u8(accSum, v);
+            accSq = vpadalq_u16(accSq, vmull_u8(vget_low_u8(v), vget_low_u8(v)));
+            accSq = vpadalq_u16(accSq, vmull_u8(vget_high_u8(v), vget_high_u8(v)));
+        }
+        uint64x2_t wideSum = vpaddlq_u32(vpaddlq_u16(accSum));
+        uint64x2_t wideSq = vpaddlq_u32(accSq);
+        total += vgetq_lane_u64(wideSum, 0) + vgetq_lane_u64(wideSum, 1);
+        squares += vgetq_lane_u64(wideSq, 0) + vgetq_lane_u64(wideSq, 1);
+    }
+#elif defined(STORYX_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i accSum = _mm_setzero_si128();
+    while (i + 16 <= count) {
+        __m128i accSq = _mm_setzero_si128();
+        size_t blockEnd = std::min(count, i + 16 * 128);
+        for (; i + 16 <= blockEnd; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+            accSum = _mm_add_epi64(accSum, _mm_sad_epu8(v, zero));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            accSq = _mm_add_epi32(accSq, _mm_madd_epi16(lo, lo));
+            accSq = _mm_add_epi32(accSq, _mm_madd_epi16(hi, hi));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), accSq);
+        squares += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+    uint64_t sums[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), accSum);
+    total = sums[0] + sums[1];
+#endif
+    for (; i < count; ++i) {
+        total += samples[i];
+        squares += static_cast<uint64_t>(samples[i]) * samples[i];
+    }
+    sum += total;
+    sumSq += squares;
+}
+
+void histogram64(const uint8_t* samples, size_t count, uint32_t hist[64]) {
+    // Scatter doesn't vectorize; four sub-histograms break the store-to-load
+    // dependency when neighbouring pixels fall in the same bin. The bins are
+    // worked out 16 samples at a time.
+    uint32_t sub[4][64] = {};
+    size_t i = 0;
+#if defined(STORYX_NEON) || defined(STORYX_SSE2)
+    alignas(16) uint8_t bins[16];
+#if defined(STORYX_NEON)
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(bins, vshrq_n_u8(vld1q_u8(samples + i), 2));
+#else
+    // No byte shifts: shift 16-bit lanes and drop what crossed into the low
+    // byte from the high one.
+    const __m128i mask = _mm_set1_epi8(0x3f);
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        _mm_store_si128(reinterpret_cast<__m128i*>(bins), _mm_and_si128(_mm_srli_epi16(v, 2), mask));
+#endif
+        for (int k = 0; k < 16; k += 4) {
+            sub[0][bins[k]]++;
+            sub[1][bins[k + 1]]++;
+            sub[2][bins[k + 2]]++;
+            sub[3][bins[k + 3]]++;
+        }
+    }
+#endif
+    for (; i + 4 <= count; i += 4) {
+        sub[0][samples[i] >> 2]++;
+        sub[1][samples[i + 1] >> 2]++;
+        sub[2][samples[i + 2] >> 2]++;
+        sub[3][samples[i + 3] >> 2]++;
+    }
+    for (; i < count; ++i) sub[0][samples[i] >> 2]++;
+    for (int b = 0; b < 64; ++b) hist[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+}
+
+void ditherOrderedRow(const uint8_t* rgba, int width, const uint8_t bias[8], const uint8_t* lut, uint8_t* dst) {
+    // The cell arithmetic vectorizes; the palette lookup is a gather and
+    // stays scalar.
+    int x = 0;
+#if defined(STORYX_NEON)
+    uint8x8_t half = vld1_u8(bias);
+    uint8x16_t vbias = vcombine_u8(half, half);
+    uint16_t cells[16];
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(rgba + x * 4);
+        uint8x16_t r = vshrq_n_u8(vqaddq_u8(px.val[0], vbias), 3);
+        uint8x16_t g = vshrq_n_u8(vqaddq_u8(px.val[1], vbias), 3);
+        uint8x16_t b = vshrq_n_u8(vqaddq_u8(px.val[2], vbias), 3);
+        uint16x8_t lo = vorrq_u16(vorrq_u16(vshlq_n_u16(vmovl_u8(vget_low_u8(r)), 10), vshlq_n_u16(vmovl_u8(vget_low_u8(g)), 5)),
+                                  vmovl_u8(vget_low_u8(b)));
+        uint16x8_t hi = vorrq_u16(vorrq_u16(vshlq_n_u16(vmovl_u8(vget_high_u8(r)), 10), vshlq_n_u16(vmovl_u8(vget_high_u8(g)), 5)),
+                                  vmovl_u8(vget_high_u8(b)));
+        vst1q_u16(cells, lo);
+        vst1q_u16(cells + 8, hi);
+        for (int i = 0; i < 16; ++i) dst[x + i] = lut[cells[i]];
+    }
+#elif defined(STORYX_SSE2)
+    // Four pixels per register; the bias pattern alternates between the two
+    // halves of the 8-wide row.
+    __m128i vbias[2];
+    for (int k = 0; k < 2; ++k) {
+        const uint8_t* b = bias + k * 4;
+        vbias[k] = _mm_setr_epi8(b[0], b[0], b[0], 0, b[1], b[1], b[1], 0, b[2], b[2], b[2], 0, b[3], b[3], b[3], 0);
+    }
+    const __m128i mask5 = _mm_set1_epi8(0x1f);
+    const __m128i mask8 = _mm_set1_epi32(0xff);
+    alignas(16) uint32_t cells[4];
+    for (; x + 4 <= width; x += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x * 4));
+        __m128i v = _mm_and_si128(_mm_srli_epi16(_mm_adds_epu8(px, vbias[(x >> 2) & 1]), 3), mask5);
+        __m128i r = _mm_slli_epi32(_mm_and_si128(v, mask8), 10);
+        __m128i g = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 8), mask8), 5);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask8);
+        _mm_store_si128(reinterpret_cast<__m128i*>(cells), _mm_or_si128(_mm_or_si128(r, g), b));
+        for (int i = 0; i < 4; ++i) dst[x + i] = lut[cells[i]];
+    }
+#endif
+    for (; x < width; ++x) {
+        const uint8_t* p = rgba + x * 4;
+        int d = bias[x & 7];
+        int r = std::min(255, p[0] + d) >> 3;
+        int g = std::min(255, p[1] + d) >> 3;
+        int b = std::min(255, p[2] + d) >> 3;
+        dst[x] = lut[(r << 10) | (g << 5) | b];
+    }
+}
+
+void blendBytes(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t count, uint32_t weight) {
+    weight = std::min(weight, 256u);
+    size_t i = 0;
+#if defined(STORYX_NEON)
+    // 255 * 256 still fits the 16-bit lanes; vrshrn adds the rounding.
+    const uint16x8_t wa = vdupq_n_u16(static_cast<uint16_t>(256 - weight));
+    const uint16x8_t wb = vdupq_n_u16(static_cast<uint16_t>(weight));
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint16x8_t lo = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(va)), wa), vmovl_u8(vget_low_u8(vb)), wb);
+        uint16x8_t hi = vmlaq_u16(vmulq_u16(vmovl_u8(vget_high_u8(va)), wa), vmovl_u8(vget_high_u8(vb)), wb);
+        vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+#elif defined(STORYX_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16(static_cast<short>(256 - weight));
+    const __m128i wb = _mm_set1_epi16(static_cast<short>(weight));
+    const __m128i round = _mm_set1_epi16(128);
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        // Unsigned sums up to 65408: the 16-bit adds wrap as unsigned and the
+        // logical shift reads them back correctly.
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa), _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa), _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; ++i) dst[i] = static_cast<uint8_t>((a[i] * (256 - weight) + b[i] * weight + 128) >> 8);
+}
+
+void mixWithGainRamp(float* dst, const float* src, size_t count, float gainStart, float gainEnd) {
+    if (count == 0) return;
+    float step = (gainEnd - gainStart) / static_cast<float>(count);
+    size_t i = 0;
+#if defined(STORYX_NEON)
+    if (count >= 4) {
+        const float32x4_t lo = vdupq_n_f32(-1.0f);
+        const float32x4_t hi = vdupq_n_f32(1.0f);
+        const float32x4_t step4 = vdupq_n_f32(4.0f * step);
+        const float offsets[4] = {0.0f, step, 2.0f * step, 3.0f * step};
+        float32x4_t gain = vaddq_f32(vdupq_n_f32(gainStart), vld1q_f32(offsets));
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t mixed = vmlaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain);
+            vst1q_f32(dst + i, vminq_f32(vmaxq_f32(mixed, lo), hi));
+            gain = vaddq_f32(gain, step4);
+        }
+    }
+#elif defined(STORYX_SSE2)
+    if (count >= 4) {
+        const __m128 lo = _mm_set1_ps(-1.0f);
+        const __m128 hi = _mm_set1_ps(1.0f);
+        const __m128 step4 = _mm_set1_ps(4.0f * step);
+        __m128 gain = _mm_add_ps(_mm_set1_ps(gainStart), _mm_setr_ps(0.0f, step, 2.0f * step, 3.0f * step));
+        for (; i + 4 <= count; i += 4) {
+            __m128 mixed = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), gain));
+            _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(mixed, lo), hi));
+            gain = _mm_add_ps(gain, step4);
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        float gain = gainStart + step * static_cast<float>(i);
+        dst[i] = std::min(1.0f, std::max(-1.0f, dst[i] + src[i] * gain));
+    }
+}
+
+void biquadCascadeStereo(const float* samples, size_t frames, const double coeffs[10], double state[8], double sumSq[2]) {
+#if defined(STORYX_NEON) && defined(__aarch64__)
+    // Double-precision vectors are AArch64 only; 32-bit ARM takes the scalar
+    // path below.
+    float64x2_t b[2][3], a[2][2], s1[2], s2[2];
+    for (int k = 0; k < 2; ++k) {
+        for (int j = 0; j < 3; ++j) b[k][j] = vdupq_n_f64(coeffs[k * 5 + j]);
+        a[k][0] = vdupq_n_f64(coeffs[k * 5 + 3]);
+        a[k][1] = vdupq_n_f64(coeffs[k * 5 + 4]);
+        s1[k] = vld1q_f64(state + k * 4);
+        s2[k] = vld1q_f64(state + k * 4 + 2);
+    }
+    float64x2_t acc = vdupq_n_f64(0.0);
+    for (size_t i = 0; i < frames; ++i) {
+        float64x2_t x = vcvt_f64_f32(vld1_f32(samples + i * 2));
+        for (int k = 0; k < 2; ++k) {
+            float64x2_t y = vfmaq_f64(s1[k], b[k][0], x);
+            s1[k] = vfmsq_f64(vfmaq_f64(s2[k], b[k][1], x), a[k][0], y);
+            s2[k] = vfmsq_f64(vmulq_f64(b[k][2], x), a[k][1], y);
+            x = y;
+        }
+        acc = vfmaq_f64(acc, x, x);
+    }
+    for (int k = 0; k < 2; ++k) {
+        vst1q_f64(state + k * 4, s1[k]);
+        vst1q_f64(state + k * 4 + 2, s2[k]);
+    }
+    sumSq[0] += vgetq_lane_f64(acc, 0);
+    sumSq[1] += vgetq_lane_f64(acc, 1);
+#elif defined(STORYX_SSE2)
+    __m128d b[2][3], a[2][2], s1[2], s2[2];
+    for (int k = 0; k < 2; ++k) {
+        for (int j = 0; j < 3; ++j) b[k][j] = _mm_set1_pd(coeffs[k * 5 + j]);
+        a[k][0] = _mm_set1_pd(coeffs[k * 5 + 3]);
+        a[k][1] = _mm_set1_pd(coeffs[k * 5 + 4]);
+        s1[k] = _mm_loadu_pd(state + k * 4);
+        s2[k] = _mm_loadu_pd(state + k * 4 + 2);
+    }
+    __m128d acc = _mm_setzero_pd();
+    for (size_t i = 0; i < frames; ++i) {
+        __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i * 2))));
+        for (int k = 0; k < 2; ++k) {
+            __m128d y = _mm_add_pd(s1[k], _mm_mul_pd(b[k][0], x));
+            s1[k] = _mm_sub_pd(_mm_add_pd(s2[k], _mm_mul_pd(b[k][1], x)), _mm_mul_pd(a[k][0], y));
+            s2[k] = _mm_sub_pd(_mm_mul_pd(b[k][2], x), _mm_mul_pd(a[k][1], y));
+            x = y;
+        }
+        acc = _mm_add_pd(acc, _mm_mul_pd(x, x));
+    }
+    for (int k = 0; k < 2; ++k) {
+        _mm_storeu_pd(state + k * 4, s1[k]);
+        _mm_storeu_pd(state + k * 4 + 2, s2[k]);
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    sumSq[0] += lanes[0];
+    sumSq[1] += lanes[1];
+#else
+    for (int c = 0; c < 2; ++c) {
+        double acc = 0;
+        for (size_t i = 0; i < frames; ++i) {
+            double x = samples[i * 2 + c];
+            for (int k = 0; k < 2; ++k) {
+                const double* q = coeffs + k * 5;
+                double* s = state + k * 4;
+                double y = s[c] + q[0] * x;
+                s[c] = s[2 + c] + q[1] * x - q[3] * y;
+                s[2 + c] = q[2] * x - q[4] * y;
+                x = y;
+            }
+            acc += x * x;
+        }
+        sumSq[c] += acc;
+    }
+#endif
+}
+
+} // namespace facebook::react
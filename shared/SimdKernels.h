@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace facebook::react {
+
+// Hot inner loops of the analysis passes. Kernels have a NEON path (arm64-v8a
+// and armeabi-v7a, except where noted), an SSE2 path (x86 emulator images)
+// and a scalar fallback; results match to within float rounding.
+
+// Running min/max and sum of squares over `count` samples. min/max/sumSq are
+// accumulated into, so a bucket can be reduced across several calls.
+void reducePeaks(const float* samples, size_t count, float& min, float& max, double& sumSq);
+
+// Point-sample every `step`-th pixel of every `step`-th row of an 8-bit plane
+// into dst (dstWidth = width / step, dstHeight = height / step, packed).
+void decimatePlane(const uint8_t* src, int linesize, int width, int height, int step, uint8_t* dst);
+
+// Sum of absolute differences between two equally sized byte buffers.
+uint64_t sumAbsDiff(const uint8_t* a, const uint8_t* b, size_t count);
+
+// Sum and sum of squares of 8-bit samples (mean/variance of a plane),
+// accumulated into sum/sumSq.
+void sumAndSquares(const uint8_t* samples, size_t count, uint64_t& sum, uint64_t& sumSq);
+
+// 64-bin histogram of 8-bit samples (value >> 2), accumulated into hist.
+void histogram64(const uint8_t* samples, size_t count, uint32_t hist[64]);
+
+// Ordered dithering of one row of RGBA pixels to palette indices. Each
+// channel gets bias[x & 7] (0..7) added with saturation and is cut to 5 bits;
+// lut maps the resulting RGB555 cell (r << 10 | g << 5 | b) to an index.
+void ditherOrderedRow(const uint8_t* rgba, int width, const uint8_t bias[8], const uint8_t* lut, uint8_t* dst);
+
+// dst[i] = (a[i] * (256 - weight) + b[i] * weight + 128) >> 8: weight 0..256
+// takes dst from a to b. Blends 8-bit planes for video transitions.
+void blendBytes(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t count, uint32_t weight);
+
+// dst[i] = clamp(dst[i] + src[i] * gain_i, -1, 1) where the gain moves
+// linearly from gainStart (i = 0) towards gainEnd (i = count). For
+// interleaved audio the ramp runs over samples, not frames; the difference
+// between channels of one frame is negligible.
+void mixWithGainRamp(float* dst, const float* src, size_t count, float gainStart, float gainEnd);
+
+// Two cascaded biquads over interleaved stereo, both channels at once in
+// double precision (transposed direct form II), adding each channel's sum of
+// squared output to sumSq[0..1]. coeffs is {b0, b1, b2, a1, a2} for the first
+// stage then the second; state carries {s1, s2} per stage and channel across
+// calls, laid out {s1 L, s1 R, s2 L, s2 R} per stage. Used for K-weighting.
+// The NEON path needs AArch64; armeabi-v7a runs the scalar one.
+void biquadCascadeStereo(const float* samples, size_t frames, const double coeffs[10], double state[8], double sumSq[2]);
+
+} // namespace facebook::react
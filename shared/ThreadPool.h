@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace facebook::react {
+
+// Fixed-size worker pool shared by the native media APIs. Tasks run in FIFO
+// order; the destructor drains the queue before joining the workers.
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threadCount) {
+    if (threadCount == 0) threadCount = 1;
+    workers_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+      workers_.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      if (worker.joinable()) worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return workers_.size(); }
+
+  void enqueue(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+  // Like enqueue(), but hands back a future for the task's result so callers
+  // can fan work out and join on it.
+  template <typename F>
+  auto submit(F&& fn) -> std::future<std::invoke_result_t<F>> {
+    using Result = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+    std::future<Result> future = task->get_future();
+    enqueue([task] { (*task)(); });
+    return future;
+  }
+
+  // Pool sized for a phone: leave a core for the JS and UI threads, but never
+  // fan out wider than four decoders at once.
+  static size_t defaultThreadCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (cores <= 2) return 1;
+    return cores - 1 < 4 ? cores - 1 : 4;
+  }
+
+private:
+  void workerLoop() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stopping_ = false;
+};
+
+} // namespace facebook::react
@@ -3,6 +3,11 @@ import { TurboModule, TurboModuleRegistry } from "react-native";
 export interface Spec extends TurboModule {
   readonly getFFmpegVersion: () => string;
   readonly getVideoMetaData: (filePath: string) => string;
+  readonly probeMany: (
+    paths: ReadonlyArray<string>,
+    ordered: boolean,
+    onResult: (index: number, resultJson: string) => void
+  ) => Promise<number>;
   readonly muteVideo: (inputPath: string, outputPath: string) => boolean;
   readonly trimLast2Seconds: (inputPath: string, outputPath: string) => boolean;
   readonly trimVideo: (
@@ -15,8 +20,101 @@ export interface Spec extends TurboModule {
     inputPath: string,
     outputPath: string,
     overlaysJson: string,
-    workDir: string
+    workDir: string,
+    exportOptionsJson: string
   ) => boolean;
+  readonly generateProxy: (
+    inputPath: string,
+    maxHeight: number
+  ) => Promise<string>;
+  readonly configureMediaCache: (directory: string, maxBytes: number) => boolean;
+  readonly generateThumbnail: (
+    filePath: string,
+    timeSec: number,
+    width: number,
+    height: number,
+    format: string,
+    outputPath: string
+  ) => Promise<string>;
+  readonly generateFilmstrip: (
+    filePath: string,
+    count: number,
+    tileWidth: number,
+    format: string,
+    outputPath: string
+  ) => Promise<string>;
+  readonly openPreviewSession: (
+    inputPath: string,
+    displayWidth: number,
+    displayHeight: number,
+    workDir: string
+  ) => number;
+  readonly renderPreviewFrame: (
+    sessionId: number,
+    timeSec: number,
+    overlaysJson: string
+  ) => Object;
+  readonly closePreviewSession: (sessionId: number) => void;
+  readonly openScrubSession: (
+    inputPath: string,
+    displayWidth: number,
+    displayHeight: number,
+    maxBytes: number
+  ) => number;
+  readonly scrubFrame: (sessionId: number, timeSec: number) => Object;
+  readonly getScrubStats: (sessionId: number) => Object;
+  readonly closeScrubSession: (sessionId: number) => void;
+  readonly extractWaveform: (
+    inputPath: string,
+    buckets: number,
+    onPeaks: (firstBucket: number, peaks: ReadonlyArray<number>) => void
+  ) => Promise<number>;
+  readonly detectScenes: (
+    inputPath: string,
+    threshold: number,
+    maxCuts: number
+  ) => Promise<string>;
+  readonly buildKeyframeIndex: (inputPath: string) => Promise<string>;
+  readonly detectTrimPoints: (
+    inputPath: string,
+    maxEdgeSec: number
+  ) => Promise<string>;
+  readonly autoTrim: (
+    inputPath: string,
+    outputPath: string,
+    maxEdgeSec: number
+  ) => Promise<string>;
+  readonly analyzeLoudness: (inputPath: string) => Promise<string>;
+  readonly extractAudio: (
+    inputPath: string,
+    outputPath: string,
+    format: string
+  ) => Promise<string>;
+  readonly muteRanges: (
+    inputPath: string,
+    outputPath: string,
+    rangesJson: string
+  ) => Promise<string>;
+  readonly concat: (
+    inputPaths: ReadonlyArray<string>,
+    outputPath: string,
+    transitionsJson: string
+  ) => Promise<string>;
+  readonly benchmarkExportProfiles: (
+    inputPaths: ReadonlyArray<string>,
+    workDir: string
+  ) => Promise<string>;
+  readonly exportRenditions: (
+    planJson: string,
+    overlaysJson: string,
+    renditionsJson: string
+  ) => Promise<string>;
+  readonly exportAnimated: (
+    planJson: string,
+    overlaysJson: string,
+    outputPath: string,
+    optionsJson: string
+  ) => Promise<string>;
 }
 
 export default TurboModuleRegistry.getEnforcing<Spec>("NativeFFmpegModule");
@@ -1,6 +1,6 @@
+import FFmpegModule from "@/specs/NativeFFmpegModule";
 import { Video } from "expo-av";
 import * as FileSystem from "expo-file-system";
-import * as VideoThumbnails from "expo-video-thumbnails";
 
 class VideoProcessor {
   /**
@@ -8,12 +8,27 @@ class VideoProcessor {
    * @param videoUri Path to the video file
    * @returns Promise with the thumbnail URI
    */
-  static async generateThumbnail(videoUri: string): Promise<string> {
+  static async generateThumbnail(
+    videoUri: string,
+    timeSec = 0,
+    width = 320
+  ): Promise<string> {
     try {
-      const { uri } = await VideoThumbnails.getThumbnailAsync(videoUri, {
-        time: 0, // Get thumbnail from first frame
-      });
-      return uri;
+      const thumbnailUri = `${
+        FileSystem.cacheDirectory
+      }thumb_${Date.now()}.jpg`;
+      // Native keyframe decode, scaled straight to the target width
+      const result = JSON.parse(
+        await FFmpegModule.generateThumbnail(
+          videoUri,
+          timeSec,
+          width,
+          0,
+          "jpeg",
+          thumbnailUri
+        )
+      ) as { uri: string };
+      return result.uri;
     } catch (error) {
       console.error("Failed to generate thumbnail:", error);
       throw error;